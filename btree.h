@@ -0,0 +1,1219 @@
+/* How To  : To use this module, do this in *ONE* C file:
+ *              #define CSTDLIB_BTREE_IMPLEMENTATION
+ *              #include "btree.h"
+ *           it depends on "array.h", so CSTDLIB_ARRAY_IMPLEMENTATION has to
+ *           be defined in one C file as well
+ * Tests   : To use run test, do this in *ONE* C file:
+ *              #define CSTDLIB_BTREE_UNIT_TESTS
+ *              #include "btree.h"
+ * Options :
+ *           - C_BTREE_DONT_CHECK_PARAMS: parameters will not get checked
+ *                                        (this is off by default)
+ *           - C_BTREE_NODE_SIZE: the byte budget of a node, the number of
+ *                                keys per node is derived from it
+ *                                (512 by default)
+ * Notes   : a B+ tree, the keys and values only live in the leaves which are
+ *           linked together, so range scans never go back up the tree.
+ *           a node keeps its keys back to back and the values (or the
+ *           children) in a separate array, a lookup binary searches a few
+ *           cache lines per level
+ * License : MIT (go to the end of this file for details)
+ */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- header -------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifndef CSTDLIB_BTREE_H
+#define CSTDLIB_BTREE_H
+
+#include "array.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef C_BTREE_NODE_SIZE
+#define C_BTREE_NODE_SIZE 512U
+#endif
+
+typedef struct CBTree {
+  void*  root;
+  size_t len;
+  size_t key_size;
+  size_t value_size;
+  size_t leaf_max;  // keys per leaf
+  size_t inner_max; // keys per inner node
+  size_t values_offset;
+  size_t children_offset;
+  size_t node_size; // leaves and inner nodes share it
+  void*  spare_key;       // separator carried up by a split
+  void*  spare_value;     // last removed value
+  void*  spare_nodes;     // set aside for the next splits, linked by `next`
+  size_t spare_nodes_len;
+  int (*cmp)(void const* key1, void const* key2);
+} CBTree;
+
+typedef struct CBTreeIter {
+  void*  leaf;
+  size_t index;
+} CBTreeIter;
+
+typedef struct c_btree_error_t {
+  int         code;
+  char const* desc;
+} c_btree_error_t;
+
+#define C_BTREE_ERROR_none ((c_btree_error_t){.code = 0, .desc = ""})
+#define C_BTREE_ERROR_mem_allocation                                           \
+  ((c_btree_error_t){.code = 1, .desc = "btree: memory allocation error"})
+#define C_BTREE_ERROR_key_not_found                                            \
+  ((c_btree_error_t){.code = 2, .desc = "btree: key not found"})
+#define C_BTREE_ERROR_invalid_parameters                                       \
+  ((c_btree_error_t){.code = 3, .desc = "btree: invalid parameters"})
+#define C_BTREE_ERROR_not_sorted                                               \
+  ((c_btree_error_t){.code = 4, .desc = "btree: keys are not sorted"})
+
+/// @brief create an empty tree
+/// @param key_size
+/// @param value_size can be 0
+/// @param cmp returns <0, 0 or >0 like `qsort`'s comparator
+/// @param out_tree
+/// @return error (any value but zero is treated as an error)
+c_btree_error_t c_btree_create(size_t   key_size,
+                               size_t   value_size,
+                               int      cmp(void const* key1,
+                                       void const* key2),
+                               CBTree*  out_tree);
+
+/// @brief build a tree from sorted keys and their values in O(n), the nodes
+///        are filled evenly and bottom up without any comparison but the
+///        sortedness check
+/// @param keys strictly increasing keys of `key_size`
+/// @param values `keys->len` values of `value_size` (NULL if it is 0)
+/// @return C_BTREE_ERROR_not_sorted if `keys` is not strictly increasing
+c_btree_error_t c_btree_create_from_sorted(size_t        key_size,
+                                           size_t        value_size,
+                                           int           cmp(void const* key1,
+                                                   void const* key2),
+                                           CArray const* keys,
+                                           CArray const* values,
+                                           CBTree*       out_tree);
+
+/// @brief insert or update `key`
+/// @return error (any value but zero is treated as an error)
+c_btree_error_t
+c_btree_insert(CBTree* self, void const* key, void const* value);
+
+/// @param out_value set to NULL if the key is not found
+/// @return error (any value but zero is treated as an error)
+c_btree_error_t
+c_btree_get(CBTree const* self, void const* key, void** out_value);
+
+/// @param out_value valid till the next insert/remove
+/// @return C_BTREE_ERROR_key_not_found if the key is not found
+c_btree_error_t c_btree_remove(CBTree* self, void const* key, void** out_value);
+
+size_t c_btree_len(CBTree const* self);
+
+/// @brief point `out_iter` at the first key not less than `key`
+c_btree_error_t c_btree_lower_bound(CBTree const* self,
+                                    void const*   key,
+                                    CBTreeIter*   out_iter);
+
+/// @brief point `out_iter` at the first key greater than `key`
+c_btree_error_t c_btree_upper_bound(CBTree const* self,
+                                    void const*   key,
+                                    CBTreeIter*   out_iter);
+
+/// @brief walk the keys in order, a zeroed `iter` starts from the smallest
+///        key, one set by `c_btree_lower_bound`/`c_btree_upper_bound` starts
+///        from there. the tree must not be modified while iterating
+bool c_btree_iter(CBTree const* self,
+                  CBTreeIter*   iter,
+                  void**        key,
+                  void**        value);
+
+void c_btree_clear(CBTree* self,
+                   void    element_destroy_fn(void* key,
+                                           void* value,
+                                           void* user_data),
+                   void*   user_data);
+
+void c_btree_destroy(CBTree* self,
+                     void    element_destroy_fn(void* key,
+                                             void* value,
+                                             void* user_data),
+                     void*   user_data);
+
+#endif // CSTDLIB_BTREE_H
+
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- implementation ---------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_BTREE_IMPLEMENTATION
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifndef C_BTREE_DONT_CHECK_PARAMS
+#define C_BTREE_CHECK_PARAMS(params)                                           \
+  if (!(params)) return C_BTREE_ERROR_invalid_parameters;
+#else
+#define C_BTREE_CHECK_PARAMS(params) ((void)0)
+#endif
+
+// a node has room for one key above its max, it gets split right after
+typedef struct CBTreeNode CBTreeNode;
+struct CBTreeNode {
+  size_t      len;
+  bool        is_leaf;
+  CBTreeNode* prev; // leaves only
+  CBTreeNode* next; // leaves only
+  // leaves: { [keys], [values] }, inner nodes: { [keys], [children] }
+};
+
+static CBTreeNode* c_internal_btree_node_create(CBTree* self, bool is_leaf);
+static void        c_internal_btree_node_destroy(CBTree*     self,
+                                                 CBTreeNode* node,
+                                                 void element_destroy_fn(
+                                                     void* key,
+                                                     void* value,
+                                                     void* user_data),
+                                                 void* user_data);
+static CBTreeNode* c_internal_btree_spare_node(CBTree* self, bool is_leaf);
+static CBTreeNode* c_internal_btree_insert(CBTree*     self,
+                                           CBTreeNode* node,
+                                           void const* key,
+                                           void const* value);
+static bool        c_internal_btree_remove(CBTree*     self,
+                                           CBTreeNode* node,
+                                           void const* key);
+static void        c_internal_btree_rebalance(CBTree*     self,
+                                              CBTreeNode* node,
+                                              size_t      child_index);
+static void        c_internal_btree_split(CBTree*     self,
+                                          CBTreeNode* node,
+                                          CBTreeNode* right);
+static size_t      c_internal_btree_lower_index(CBTree const*     self,
+                                                CBTreeNode const* node,
+                                                void const*       key);
+static size_t      c_internal_btree_upper_index(CBTree const*     self,
+                                                CBTreeNode const* node,
+                                                void const*       key);
+static CBTreeNode* c_internal_btree_find_leaf(CBTree const* self,
+                                              void const*   key);
+static void        c_internal_btree_move(CBTree const* self,
+                                         CBTreeNode*   dst,
+                                         size_t        dst_index,
+                                         CBTreeNode*   src,
+                                         size_t        src_index,
+                                         size_t        count);
+static inline void* c_internal_btree_get_key(CBTree const*     self,
+                                             CBTreeNode const* node,
+                                             size_t            index);
+static inline void* c_internal_btree_get_value(CBTree const*     self,
+                                               CBTreeNode const* node,
+                                               size_t            index);
+static inline CBTreeNode** c_internal_btree_get_children(CBTree const* self,
+                                                         CBTreeNode*   node);
+static size_t              c_internal_btree_align(size_t size);
+
+c_btree_error_t
+c_btree_create(size_t  key_size,
+               size_t  value_size,
+               int     cmp(void const* key1, void const* key2),
+               CBTree* out_tree)
+{
+  C_BTREE_CHECK_PARAMS(key_size > 0);
+  C_BTREE_CHECK_PARAMS(cmp);
+
+  if (!out_tree) { return C_BTREE_ERROR_none; }
+
+  *out_tree = (CBTree){0};
+
+  // as many keys as the node budget allows, but never less than 4 so a
+  // split always leaves both halves at least half full
+  size_t header_size = c_internal_btree_align(sizeof(CBTreeNode));
+  size_t budget
+      = (C_BTREE_NODE_SIZE > header_size) ? (C_BTREE_NODE_SIZE - header_size)
+                                           : 0;
+
+  size_t leaf_max  = budget / (key_size + value_size);
+  size_t inner_max = budget / (key_size + sizeof(CBTreeNode*));
+  if (leaf_max < 4) leaf_max = 4;
+  if (inner_max < 4) inner_max = 4;
+
+  out_tree->key_size   = key_size;
+  out_tree->value_size = value_size;
+  out_tree->leaf_max   = leaf_max;
+  out_tree->inner_max  = inner_max;
+  out_tree->values_offset
+      = header_size + c_internal_btree_align((leaf_max + 1) * key_size);
+  out_tree->children_offset
+      = header_size + c_internal_btree_align((inner_max + 1) * key_size);
+  out_tree->node_size
+      = out_tree->values_offset + ((leaf_max + 1) * value_size);
+  if (out_tree->node_size < out_tree->children_offset
+                                + ((inner_max + 2) * sizeof(CBTreeNode*))) {
+    out_tree->node_size
+        = out_tree->children_offset + ((inner_max + 2) * sizeof(CBTreeNode*));
+  }
+  out_tree->cmp = cmp;
+
+  out_tree->spare_key   = malloc(key_size + value_size);
+  out_tree->spare_value = (char*)out_tree->spare_key + key_size;
+  out_tree->root        = c_internal_btree_node_create(out_tree, true);
+  if (!out_tree->spare_key || !out_tree->root) {
+    free(out_tree->spare_key);
+    free(out_tree->root);
+    *out_tree = (CBTree){0};
+    return C_BTREE_ERROR_mem_allocation;
+  }
+
+  return C_BTREE_ERROR_none;
+}
+
+c_btree_error_t
+c_btree_create_from_sorted(size_t        key_size,
+                           size_t        value_size,
+                           int           cmp(void const* key1,
+                                   void const* key2),
+                           CArray const* keys,
+                           CArray const* values,
+                           CBTree*       out_tree)
+{
+  C_BTREE_CHECK_PARAMS(keys && keys->element_size == key_size);
+  C_BTREE_CHECK_PARAMS(!value_size
+                       || (values && values->element_size == value_size
+                           && values->len == keys->len));
+  C_BTREE_CHECK_PARAMS(cmp);
+
+  if (!out_tree) { return C_BTREE_ERROR_none; }
+
+  for (size_t iii = 1; iii < keys->len; ++iii) {
+    if (cmp((char*)keys->data + ((iii - 1) * key_size),
+            (char*)keys->data + (iii * key_size))
+        >= 0) {
+      *out_tree = (CBTree){0};
+      return C_BTREE_ERROR_not_sorted;
+    }
+  }
+
+  c_btree_error_t err = c_btree_create(key_size, value_size, cmp, out_tree);
+  if (err.code != C_BTREE_ERROR_none.code) { return err; }
+  if (keys->len == 0) { return C_BTREE_ERROR_none; }
+
+  CBTree* self = out_tree;
+
+  // the nodes of the level being built and a pointer to the smallest key
+  // under each of them (the separators of the level above)
+  size_t       count = (keys->len + self->leaf_max - 1) / self->leaf_max;
+  CBTreeNode** nodes = malloc(count * sizeof(*nodes));
+  void**       first_keys = malloc(count * sizeof(*first_keys));
+  if (!nodes || !first_keys) {
+    free(nodes);
+    free(first_keys);
+    c_btree_destroy(self, NULL, NULL);
+    return C_BTREE_ERROR_mem_allocation;
+  }
+
+  // [1] the leaves, filled evenly so none of them is under half full
+  CBTreeNode* leaf = self->root;
+  size_t      used = 0;
+  for (size_t iii = 0; iii < count; ++iii) {
+    if (iii > 0) {
+      leaf = c_internal_btree_node_create(self, true);
+      if (!leaf) break;
+      leaf->prev           = nodes[iii - 1];
+      nodes[iii - 1]->next = leaf;
+    }
+
+    leaf->len = (keys->len / count) + (iii < (keys->len % count));
+    memcpy(c_internal_btree_get_key(self, leaf, 0),
+           (char*)keys->data + (used * key_size), leaf->len * key_size);
+    if (value_size) {
+      memcpy(c_internal_btree_get_value(self, leaf, 0),
+             (char*)values->data + (used * value_size),
+             leaf->len * value_size);
+    }
+    used += leaf->len;
+
+    nodes[iii]      = leaf;
+    first_keys[iii] = c_internal_btree_get_key(self, leaf, 0);
+  }
+  if (used != keys->len) {
+    for (CBTreeNode* next = self->root; next;) {
+      leaf = next;
+      next = next->next;
+      free(leaf);
+    }
+    free(nodes);
+    free(first_keys);
+    free(self->spare_key);
+    *self = (CBTree){0};
+    return C_BTREE_ERROR_mem_allocation;
+  }
+
+  // [2] the inner levels, bottom up, till a single node is left
+  while (count > 1) {
+    size_t children_max = self->inner_max + 1;
+    size_t parents      = (count + children_max - 1) / children_max;
+    size_t consumed     = 0;
+
+    for (size_t iii = 0; iii < parents; ++iii) {
+      CBTreeNode* parent = c_internal_btree_node_create(self, false);
+      if (!parent) {
+        for (size_t jjj = 0; jjj < iii; ++jjj) {
+          c_internal_btree_node_destroy(self, nodes[jjj], NULL, NULL);
+        }
+        for (size_t jjj = consumed; jjj < count; ++jjj) {
+          c_internal_btree_node_destroy(self, nodes[jjj], NULL, NULL);
+        }
+        free(nodes);
+        free(first_keys);
+        free(self->spare_key);
+        *self = (CBTree){0};
+        return C_BTREE_ERROR_mem_allocation;
+      }
+
+      size_t children_count = (count / parents) + (iii < (count % parents));
+      CBTreeNode** children  = c_internal_btree_get_children(self, parent);
+      void*        first_key = first_keys[consumed];
+      for (size_t jjj = 0; jjj < children_count; ++jjj) {
+        children[jjj] = nodes[consumed + jjj];
+        if (jjj > 0) {
+          memcpy(c_internal_btree_get_key(self, parent, jjj - 1),
+                 first_keys[consumed + jjj], key_size);
+        }
+      }
+      parent->len = children_count - 1;
+      consumed += children_count;
+
+      // `iii` never passes `consumed`, nothing unread gets overwritten
+      nodes[iii]      = parent;
+      first_keys[iii] = first_key;
+    }
+
+    count = parents;
+  }
+
+  self->root = nodes[0];
+  self->len  = keys->len;
+  free(nodes);
+  free(first_keys);
+
+  return C_BTREE_ERROR_none;
+}
+
+c_btree_error_t
+c_btree_insert(CBTree* self, void const* key, void const* value)
+{
+  C_BTREE_CHECK_PARAMS(self && self->root);
+
+  if (!key || (!value && self->value_size)) { return C_BTREE_ERROR_none; }
+
+  // only the full nodes right above the leaf split (none of them when the key
+  // is there already), plus a new root when all of them are full. their nodes
+  // are set aside first, so a failing allocation leaves the tree untouched
+  size_t      splits = 0;
+  size_t      levels = 0;
+  CBTreeNode* node   = self->root;
+  for (;;) {
+    size_t max = node->is_leaf ? self->leaf_max : self->inner_max;
+    splits     = (node->len == max) ? splits + 1 : 0;
+    levels++;
+    if (node->is_leaf) break;
+    node = c_internal_btree_get_children(
+        self, node)[c_internal_btree_upper_index(self, node, key)];
+  }
+  size_t index = c_internal_btree_lower_index(self, node, key);
+  if ((index < node->len)
+      && (self->cmp(c_internal_btree_get_key(self, node, index), key) == 0)) {
+    splits = 0;
+  }
+  if (splits == levels) { splits++; }
+
+  while (self->spare_nodes_len < splits) {
+    CBTreeNode* spare = malloc(self->node_size);
+    if (!spare) return C_BTREE_ERROR_mem_allocation;
+    spare->next       = self->spare_nodes;
+    self->spare_nodes = spare;
+    self->spare_nodes_len++;
+  }
+
+  CBTreeNode* root  = self->root;
+  CBTreeNode* right = c_internal_btree_insert(self, root, key, value);
+  if (!right) { return C_BTREE_ERROR_none; }
+
+  // the root got split, grow the tree by one level
+  CBTreeNode* new_root = c_internal_btree_spare_node(self, false);
+  new_root->len        = 1;
+  memcpy(c_internal_btree_get_key(self, new_root, 0), self->spare_key,
+         self->key_size);
+  c_internal_btree_get_children(self, new_root)[0] = root;
+  c_internal_btree_get_children(self, new_root)[1] = right;
+  self->root                                      = new_root;
+
+  return C_BTREE_ERROR_none;
+}
+
+c_btree_error_t
+c_btree_get(CBTree const* self, void const* key, void** out_value)
+{
+  C_BTREE_CHECK_PARAMS(self && self->root);
+
+  if (!key || !out_value) { return C_BTREE_ERROR_none; }
+
+  CBTreeNode* leaf  = c_internal_btree_find_leaf(self, key);
+  size_t      index = c_internal_btree_lower_index(self, leaf, key);
+
+  *out_value = ((index < leaf->len)
+                && (self->cmp(c_internal_btree_get_key(self, leaf, index), key)
+                    == 0))
+                   ? c_internal_btree_get_value(self, leaf, index)
+                   : NULL;
+
+  return C_BTREE_ERROR_none;
+}
+
+c_btree_error_t
+c_btree_remove(CBTree* self, void const* key, void** out_value)
+{
+  C_BTREE_CHECK_PARAMS(self && self->root);
+
+  if (!key || !out_value) { return C_BTREE_ERROR_none; }
+
+  if (!c_internal_btree_remove(self, self->root, key)) {
+    return C_BTREE_ERROR_key_not_found;
+  }
+  self->len--;
+
+  // an inner root left with a single child is dropped
+  CBTreeNode* root = self->root;
+  if (!root->is_leaf && (root->len == 0)) {
+    self->root = c_internal_btree_get_children(self, root)[0];
+    free(root);
+  }
+
+  *out_value = self->spare_value;
+
+  return C_BTREE_ERROR_none;
+}
+
+size_t
+c_btree_len(CBTree const* self)
+{
+  return self->len;
+}
+
+c_btree_error_t
+c_btree_lower_bound(CBTree const* self, void const* key, CBTreeIter* out_iter)
+{
+  C_BTREE_CHECK_PARAMS(self && self->root && key);
+
+  if (!out_iter) { return C_BTREE_ERROR_none; }
+
+  CBTreeNode* leaf = c_internal_btree_find_leaf(self, key);
+  *out_iter        = (CBTreeIter){
+      .leaf  = leaf,
+      .index = c_internal_btree_lower_index(self, leaf, key),
+  };
+
+  return C_BTREE_ERROR_none;
+}
+
+c_btree_error_t
+c_btree_upper_bound(CBTree const* self, void const* key, CBTreeIter* out_iter)
+{
+  C_BTREE_CHECK_PARAMS(self && self->root && key);
+
+  if (!out_iter) { return C_BTREE_ERROR_none; }
+
+  CBTreeNode* leaf = c_internal_btree_find_leaf(self, key);
+  *out_iter        = (CBTreeIter){
+      .leaf  = leaf,
+      .index = c_internal_btree_upper_index(self, leaf, key),
+  };
+
+  return C_BTREE_ERROR_none;
+}
+
+bool
+c_btree_iter(CBTree const* self, CBTreeIter* iter, void** key, void** value)
+{
+  if (!iter) return false;
+
+  // a zeroed iter starts from the leftmost leaf
+  if (!iter->leaf && (iter->index == 0)) {
+    CBTreeNode* node = self->root;
+    while (!node->is_leaf) {
+      node = c_internal_btree_get_children(self, node)[0];
+    }
+    iter->leaf = node;
+  }
+
+  CBTreeNode* leaf = iter->leaf;
+  while (leaf && (iter->index >= leaf->len)) {
+    leaf        = leaf->next;
+    iter->index = 0;
+  }
+  if (!leaf) {
+    *iter = (CBTreeIter){.leaf = NULL, .index = SIZE_MAX};
+    return false;
+  }
+
+  if (key) { *key = c_internal_btree_get_key(self, leaf, iter->index); }
+  if (value) { *value = c_internal_btree_get_value(self, leaf, iter->index); }
+  iter->leaf = leaf;
+  iter->index++;
+
+  return true;
+}
+
+void
+c_btree_clear(CBTree* self,
+              void    element_destroy_fn(void* key,
+                                      void* value,
+                                      void* user_data),
+              void*   user_data)
+{
+  // keep the root around as an empty leaf
+  CBTreeNode* root = self->root;
+  if (root->is_leaf) {
+    for (size_t iii = 0; element_destroy_fn && (iii < root->len); ++iii) {
+      element_destroy_fn(c_internal_btree_get_key(self, root, iii),
+                         c_internal_btree_get_value(self, root, iii),
+                         user_data);
+    }
+  } else {
+    CBTreeNode** children = c_internal_btree_get_children(self, root);
+    for (size_t iii = 0; iii <= root->len; ++iii) {
+      c_internal_btree_node_destroy(self, children[iii], element_destroy_fn,
+                                    user_data);
+    }
+  }
+
+  *root     = (CBTreeNode){.is_leaf = true};
+  self->len = 0;
+}
+
+void
+c_btree_destroy(CBTree* self,
+                void    element_destroy_fn(void* key,
+                                        void* value,
+                                        void* user_data),
+                void*   user_data)
+{
+  if (self && self->root) {
+    c_internal_btree_node_destroy(self, self->root, element_destroy_fn,
+                                  user_data);
+    for (CBTreeNode* spare = self->spare_nodes; spare;) {
+      CBTreeNode* next = spare->next;
+      free(spare);
+      spare = next;
+    }
+    free(self->spare_key);
+    *self = (CBTree){0};
+  }
+}
+
+// ------------------------- internal ------------------------- //
+
+CBTreeNode*
+c_internal_btree_node_create(CBTree* self, bool is_leaf)
+{
+  CBTreeNode* node = malloc(self->node_size);
+  if (node) { *node = (CBTreeNode){.is_leaf = is_leaf}; }
+
+  return node;
+}
+
+void
+c_internal_btree_node_destroy(CBTree*     self,
+                              CBTreeNode* node,
+                              void        element_destroy_fn(void* key,
+                                                      void* value,
+                                                      void* user_data),
+                              void*       user_data)
+{
+  if (node->is_leaf) {
+    if (element_destroy_fn) {
+      for (size_t iii = 0; iii < node->len; ++iii) {
+        element_destroy_fn(c_internal_btree_get_key(self, node, iii),
+                           c_internal_btree_get_value(self, node, iii),
+                           user_data);
+      }
+    }
+  } else {
+    CBTreeNode** children = c_internal_btree_get_children(self, node);
+    for (size_t iii = 0; iii <= node->len; ++iii) {
+      c_internal_btree_node_destroy(self, children[iii], element_destroy_fn,
+                                    user_data);
+    }
+  }
+
+  free(node);
+}
+
+CBTreeNode*
+c_internal_btree_spare_node(CBTree* self, bool is_leaf)
+{
+  // `c_btree_insert` made sure there is one
+  CBTreeNode* node  = self->spare_nodes;
+  self->spare_nodes = node->next;
+  self->spare_nodes_len--;
+  *node = (CBTreeNode){.is_leaf = is_leaf};
+
+  return node;
+}
+
+CBTreeNode*
+c_internal_btree_insert(CBTree*     self,
+                        CBTreeNode* node,
+                        void const* key,
+                        void const* value)
+{
+  if (node->is_leaf) {
+    size_t index = c_internal_btree_lower_index(self, node, key);
+    if ((index < node->len)
+        && (self->cmp(c_internal_btree_get_key(self, node, index), key) == 0)) {
+      if (value) {
+        memcpy(c_internal_btree_get_value(self, node, index), value,
+               self->value_size);
+      }
+      return NULL;
+    }
+
+    c_internal_btree_move(self, node, index + 1, node, index,
+                          node->len - index);
+    memcpy(c_internal_btree_get_key(self, node, index), key, self->key_size);
+    if (value) {
+      memcpy(c_internal_btree_get_value(self, node, index), value,
+             self->value_size);
+    }
+    node->len++;
+    self->len++;
+  } else {
+    size_t       index    = c_internal_btree_upper_index(self, node, key);
+    CBTreeNode** children = c_internal_btree_get_children(self, node);
+    CBTreeNode*  right
+        = c_internal_btree_insert(self, children[index], key, value);
+    if (!right) { return NULL; }
+
+    // take the child's separator (in `spare_key`) and its new sibling
+    c_internal_btree_move(self, node, index + 1, node, index,
+                          node->len - index);
+    memmove(children + index + 2, children + index + 1,
+            (node->len - index) * sizeof(CBTreeNode*));
+    memcpy(c_internal_btree_get_key(self, node, index), self->spare_key,
+           self->key_size);
+    children[index + 1] = right;
+    node->len++;
+  }
+
+  if (node->len > (node->is_leaf ? self->leaf_max : self->inner_max)) {
+    CBTreeNode* right = c_internal_btree_spare_node(self, node->is_leaf);
+    c_internal_btree_split(self, node, right);
+    return right;
+  }
+
+  return NULL;
+}
+
+void
+c_internal_btree_split(CBTree* self, CBTreeNode* node, CBTreeNode* right)
+{
+  size_t mid = node->len / 2;
+
+  if (node->is_leaf) {
+    // the separator is the right half's first key, which stays in the leaf
+    c_internal_btree_move(self, right, 0, node, mid, node->len - mid);
+    right->len = node->len - mid;
+    node->len  = mid;
+    memcpy(self->spare_key, c_internal_btree_get_key(self, right, 0),
+           self->key_size);
+
+    right->prev = node;
+    right->next = node->next;
+    if (node->next) { node->next->prev = right; }
+    node->next = right;
+  } else {
+    // the middle key moves up
+    memcpy(self->spare_key, c_internal_btree_get_key(self, node, mid),
+           self->key_size);
+    memcpy(c_internal_btree_get_key(self, right, 0),
+           c_internal_btree_get_key(self, node, mid + 1),
+           (node->len - mid - 1) * self->key_size);
+    memcpy(c_internal_btree_get_children(self, right),
+           c_internal_btree_get_children(self, node) + mid + 1,
+           (node->len - mid) * sizeof(CBTreeNode*));
+    right->len = node->len - mid - 1;
+    node->len  = mid;
+  }
+}
+
+bool
+c_internal_btree_remove(CBTree* self, CBTreeNode* node, void const* key)
+{
+  if (node->is_leaf) {
+    size_t index = c_internal_btree_lower_index(self, node, key);
+    if ((index >= node->len)
+        || (self->cmp(c_internal_btree_get_key(self, node, index), key)
+            != 0)) {
+      return false;
+    }
+
+    memcpy(self->spare_value, c_internal_btree_get_value(self, node, index),
+           self->value_size);
+    c_internal_btree_move(self, node, index, node, index + 1,
+                          node->len - index - 1);
+    node->len--;
+
+    return true;
+  }
+
+  size_t       index    = c_internal_btree_upper_index(self, node, key);
+  CBTreeNode** children = c_internal_btree_get_children(self, node);
+  if (!c_internal_btree_remove(self, children[index], key)) { return false; }
+
+  CBTreeNode* child = children[index];
+  size_t min = (child->is_leaf ? self->leaf_max : self->inner_max) / 2;
+  if (child->len < min) { c_internal_btree_rebalance(self, node, index); }
+
+  return true;
+}
+
+void
+c_internal_btree_rebalance(CBTree* self, CBTreeNode* node, size_t child_index)
+{
+  CBTreeNode** children = c_internal_btree_get_children(self, node);
+  CBTreeNode*  child    = children[child_index];
+  CBTreeNode*  left     = (child_index > 0) ? children[child_index - 1] : NULL;
+  CBTreeNode*  right
+      = (child_index < node->len) ? children[child_index + 1] : NULL;
+  size_t min = (child->is_leaf ? self->leaf_max : self->inner_max) / 2;
+
+  // [1] borrow from the left sibling
+  if (left && (left->len > min)) {
+    void* separator = c_internal_btree_get_key(self, node, child_index - 1);
+    if (child->is_leaf) {
+      c_internal_btree_move(self, child, 1, child, 0, child->len);
+      c_internal_btree_move(self, child, 0, left, left->len - 1, 1);
+      memcpy(separator, c_internal_btree_get_key(self, child, 0),
+             self->key_size);
+    } else {
+      CBTreeNode** child_children = c_internal_btree_get_children(self, child);
+      c_internal_btree_move(self, child, 1, child, 0, child->len);
+      memmove(child_children + 1, child_children,
+              (child->len + 1) * sizeof(CBTreeNode*));
+      memcpy(c_internal_btree_get_key(self, child, 0), separator,
+             self->key_size);
+      child_children[0]
+          = c_internal_btree_get_children(self, left)[left->len];
+      memcpy(separator, c_internal_btree_get_key(self, left, left->len - 1),
+             self->key_size);
+    }
+    child->len++;
+    left->len--;
+    return;
+  }
+
+  // [2] borrow from the right sibling
+  if (right && (right->len > min)) {
+    void* separator = c_internal_btree_get_key(self, node, child_index);
+    if (child->is_leaf) {
+      c_internal_btree_move(self, child, child->len, right, 0, 1);
+      c_internal_btree_move(self, right, 0, right, 1, right->len - 1);
+      memcpy(separator, c_internal_btree_get_key(self, right, 0),
+             self->key_size);
+    } else {
+      CBTreeNode** right_children = c_internal_btree_get_children(self, right);
+      memcpy(c_internal_btree_get_key(self, child, child->len), separator,
+             self->key_size);
+      c_internal_btree_get_children(self, child)[child->len + 1]
+          = right_children[0];
+      memcpy(separator, c_internal_btree_get_key(self, right, 0),
+             self->key_size);
+      c_internal_btree_move(self, right, 0, right, 1, right->len - 1);
+      memmove(right_children, right_children + 1,
+              right->len * sizeof(CBTreeNode*));
+    }
+    child->len++;
+    right->len--;
+    return;
+  }
+
+  // [3] merge with a sibling, always into the left one of the pair
+  if (!left) {
+    left = child;
+    child_index++;
+  }
+  CBTreeNode* merged = children[child_index];
+  void* separator    = c_internal_btree_get_key(self, node, child_index - 1);
+
+  if (left->is_leaf) {
+    c_internal_btree_move(self, left, left->len, merged, 0, merged->len);
+    left->len += merged->len;
+    left->next = merged->next;
+    if (merged->next) { merged->next->prev = left; }
+  } else {
+    memcpy(c_internal_btree_get_key(self, left, left->len), separator,
+           self->key_size);
+    memcpy(c_internal_btree_get_key(self, left, left->len + 1),
+           c_internal_btree_get_key(self, merged, 0),
+           merged->len * self->key_size);
+    memcpy(c_internal_btree_get_children(self, left) + left->len + 1,
+           c_internal_btree_get_children(self, merged),
+           (merged->len + 1) * sizeof(CBTreeNode*));
+    left->len += merged->len + 1;
+  }
+  free(merged);
+
+  memmove(separator, (char*)separator + self->key_size,
+          (node->len - child_index) * self->key_size);
+  memmove(children + child_index, children + child_index + 1,
+          (node->len - child_index) * sizeof(CBTreeNode*));
+  node->len--;
+}
+
+size_t
+c_internal_btree_lower_index(CBTree const*     self,
+                             CBTreeNode const* node,
+                             void const*       key)
+{
+  // first key not less than `key`
+  size_t low  = 0;
+  size_t high = node->len;
+  while (low < high) {
+    size_t mid = low + ((high - low) / 2);
+    if (self->cmp(c_internal_btree_get_key(self, node, mid), key) < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+size_t
+c_internal_btree_upper_index(CBTree const*     self,
+                             CBTreeNode const* node,
+                             void const*       key)
+{
+  // first key greater than `key`
+  size_t low  = 0;
+  size_t high = node->len;
+  while (low < high) {
+    size_t mid = low + ((high - low) / 2);
+    if (self->cmp(c_internal_btree_get_key(self, node, mid), key) <= 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+CBTreeNode*
+c_internal_btree_find_leaf(CBTree const* self, void const* key)
+{
+  // a key equal to a separator lives on the separator's right
+  CBTreeNode* node = self->root;
+  while (!node->is_leaf) {
+    node = c_internal_btree_get_children(
+        self, node)[c_internal_btree_upper_index(self, node, key)];
+  }
+
+  return node;
+}
+
+void
+c_internal_btree_move(CBTree const* self,
+                      CBTreeNode*   dst,
+                      size_t        dst_index,
+                      CBTreeNode*   src,
+                      size_t        src_index,
+                      size_t        count)
+{
+  // keys and, for leaves, values (the nodes can overlap)
+  memmove(c_internal_btree_get_key(self, dst, dst_index),
+          c_internal_btree_get_key(self, src, src_index),
+          count * self->key_size);
+  if (dst->is_leaf && self->value_size) {
+    memmove(c_internal_btree_get_value(self, dst, dst_index),
+            c_internal_btree_get_value(self, src, src_index),
+            count * self->value_size);
+  }
+}
+
+void*
+c_internal_btree_get_key(CBTree const* self,
+                         CBTreeNode const* node,
+                         size_t            index)
+{
+  return (char*)node + c_internal_btree_align(sizeof(CBTreeNode))
+         + (index * self->key_size);
+}
+
+void*
+c_internal_btree_get_value(CBTree const*     self,
+                           CBTreeNode const* node,
+                           size_t            index)
+{
+  return (char*)node + self->values_offset + (index * self->value_size);
+}
+
+CBTreeNode**
+c_internal_btree_get_children(CBTree const* self, CBTreeNode* node)
+{
+  return (CBTreeNode**)((char*)node + self->children_offset);
+}
+
+size_t
+c_internal_btree_align(size_t size)
+{
+  size_t const alignment = sizeof(uint64_t);
+  return (size + (alignment - 1)) & ~(alignment - 1);
+}
+
+#undef C_BTREE_CHECK_PARAMS
+#undef CSTDLIB_BTREE_IMPLEMENTATION
+#endif // CSTDLIB_BTREE_IMPLEMENTATION
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_BTREE_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#define CSTDLIB_ARRAY_IMPLEMENTATION
+#include "array.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BTREE_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define BTREE_TEST(err)                                                        \
+  ((err.code != C_BTREE_ERROR_none.code) ? BTREE_TEST_PRINT_ABORT(err.desc)    \
+                                         : (void)0)
+#define BTREE_ASSERT(cond) (!(cond)) ? BTREE_TEST_PRINT_ABORT(#cond) : (void)0
+
+static int
+btree_test_cmp_int(void const* key1, void const* key2)
+{
+  int const a = *(int const*)key1;
+  int const b = *(int const*)key2;
+  return (a > b) - (a < b);
+}
+
+int
+main(void)
+{
+  c_btree_error_t err = C_BTREE_ERROR_none;
+
+  // test: insert, get, remove (shuffled keys, enough for a few levels)
+  {
+    CBTree tree;
+    err = c_btree_create(sizeof(int), sizeof(int), btree_test_cmp_int, &tree);
+    BTREE_TEST(err);
+
+    int const count = 5000;
+    for (int iii = 0; iii < count; ++iii) {
+      int key = (iii * 7919) % count;
+      err     = c_btree_insert(&tree, &key, &(int){key * 2});
+      BTREE_TEST(err);
+      // exactly the nodes the splits needed were allocated
+      BTREE_ASSERT(tree.spare_nodes_len == 0);
+    }
+    err = c_btree_insert(&tree, &(int){10}, &(int){-10}); // test override
+    BTREE_TEST(err);
+    BTREE_ASSERT(!tree.spare_nodes);
+    BTREE_ASSERT(c_btree_len(&tree) == (size_t)count);
+
+    int* value = NULL;
+    for (int iii = 0; iii < count; ++iii) {
+      err = c_btree_get(&tree, &iii, (void**)&value);
+      BTREE_TEST(err);
+      BTREE_ASSERT(value && *value == ((iii == 10) ? -10 : iii * 2));
+    }
+    err = c_btree_get(&tree, &(int){count}, (void**)&value);
+    BTREE_TEST(err);
+    BTREE_ASSERT(!value);
+
+    // in order
+    CBTreeIter iter     = {0};
+    int*       key      = NULL;
+    int        expected = 0;
+    while (c_btree_iter(&tree, &iter, (void**)&key, NULL)) {
+      BTREE_ASSERT(*key == expected);
+      expected++;
+    }
+    BTREE_ASSERT(expected == count);
+
+    // remove all the odd keys, then most of the rest
+    for (int iii = 1; iii < count; iii += 2) {
+      err = c_btree_remove(&tree, &iii, (void**)&value);
+      BTREE_TEST(err);
+      BTREE_ASSERT(*value == iii * 2);
+    }
+    err = c_btree_remove(&tree, &(int){1}, (void**)&value);
+    BTREE_ASSERT(err.code == C_BTREE_ERROR_key_not_found.code);
+    for (int iii = 0; iii < count - 100; iii += 2) {
+      err = c_btree_remove(&tree, &iii, (void**)&value);
+      BTREE_TEST(err);
+    }
+    BTREE_ASSERT(c_btree_len(&tree) == 50);
+
+    iter     = (CBTreeIter){0};
+    expected = count - 100;
+    while (c_btree_iter(&tree, &iter, (void**)&key, (void**)&value)) {
+      BTREE_ASSERT(*key == expected && *value == expected * 2);
+      expected += 2;
+    }
+    BTREE_ASSERT(expected == count);
+
+    c_btree_destroy(&tree, NULL, NULL);
+  }
+
+  // test: lower/upper bound and range scans
+  {
+    CBTree tree;
+    err = c_btree_create(sizeof(int), 0, btree_test_cmp_int, &tree);
+    BTREE_TEST(err);
+    for (int iii = 0; iii < 1000; iii += 10) {
+      err = c_btree_insert(&tree, &iii, NULL);
+      BTREE_TEST(err);
+    }
+
+    CBTreeIter iter = {0};
+    int*       key  = NULL;
+
+    err = c_btree_lower_bound(&tree, &(int){250}, &iter);
+    BTREE_TEST(err);
+    BTREE_ASSERT(c_btree_iter(&tree, &iter, (void**)&key, NULL));
+    BTREE_ASSERT(*key == 250);
+
+    err = c_btree_upper_bound(&tree, &(int){250}, &iter);
+    BTREE_TEST(err);
+    BTREE_ASSERT(c_btree_iter(&tree, &iter, (void**)&key, NULL));
+    BTREE_ASSERT(*key == 260);
+
+    // [255, 505)
+    int sum = 0;
+    err     = c_btree_lower_bound(&tree, &(int){255}, &iter);
+    BTREE_TEST(err);
+    while (c_btree_iter(&tree, &iter, (void**)&key, NULL) && *key < 505) {
+      sum += *key;
+    }
+    BTREE_ASSERT(sum == (260 + 500) * 25 / 2);
+
+    err = c_btree_lower_bound(&tree, &(int){991}, &iter);
+    BTREE_TEST(err);
+    BTREE_ASSERT(!c_btree_iter(&tree, &iter, (void**)&key, NULL));
+
+    c_btree_destroy(&tree, NULL, NULL);
+  }
+
+  // test: bulk load
+  {
+    CArray keys;
+    CArray values;
+    c_array_error_t arr_err = c_array_create(sizeof(int), &keys);
+    BTREE_ASSERT(arr_err.code == 0);
+    arr_err = c_array_create(sizeof(int), &values);
+    BTREE_ASSERT(arr_err.code == 0);
+
+    for (int iii = 0; iii < 10000; ++iii) {
+      arr_err = c_array_push(&keys, &(int){iii * 3});
+      BTREE_ASSERT(arr_err.code == 0);
+      arr_err = c_array_push(&values, &iii);
+      BTREE_ASSERT(arr_err.code == 0);
+    }
+
+    CBTree tree;
+    err = c_btree_create_from_sorted(sizeof(int), sizeof(int),
+                                     btree_test_cmp_int, &keys, &values, &tree);
+    BTREE_TEST(err);
+    BTREE_ASSERT(c_btree_len(&tree) == 10000);
+
+    int* value = NULL;
+    for (int iii = 0; iii < 10000; ++iii) {
+      err = c_btree_get(&tree, &(int){iii * 3}, (void**)&value);
+      BTREE_TEST(err);
+      BTREE_ASSERT(value && *value == iii);
+    }
+
+    // it is a regular tree afterwards
+    for (int iii = 0; iii < 30000; iii += 2) {
+      err = c_btree_insert(&tree, &iii, &(int){-1});
+      BTREE_TEST(err);
+    }
+    for (int iii = 0; iii < 30000; iii += 3) {
+      err = c_btree_remove(&tree, &iii, (void**)&value);
+      BTREE_TEST(err);
+    }
+    CBTreeIter iter  = {0};
+    int*       key   = NULL;
+    int        prev  = -1;
+    size_t     count = 0;
+    while (c_btree_iter(&tree, &iter, (void**)&key, NULL)) {
+      BTREE_ASSERT(*key > prev && (*key % 3) != 0);
+      prev = *key;
+      count++;
+    }
+    BTREE_ASSERT(count == c_btree_len(&tree));
+    c_btree_destroy(&tree, NULL, NULL);
+
+    // not sorted
+    ((int*)keys.data)[5] = 1000000;
+    err = c_btree_create_from_sorted(sizeof(int), sizeof(int),
+                                     btree_test_cmp_int, &keys, &values, &tree);
+    BTREE_ASSERT(err.code == C_BTREE_ERROR_not_sorted.code);
+
+    c_array_destroy(&keys);
+    c_array_destroy(&values);
+  }
+}
+
+#ifdef NDEBUG_
+#define NDEBUG
+#undef NDEBUG_
+#endif
+
+#undef BTREE_TEST_PRINT_ABORT
+#undef BTREE_TEST
+#undef BTREE_ASSERT
+#undef CSTDLIB_BTREE_UNIT_TESTS
+#endif // CSTDLIB_BTREE_UNIT_TESTS
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Mohamed A. Elmeligy
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions: The above copyright
+ * notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS",
+ * WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,662 @@
+/* How To  : To use this module, do this in *ONE* C file:
+ *              #define CSTDLIB_CACHE_IMPLEMENTATION
+ *              #include "cache.h"
+ *           it depends on "map.h", so CSTDLIB_MAP_IMPLEMENTATION has to be
+ *           defined in one C file as well
+ * Tests   : To use run test, do this in *ONE* C file:
+ *              #define CSTDLIB_CACHE_UNIT_TESTS
+ *              #include "cache.h"
+ * Options :
+ *           - C_CACHE_DONT_CHECK_PARAMS: parameters will not get checked
+ *                                        (this is off by default)
+ * Notes   : a CCache holds at most `capacity` entries, the entries live in a
+ *           slab of nodes allocated once and the CMap only maps a key to its
+ *           node index, so a hit costs a single hash lookup.
+ *           the map is presized for `capacity` keys plus the one a put
+ *           adds before evicting, and never resizes.
+ *           - C_CACHE_POLICY_LRU: the nodes are kept in a doubly linked list
+ *             ordered by use, a hit moves its node to the front
+ *           - C_CACHE_POLICY_CLOCK: a hit only sets the node's reference
+ *             bit, a clock hand sweeps the slab on eviction giving the
+ *             referenced nodes a second chance
+ * License : MIT (go to the end of this file for details)
+ */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- header -------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifndef CSTDLIB_CACHE_H
+#define CSTDLIB_CACHE_H
+
+#include "map.h"
+
+typedef enum CCachePolicy {
+  C_CACHE_POLICY_LRU,
+  C_CACHE_POLICY_CLOCK,
+} CCachePolicy;
+
+typedef struct CCache {
+  CMap         map;   // key -> node index
+  void*        nodes; // { [CCacheNode, key, value], ... }
+  size_t       node_size;
+  size_t       key_size;
+  size_t       value_size;
+  size_t       value_offset;
+  size_t       capacity;
+  size_t       len;
+  uint32_t     head; // most recently used (LRU)
+  uint32_t     tail; // least recently used (LRU)
+  uint32_t     free_head;
+  uint32_t     hand; // next node to check (CLOCK)
+  CCachePolicy policy;
+  void (*evict_fn)(void* key, void* value, void* user_data);
+  void* evict_user_data;
+} CCache;
+
+/// @brief create an empty cache that holds at most `capacity` entries
+/// @param key_size
+/// @param value_size
+/// @param capacity in range [1, UINT32_MAX)
+/// @param policy
+/// @param out_cache
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_cache_create(size_t       key_size,
+                             size_t       value_size,
+                             size_t       capacity,
+                             CCachePolicy policy,
+                             CCache*      out_cache);
+
+/// @brief `evict_fn` gets called with every entry pushed out of a full cache
+///        by `c_cache_put`, right before its node gets reused
+c_map_error_t c_cache_set_evict_fn(CCache* self,
+                                   void    evict_fn(void* key,
+                                                    void* value,
+                                                    void* user_data),
+                                   void*   user_data);
+
+/// @brief insert or update `key`, a full cache evicts an entry first
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_cache_put(CCache* self, void* key, void* value);
+
+/// @brief get the value of `key` and mark it as used
+/// @param out_value set to NULL if the key is not cached
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_cache_get(CCache* self, void* key, void** out_value);
+
+/// @brief same as `c_cache_get` but without marking the key as used
+c_map_error_t c_cache_peek(CCache const* self, void* key, void** out_value);
+
+/// @brief remove `key` without calling the evict function
+/// @param out_value valid till the next `c_cache_put`
+/// @return C_MAP_ERROR_key_not_found if the key is not cached
+c_map_error_t c_cache_remove(CCache* self, void* key, void** out_value);
+
+size_t c_cache_len(CCache const* self);
+
+void c_cache_clear(CCache* self,
+                   void    element_destroy_fn(void* key,
+                                              void* value,
+                                              void* user_data),
+                   void*   user_data);
+
+void c_cache_destroy(CCache* self,
+                     void    element_destroy_fn(void* key,
+                                                void* value,
+                                                void* user_data),
+                     void*   user_data);
+
+#endif // CSTDLIB_CACHE_H
+
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- implementation ---------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_CACHE_IMPLEMENTATION
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifndef C_CACHE_DONT_CHECK_PARAMS
+#define C_CACHE_CHECK_PARAMS(params)                                           \
+  if (!(params)) return C_MAP_ERROR_invalid_parameters;
+#else
+#define C_CACHE_CHECK_PARAMS(params) ((void)0)
+#endif
+
+#define C_CACHE_NIL UINT32_MAX
+
+typedef struct CCacheNode {
+  uint32_t prev;
+  uint32_t next; // next free node while on the free list
+  uint8_t  used;
+  uint8_t  referenced;
+} CCacheNode;
+
+static uint32_t c_internal_cache_victim(CCache* self);
+static void     c_internal_cache_evict(CCache* self, uint32_t victim);
+static void     c_internal_cache_link_front(CCache* self, uint32_t index);
+static void     c_internal_cache_unlink(CCache* self, uint32_t index);
+static void     c_internal_cache_touch(CCache* self, uint32_t index);
+static size_t   c_internal_cache_align(size_t size);
+static inline CCacheNode* c_internal_cache_get_node(CCache const* self,
+                                                    uint32_t      index);
+static inline void*       c_internal_cache_get_key(CCache const* self,
+                                                   uint32_t      index);
+static inline void*       c_internal_cache_get_value(CCache const* self,
+                                                     uint32_t      index);
+
+c_map_error_t
+c_cache_create(size_t       key_size,
+               size_t       value_size,
+               size_t       capacity,
+               CCachePolicy policy,
+               CCache*      out_cache)
+{
+  C_CACHE_CHECK_PARAMS(key_size > 0);
+  C_CACHE_CHECK_PARAMS(capacity > 0 && capacity < C_CACHE_NIL);
+  C_CACHE_CHECK_PARAMS(policy == C_CACHE_POLICY_LRU
+                       || policy == C_CACHE_POLICY_CLOCK);
+
+  if (!out_cache) { return C_MAP_ERROR_none; }
+
+  *out_cache = (CCache){0};
+
+  // enough buckets to hold `capacity + 1` keys under the default max load
+  // factor, and no shrinking, so the map never resizes
+  size_t        keys = capacity + 1;
+  c_map_error_t err  = c_map_create_with_capacity(
+      key_size, sizeof(uint32_t), keys + (keys / 7) + 1, &out_cache->map);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+  err = c_map_set_load_factors(&out_cache->map, CMAP_DEFAULT_MAX_LOAD_FACTOR,
+                               0.0f);
+  assert(err.code == C_MAP_ERROR_none.code);
+
+  out_cache->key_size     = key_size;
+  out_cache->value_size   = value_size;
+  out_cache->value_offset = c_internal_cache_align(sizeof(CCacheNode))
+                            + c_internal_cache_align(key_size);
+  out_cache->node_size
+      = out_cache->value_offset + c_internal_cache_align(value_size);
+
+  out_cache->nodes = malloc(capacity * out_cache->node_size);
+  if (!out_cache->nodes) {
+    c_map_destroy(&out_cache->map, NULL, NULL);
+    *out_cache = (CCache){0};
+    return C_MAP_ERROR_mem_allocation;
+  }
+
+  out_cache->capacity = capacity;
+  out_cache->policy   = policy;
+  c_cache_clear(out_cache, NULL, NULL);
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_cache_set_evict_fn(CCache* self,
+                     void    evict_fn(void* key, void* value, void* user_data),
+                     void*   user_data)
+{
+  C_CACHE_CHECK_PARAMS(self && self->nodes);
+
+  self->evict_fn        = evict_fn;
+  self->evict_user_data = user_data;
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_cache_put(CCache* self, void* key, void* value)
+{
+  C_CACHE_CHECK_PARAMS(self && self->nodes);
+
+  if (!key || (!value && self->value_size)) { return C_MAP_ERROR_none; }
+
+  // a single probe for both the hit and the miss
+  uint32_t*     index    = NULL;
+  bool          inserted = false;
+  c_map_error_t err
+      = c_map_get_or_insert(&self->map, key, (void**)&index, &inserted);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  if (!inserted) {
+    memcpy(c_internal_cache_get_value(self, *index), value, self->value_size);
+    c_internal_cache_touch(self, *index);
+    return C_MAP_ERROR_none;
+  }
+
+  // a full cache hands the victim's node over, `index` is set before the
+  // victim's key gets removed from the map since that invalidates it
+  if (self->len == self->capacity) {
+    uint32_t victim = c_internal_cache_victim(self);
+    *index          = victim;
+    c_internal_cache_evict(self, victim);
+  } else {
+    *index = self->free_head;
+  }
+
+  uint32_t    new_index = self->free_head;
+  CCacheNode* node      = c_internal_cache_get_node(self, new_index);
+  self->free_head  = node->next;
+  node->used       = 1;
+  node->referenced = 1;
+  memcpy(c_internal_cache_get_key(self, new_index), key, self->key_size);
+  if (value) {
+    memcpy(c_internal_cache_get_value(self, new_index), value,
+           self->value_size);
+  }
+  c_internal_cache_link_front(self, new_index);
+  self->len++;
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_cache_get(CCache* self, void* key, void** out_value)
+{
+  C_CACHE_CHECK_PARAMS(self && self->nodes);
+
+  if (!key || !out_value) { return C_MAP_ERROR_none; }
+
+  *out_value = NULL;
+
+  uint32_t*     index = NULL;
+  c_map_error_t err   = c_map_get(&self->map, key, (void**)&index);
+  if (err.code != C_MAP_ERROR_none.code || !index) { return err; }
+
+  c_internal_cache_touch(self, *index);
+  *out_value = c_internal_cache_get_value(self, *index);
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_cache_peek(CCache const* self, void* key, void** out_value)
+{
+  C_CACHE_CHECK_PARAMS(self && self->nodes);
+
+  if (!key || !out_value) { return C_MAP_ERROR_none; }
+
+  *out_value = NULL;
+
+  uint32_t*     index = NULL;
+  c_map_error_t err   = c_map_get(&self->map, key, (void**)&index);
+  if (err.code != C_MAP_ERROR_none.code || !index) { return err; }
+
+  *out_value = c_internal_cache_get_value(self, *index);
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_cache_remove(CCache* self, void* key, void** out_value)
+{
+  C_CACHE_CHECK_PARAMS(self && self->nodes);
+
+  if (!key || !out_value) { return C_MAP_ERROR_none; }
+
+  uint32_t*     index = NULL;
+  c_map_error_t err   = c_map_remove(&self->map, key, (void**)&index);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  uint32_t    removed_index = *index;
+  CCacheNode* node          = c_internal_cache_get_node(self, removed_index);
+  c_internal_cache_unlink(self, removed_index);
+  node->used      = 0;
+  node->next      = self->free_head;
+  self->free_head = removed_index;
+  self->len--;
+
+  *out_value = c_internal_cache_get_value(self, removed_index);
+
+  return C_MAP_ERROR_none;
+}
+
+size_t
+c_cache_len(CCache const* self)
+{
+  return self->len;
+}
+
+void
+c_cache_clear(CCache* self,
+              void    element_destroy_fn(void* key,
+                                         void* value,
+                                         void* user_data),
+              void*   user_data)
+{
+  for (uint32_t iii = 0; iii < self->capacity; ++iii) {
+    CCacheNode* node = c_internal_cache_get_node(self, iii);
+    if (element_destroy_fn && node->used) {
+      element_destroy_fn(c_internal_cache_get_key(self, iii),
+                         c_internal_cache_get_value(self, iii), user_data);
+    }
+
+    *node = (CCacheNode){
+        .prev = C_CACHE_NIL,
+        .next = (iii + 1 < self->capacity) ? (iii + 1) : C_CACHE_NIL,
+    };
+  }
+
+  c_map_clear(&self->map, NULL, NULL);
+  self->len       = 0;
+  self->head      = C_CACHE_NIL;
+  self->tail      = C_CACHE_NIL;
+  self->free_head = 0;
+  self->hand      = 0;
+}
+
+void
+c_cache_destroy(CCache* self,
+                void    element_destroy_fn(void* key,
+                                           void* value,
+                                           void* user_data),
+                void*   user_data)
+{
+  if (self && self->nodes) {
+    if (element_destroy_fn) {
+      c_cache_clear(self, element_destroy_fn, user_data);
+    }
+    c_map_destroy(&self->map, NULL, NULL);
+    free(self->nodes);
+    *self = (CCache){0};
+  }
+}
+
+// ------------------------- internal ------------------------- //
+
+uint32_t
+c_internal_cache_victim(CCache* self)
+{
+  uint32_t victim = self->tail;
+
+  if (self->policy == C_CACHE_POLICY_CLOCK) {
+    // the cache is full so every node is used, a referenced one gets a
+    // second chance, at most one sweep is needed
+    for (;;) {
+      CCacheNode* node = c_internal_cache_get_node(self, self->hand);
+      victim           = self->hand;
+      self->hand       = (self->hand + 1 < self->capacity) ? self->hand + 1 : 0;
+      if (!node->referenced) break;
+      node->referenced = 0;
+    }
+  }
+
+  return victim;
+}
+
+void
+c_internal_cache_evict(CCache* self, uint32_t victim)
+{
+  void*         key   = c_internal_cache_get_key(self, victim);
+  void*         value = NULL;
+  c_map_error_t err   = c_map_remove(&self->map, key, &value);
+  assert(err.code == C_MAP_ERROR_none.code);
+  (void)err;
+
+  if (self->evict_fn) {
+    self->evict_fn(key, c_internal_cache_get_value(self, victim),
+                   self->evict_user_data);
+  }
+
+  CCacheNode* node = c_internal_cache_get_node(self, victim);
+  c_internal_cache_unlink(self, victim);
+  node->used      = 0;
+  node->next      = self->free_head;
+  self->free_head = victim;
+  self->len--;
+}
+
+void
+c_internal_cache_link_front(CCache* self, uint32_t index)
+{
+  if (self->policy != C_CACHE_POLICY_LRU) return;
+
+  CCacheNode* node = c_internal_cache_get_node(self, index);
+  node->prev       = C_CACHE_NIL;
+  node->next       = self->head;
+  if (self->head != C_CACHE_NIL) {
+    c_internal_cache_get_node(self, self->head)->prev = index;
+  } else {
+    self->tail = index;
+  }
+  self->head = index;
+}
+
+void
+c_internal_cache_unlink(CCache* self, uint32_t index)
+{
+  if (self->policy != C_CACHE_POLICY_LRU) return;
+
+  CCacheNode* node = c_internal_cache_get_node(self, index);
+  if (node->prev != C_CACHE_NIL) {
+    c_internal_cache_get_node(self, node->prev)->next = node->next;
+  } else {
+    self->head = node->next;
+  }
+  if (node->next != C_CACHE_NIL) {
+    c_internal_cache_get_node(self, node->next)->prev = node->prev;
+  } else {
+    self->tail = node->prev;
+  }
+}
+
+void
+c_internal_cache_touch(CCache* self, uint32_t index)
+{
+  if (self->policy == C_CACHE_POLICY_CLOCK) {
+    c_internal_cache_get_node(self, index)->referenced = 1;
+  } else if (self->head != index) {
+    c_internal_cache_unlink(self, index);
+    c_internal_cache_link_front(self, index);
+  }
+}
+
+size_t
+c_internal_cache_align(size_t size)
+{
+  size_t const alignment = sizeof(uint64_t);
+  return (size + (alignment - 1)) & ~(alignment - 1);
+}
+
+CCacheNode*
+c_internal_cache_get_node(CCache const* self, uint32_t index)
+{
+  return (CCacheNode*)((char*)self->nodes + (self->node_size * index));
+}
+
+void*
+c_internal_cache_get_key(CCache const* self, uint32_t index)
+{
+  return (char*)c_internal_cache_get_node(self, index)
+         + c_internal_cache_align(sizeof(CCacheNode));
+}
+
+void*
+c_internal_cache_get_value(CCache const* self, uint32_t index)
+{
+  return (char*)c_internal_cache_get_node(self, index) + self->value_offset;
+}
+
+#undef C_CACHE_NIL
+#undef C_CACHE_CHECK_PARAMS
+#undef CSTDLIB_CACHE_IMPLEMENTATION
+#endif // CSTDLIB_CACHE_IMPLEMENTATION
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_CACHE_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#define CSTDLIB_MAP_IMPLEMENTATION
+#include "map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CACHE_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define CACHE_TEST(err)                                                        \
+  ((err.code != C_MAP_ERROR_none.code) ? CACHE_TEST_PRINT_ABORT(err.desc)      \
+                                       : (void)0)
+#define CACHE_ASSERT(cond) (!(cond)) ? CACHE_TEST_PRINT_ABORT(#cond) : (void)0
+
+static void
+cache_test_count_evictions(void* key, void* value, void* user_data)
+{
+  (void)key;
+  (void)value;
+  (*(int*)user_data)++;
+}
+
+int
+main(void)
+{
+  c_map_error_t err = C_MAP_ERROR_none;
+
+  // test: lru
+  {
+    CCache cache;
+    err = c_cache_create(sizeof(int), sizeof(int), 3, C_CACHE_POLICY_LRU,
+                         &cache);
+    CACHE_TEST(err);
+    int evictions = 0;
+    err = c_cache_set_evict_fn(&cache, cache_test_count_evictions, &evictions);
+    CACHE_TEST(err);
+
+    for (int iii = 0; iii < 3; ++iii) {
+      err = c_cache_put(&cache, &iii, &(int){iii * 10});
+      CACHE_TEST(err);
+    }
+
+    // 0 becomes the most recently used, so 1 goes first
+    int* value = NULL;
+    err        = c_cache_get(&cache, &(int){0}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(value && *value == 0);
+
+    err = c_cache_put(&cache, &(int){3}, &(int){30});
+    CACHE_TEST(err);
+    CACHE_ASSERT(evictions == 1);
+    CACHE_ASSERT(c_cache_len(&cache) == 3);
+    err = c_cache_peek(&cache, &(int){1}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(!value);
+
+    // updating refreshes too, 2 is the least recently used now
+    err = c_cache_put(&cache, &(int){0}, &(int){-1});
+    CACHE_TEST(err);
+    err = c_cache_put(&cache, &(int){4}, &(int){40});
+    CACHE_TEST(err);
+    CACHE_ASSERT(evictions == 2);
+    err = c_cache_peek(&cache, &(int){2}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(!value);
+    err = c_cache_get(&cache, &(int){0}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(value && *value == -1);
+
+    err = c_cache_remove(&cache, &(int){3}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(*value == 30);
+    CACHE_ASSERT(c_cache_len(&cache) == 2);
+    err = c_cache_remove(&cache, &(int){3}, (void**)&value);
+    CACHE_ASSERT(err.code == C_MAP_ERROR_key_not_found.code);
+
+    // a lot of churn, the map must not grow
+    size_t map_capacity = cache.map.capacity;
+    for (int iii = 100; iii < 1100; ++iii) {
+      err = c_cache_put(&cache, &iii, &iii);
+      CACHE_TEST(err);
+    }
+    CACHE_ASSERT(c_cache_len(&cache) == 3);
+    CACHE_ASSERT(cache.map.capacity == map_capacity);
+    for (int iii = 1097; iii < 1100; ++iii) {
+      err = c_cache_peek(&cache, &iii, (void**)&value);
+      CACHE_TEST(err);
+      CACHE_ASSERT(value && *value == iii);
+    }
+
+    int destroyed = 0;
+    c_cache_destroy(&cache, cache_test_count_evictions, &destroyed);
+    CACHE_ASSERT(destroyed == 3);
+  }
+
+  // test: clock
+  {
+    CCache cache;
+    err = c_cache_create(sizeof(int), sizeof(int), 4, C_CACHE_POLICY_CLOCK,
+                         &cache);
+    CACHE_TEST(err);
+
+    for (int iii = 0; iii < 4; ++iii) {
+      err = c_cache_put(&cache, &iii, &iii);
+      CACHE_TEST(err);
+    }
+
+    // every node is referenced, the first sweep clears them and the hand
+    // comes back to the first node
+    err = c_cache_put(&cache, &(int){4}, &(int){4});
+    CACHE_TEST(err);
+    int* value = NULL;
+    err        = c_cache_peek(&cache, &(int){0}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(!value);
+
+    // 1 is used again so it gets a second chance, 2 is evicted instead
+    err = c_cache_get(&cache, &(int){1}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(value && *value == 1);
+    err = c_cache_put(&cache, &(int){5}, &(int){5});
+    CACHE_TEST(err);
+    err = c_cache_peek(&cache, &(int){1}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(value && *value == 1);
+    err = c_cache_peek(&cache, &(int){2}, (void**)&value);
+    CACHE_TEST(err);
+    CACHE_ASSERT(!value);
+    CACHE_ASSERT(c_cache_len(&cache) == 4);
+
+    c_cache_destroy(&cache, NULL, NULL);
+  }
+}
+
+#ifdef NDEBUG_
+#define NDEBUG
+#undef NDEBUG_
+#endif
+
+#undef CACHE_TEST_PRINT_ABORT
+#undef CACHE_TEST
+#undef CACHE_ASSERT
+#undef CSTDLIB_CACHE_UNIT_TESTS
+#endif // CSTDLIB_CACHE_UNIT_TESTS
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Mohamed A. Elmeligy
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions: The above copyright
+ * notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS",
+ * WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,12 @@
+function(create_bench_target target)
+    string(TOUPPER ${target} target_upper)
+    if(NOT EXISTS "${CMAKE_BINARY_DIR}/bench_${target}.c")
+        file(WRITE "${CMAKE_BINARY_DIR}/bench_${target}.c"
+            "#define CSTDLIB_${target_upper}_IMPLEMENTATION\n"
+            "#define CSTDLIB_${target_upper}_BENCHMARKS\n"
+            "#include \"${target}.h\"\n")
+    endif()
+
+    add_executable(bench_${target} bench_${target}.c ${target}.h)
+    target_include_directories(bench_${target} PRIVATE ${CMAKE_CURRENT_SOURCE_DIR})
+endfunction()
@@ -13,4 +13,16 @@ function(create_test_target target)
         COMMAND test_${target}
         WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
     )
-endfunction()
\ No newline at end of file
+endfunction()
+
+# the tests of `target` built once more with extra compile definitions (ARGN),
+# create_test_target(target) has to be called first
+function(create_test_target_variant target variant)
+    add_executable(test_${target}_${variant} ${target}.c ${target}.h)
+    target_include_directories(test_${target}_${variant} PRIVATE ${CMAKE_CURRENT_SOURCE_DIR})
+    target_compile_definitions(test_${target}_${variant} PRIVATE ${ARGN})
+    add_test(NAME test_${target}_${variant}
+        COMMAND test_${target}_${variant}
+        WORKING_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR}
+    )
+endfunction()
@@ -0,0 +1,710 @@
+/* How To  : To use this module, do this in *ONE* C file:
+ *              #define CSTDLIB_CONCURRENT_MAP_IMPLEMENTATION
+ *              #include "concurrent_map.h"
+ *           it depends on "map.h", so CSTDLIB_MAP_IMPLEMENTATION has to be
+ *           defined in one C file as well
+ * Tests   : To use run test, do this in *ONE* C file:
+ *              #define CSTDLIB_CONCURRENT_MAP_UNIT_TESTS
+ *              #include "concurrent_map.h"
+ * Options :
+ *           - C_CONCURRENT_MAP_DONT_CHECK_PARAMS: parameters will not get
+ *                                                 checked
+ *                                                 (this is off by default)
+ * Notes   : the keys are spread over shards, each shard is a CMap guarded by
+ *           its own writer lock and a sequence counter. readers never lock,
+ *           they copy the value out and retry if a writer touched the shard
+ *           in the meantime. because of that tables replaced by a resize are
+ *           only freed by `c_concurrent_map_destroy` (shards never shrink, so
+ *           this is less than the memory of the live tables)
+ * License : MIT (go to the end of this file for details)
+ */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- header -------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifndef CSTDLIB_CONCURRENT_MAP_H
+#define CSTDLIB_CONCURRENT_MAP_H
+
+#include "map.h"
+
+#define CCONCURRENT_MAP_DEFAULT_SHARDS_COUNT 64U
+
+typedef struct CConcurrentMapShard {
+  unsigned long seq;  // odd while a writer is changing `map`
+  unsigned long lock; // writers lock, 1 when held
+  CMap          map;
+  CMap*         retired; // replaced tables, readers may still be in them
+  size_t        retired_len;
+  char          padding[64]; // keep shards' counters on separate cache lines
+} CConcurrentMapShard;
+
+typedef struct CConcurrentMap {
+  CConcurrentMapShard* shards;
+  size_t               shards_mask;
+  size_t               key_size;
+  size_t               value_size;
+} CConcurrentMap;
+
+/// @brief create a concurrent map
+/// @param key_size
+/// @param value_size
+/// @param shards_count number of independently locked shards, rounded up to
+///                     a power of 2 (0 means
+///                     CCONCURRENT_MAP_DEFAULT_SHARDS_COUNT)
+/// @param out_map
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_concurrent_map_create(size_t          key_size,
+                                      size_t          value_size,
+                                      size_t          shards_count,
+                                      CConcurrentMap* out_map);
+
+/// @brief insert or override a key, it locks the key's shard only
+/// @return error (any value but zero is treated as an error)
+c_map_error_t
+c_concurrent_map_insert(CConcurrentMap* self, void* key, void* value);
+
+/// @brief copy the value of `key` into `out_value` (`value_size` bytes),
+///        this never locks. unlike `c_map_get` no pointer is handed out as
+///        the bucket could be moved by another thread right after
+/// @return C_MAP_ERROR_key_not_found if the key doesn't exist
+c_map_error_t
+c_concurrent_map_get(CConcurrentMap* self, void* key, void* out_value);
+
+/// @brief remove `key` and copy its value into `out_value` (if not NULL)
+/// @return C_MAP_ERROR_key_not_found if the key doesn't exist
+c_map_error_t
+c_concurrent_map_remove(CConcurrentMap* self, void* key, void* out_value);
+
+/// @brief number of elements, this is only a snapshot while writers are
+///        active
+size_t c_concurrent_map_len(CConcurrentMap* self);
+
+/// @brief no other thread may use the map while it is being destroyed
+void c_concurrent_map_destroy(CConcurrentMap* self,
+                              void            element_destroy_fn(void* key,
+                                                      void* value,
+                                                      void* user_data),
+                              void*           user_data);
+
+#endif // CSTDLIB_CONCURRENT_MAP_H
+
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- implementation ---------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_CONCURRENT_MAP_IMPLEMENTATION
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996) // disable warning about unsafe functions
+#endif
+
+#ifndef C_CONCURRENT_MAP_DONT_CHECK_PARAMS
+#define C_CONCURRENT_MAP_CHECK_PARAMS(params)                                  \
+  if (!(params)) return C_MAP_ERROR_invalid_parameters;
+#else
+#define C_CONCURRENT_MAP_CHECK_PARAMS(params) ((void)0)
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define C_CONCURRENT_MAP_LOAD(ptr)                                             \
+  ((unsigned long)_InterlockedOr((long volatile*)(ptr), 0))
+#define C_CONCURRENT_MAP_STORE(ptr, value)                                     \
+  ((void)_InterlockedExchange((long volatile*)(ptr), (long)(value)))
+#define C_CONCURRENT_MAP_CAS(ptr, expected, desired)                           \
+  (_InterlockedCompareExchange((long volatile*)(ptr), (long)(desired),         \
+                               (long)(expected))                               \
+   == (long)(expected))
+#define C_CONCURRENT_MAP_FENCE() MemoryBarrier()
+#define C_CONCURRENT_MAP_YIELD() SwitchToThread()
+#else
+#define C_CONCURRENT_MAP_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define C_CONCURRENT_MAP_STORE(ptr, value)                                     \
+  __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define C_CONCURRENT_MAP_CAS(ptr, expected, desired)                           \
+  __atomic_compare_exchange_n((ptr), &(unsigned long){expected}, (desired),    \
+                              false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#define C_CONCURRENT_MAP_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define C_CONCURRENT_MAP_YIELD() sched_yield()
+#endif
+
+static CConcurrentMapShard*
+c_internal_concurrent_map_shard(CConcurrentMap* self, void const* key);
+static void c_internal_concurrent_map_lock(CConcurrentMapShard* shard);
+static void c_internal_concurrent_map_unlock(CConcurrentMapShard* shard);
+static void c_internal_concurrent_map_write_begin(CConcurrentMapShard* shard);
+static void c_internal_concurrent_map_write_end(CConcurrentMapShard* shard);
+static c_map_error_t
+c_internal_concurrent_map_grow(CConcurrentMap*      self,
+                               CConcurrentMapShard* shard);
+static c_map_error_t c_internal_concurrent_map_create_shard_map(
+    CConcurrentMap* self, size_t capacity, CMap* out_map);
+
+c_map_error_t
+c_concurrent_map_create(size_t          key_size,
+                        size_t          value_size,
+                        size_t          shards_count,
+                        CConcurrentMap* out_map)
+{
+  C_CONCURRENT_MAP_CHECK_PARAMS(key_size > 0);
+  C_CONCURRENT_MAP_CHECK_PARAMS(value_size > 0);
+
+  if (!out_map) { return C_MAP_ERROR_none; }
+
+  *out_map = (CConcurrentMap){0};
+
+  if (shards_count == 0) {
+    shards_count = CCONCURRENT_MAP_DEFAULT_SHARDS_COUNT;
+  }
+  size_t aligned_shards_count = 1;
+  while (aligned_shards_count < shards_count) {
+    aligned_shards_count *= 2;
+  }
+
+  out_map->shards = calloc(aligned_shards_count, sizeof(CConcurrentMapShard));
+  if (!out_map->shards) { return C_MAP_ERROR_mem_allocation; }
+
+  out_map->shards_mask = aligned_shards_count - 1;
+  out_map->key_size    = key_size;
+  out_map->value_size  = value_size;
+
+  for (size_t iii = 0; iii < aligned_shards_count; ++iii) {
+    c_map_error_t err = c_internal_concurrent_map_create_shard_map(
+        out_map, CMAP_DEFAULT_CAPACITY, &out_map->shards[iii].map);
+    if (err.code != C_MAP_ERROR_none.code) {
+      c_concurrent_map_destroy(out_map, NULL, NULL);
+      return err;
+    }
+  }
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_concurrent_map_insert(CConcurrentMap* self, void* key, void* value)
+{
+  C_CONCURRENT_MAP_CHECK_PARAMS(self && self->shards);
+
+  if (!key || !value) { return C_MAP_ERROR_none; }
+
+  CConcurrentMapShard* shard = c_internal_concurrent_map_shard(self, key);
+  c_internal_concurrent_map_lock(shard);
+
+  c_map_error_t err = C_MAP_ERROR_none;
+  if (shard->map.len >= shard->map.load_factor.grow_len) {
+    err = c_internal_concurrent_map_grow(self, shard);
+  }
+
+  // the shard map never resizes by itself, its buckets can't be freed under
+  // a reader
+  if (err.code == C_MAP_ERROR_none.code) {
+    c_internal_concurrent_map_write_begin(shard);
+    err = c_map_insert(&shard->map, key, value);
+    c_internal_concurrent_map_write_end(shard);
+  }
+
+  c_internal_concurrent_map_unlock(shard);
+
+  return err;
+}
+
+c_map_error_t
+c_concurrent_map_get(CConcurrentMap* self, void* key, void* out_value)
+{
+  C_CONCURRENT_MAP_CHECK_PARAMS(self && self->shards);
+
+  if (!key || !out_value) { return C_MAP_ERROR_none; }
+
+  CConcurrentMapShard* shard = c_internal_concurrent_map_shard(self, key);
+
+  for (;;) {
+    unsigned long seq = C_CONCURRENT_MAP_LOAD(&shard->seq);
+    if (seq & 1) {
+      C_CONCURRENT_MAP_YIELD();
+      continue;
+    }
+
+    // [1] take a consistent copy of the map header
+    CMap map;
+    memcpy(&map, &shard->map, sizeof(map));
+    C_CONCURRENT_MAP_FENCE();
+    if (C_CONCURRENT_MAP_LOAD(&shard->seq) != seq) continue;
+
+    // [2] probe it, its buckets stay allocated even if replaced meanwhile
+    void* value = NULL;
+    c_map_get(&map, key, &value);
+    if (value) { memcpy(out_value, value, self->value_size); }
+
+    // [3] make sure no writer touched the shard while we were reading
+    C_CONCURRENT_MAP_FENCE();
+    if (C_CONCURRENT_MAP_LOAD(&shard->seq) != seq) continue;
+
+    return value ? C_MAP_ERROR_none : C_MAP_ERROR_key_not_found;
+  }
+}
+
+c_map_error_t
+c_concurrent_map_remove(CConcurrentMap* self, void* key, void* out_value)
+{
+  C_CONCURRENT_MAP_CHECK_PARAMS(self && self->shards);
+
+  if (!key) { return C_MAP_ERROR_none; }
+
+  CConcurrentMapShard* shard = c_internal_concurrent_map_shard(self, key);
+  c_internal_concurrent_map_lock(shard);
+
+  // the shard map never shrinks (see
+  // `c_internal_concurrent_map_create_shard_map`), so removing only moves
+  // buckets within a table that stays allocated under the readers
+  c_internal_concurrent_map_write_begin(shard);
+  void*         value = NULL;
+  c_map_error_t err   = c_map_remove(&shard->map, key, &value);
+  if (err.code == C_MAP_ERROR_none.code && out_value) {
+    memcpy(out_value, value, self->value_size);
+  }
+  c_internal_concurrent_map_write_end(shard);
+
+  c_internal_concurrent_map_unlock(shard);
+
+  return err;
+}
+
+size_t
+c_concurrent_map_len(CConcurrentMap* self)
+{
+  size_t len = 0;
+  for (size_t iii = 0; iii <= self->shards_mask; ++iii) {
+    len += *(size_t volatile*)&self->shards[iii].map.len;
+  }
+
+  return len;
+}
+
+void
+c_concurrent_map_destroy(CConcurrentMap* self,
+                         void            element_destroy_fn(void* key,
+                                                 void* value,
+                                                 void* user_data),
+                         void*           user_data)
+{
+  if (self && self->shards) {
+    for (size_t iii = 0; iii <= self->shards_mask; ++iii) {
+      CConcurrentMapShard* shard = &self->shards[iii];
+
+      c_map_destroy(&shard->map, element_destroy_fn, user_data);
+      // retired tables hold stale copies only
+      for (size_t jjj = 0; jjj < shard->retired_len; ++jjj) {
+        c_map_destroy(&shard->retired[jjj], NULL, NULL);
+      }
+      free(shard->retired);
+    }
+
+    free(self->shards);
+    *self = (CConcurrentMap){0};
+  }
+}
+
+// ------------------------- internal ------------------------- //
+
+CConcurrentMapShard*
+c_internal_concurrent_map_shard(CConcurrentMap* self, void const* key)
+{
+  // FNV-1a as CMap does, but the shard comes from the top 16 bits which
+  // CMap drops, so the shard's own buckets still get evenly used
+  uint64_t       hash  = 14695981039346656037U;
+  uint8_t const* bytes = (uint8_t const*)key;
+  for (size_t iii = 0; iii < self->key_size; ++iii) {
+    hash ^= bytes[iii];
+    hash *= 1099511628211U;
+  }
+
+  return &self->shards[(size_t)(hash >> 48) & self->shards_mask];
+}
+
+void
+c_internal_concurrent_map_lock(CConcurrentMapShard* shard)
+{
+  while (!C_CONCURRENT_MAP_CAS(&shard->lock, 0UL, 1UL)) {
+    C_CONCURRENT_MAP_YIELD();
+  }
+}
+
+void
+c_internal_concurrent_map_unlock(CConcurrentMapShard* shard)
+{
+  C_CONCURRENT_MAP_STORE(&shard->lock, 0UL);
+}
+
+void
+c_internal_concurrent_map_write_begin(CConcurrentMapShard* shard)
+{
+  // only the lock holder changes `seq`
+  C_CONCURRENT_MAP_STORE(&shard->seq, shard->seq + 1);
+  C_CONCURRENT_MAP_FENCE();
+}
+
+void
+c_internal_concurrent_map_write_end(CConcurrentMapShard* shard)
+{
+  C_CONCURRENT_MAP_FENCE();
+  C_CONCURRENT_MAP_STORE(&shard->seq, shard->seq + 1);
+}
+
+c_map_error_t
+c_internal_concurrent_map_grow(CConcurrentMap* self, CConcurrentMapShard* shard)
+{
+  CMap*         retired = NULL;
+  CMap          new_map = {0};
+  c_map_error_t err     = c_internal_concurrent_map_create_shard_map(
+      self, shard->map.capacity * 2, &new_map);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  // readers keep using the current table while the new one is filled
+  size_t iter = 0;
+  void*  key;
+  void*  value;
+  while (c_map_iter(&shard->map, &iter, &key, &value)) {
+    err = c_map_insert(&new_map, key, value);
+    if (err.code != C_MAP_ERROR_none.code) { goto on_error; }
+  }
+
+  retired = realloc(shard->retired, (shard->retired_len + 1) * sizeof(CMap));
+  if (!retired) {
+    err = C_MAP_ERROR_mem_allocation;
+    goto on_error;
+  }
+  shard->retired                      = retired;
+  shard->retired[shard->retired_len++] = shard->map;
+
+  c_internal_concurrent_map_write_begin(shard);
+  shard->map = new_map;
+  c_internal_concurrent_map_write_end(shard);
+
+  return C_MAP_ERROR_none;
+
+on_error:
+  c_map_destroy(&new_map, NULL, NULL);
+  return err;
+}
+
+c_map_error_t
+c_internal_concurrent_map_create_shard_map(CConcurrentMap* self,
+                                           size_t          capacity,
+                                           CMap*           out_map)
+{
+  c_map_error_t err = c_map_create_with_capacity(
+      self->key_size, self->value_size, capacity, out_map);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  // growing is done by `c_internal_concurrent_map_grow` and a min load
+  // factor of 0 never shrinks, readers may be probing the table while a
+  // writer removes from it so it must never be freed by `c_map_remove`
+  return c_map_set_load_factors(out_map, CMAP_DEFAULT_MAX_LOAD_FACTOR, 0.0f);
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#undef C_CONCURRENT_MAP_LOAD
+#undef C_CONCURRENT_MAP_STORE
+#undef C_CONCURRENT_MAP_CAS
+#undef C_CONCURRENT_MAP_FENCE
+#undef C_CONCURRENT_MAP_YIELD
+#undef C_CONCURRENT_MAP_CHECK_PARAMS
+#undef CSTDLIB_CONCURRENT_MAP_IMPLEMENTATION
+#endif // CSTDLIB_CONCURRENT_MAP_IMPLEMENTATION
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_CONCURRENT_MAP_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#define CSTDLIB_MAP_IMPLEMENTATION
+#include "map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#define CONCURRENT_MAP_TEST_PRINT_ABORT(msg)                                   \
+  (fprintf(stderr, "%s\n", msg), abort())
+#define CONCURRENT_MAP_TEST(err)                                               \
+  ((err.code != C_MAP_ERROR_none.code)                                         \
+       ? CONCURRENT_MAP_TEST_PRINT_ABORT(err.desc)                             \
+       : (void)0)
+#define CONCURRENT_MAP_ASSERT(cond)                                            \
+  (!(cond)) ? CONCURRENT_MAP_TEST_PRINT_ABORT(#cond) : (void)0
+
+enum {
+  CONCURRENT_MAP_THREADS         = 4,
+  CONCURRENT_MAP_KEYS_PER_THREAD = 5000,
+  CONCURRENT_MAP_CHURN_KEYS      = 64,
+  CONCURRENT_MAP_CHURN_ROUNDS    = 20000,
+  CONCURRENT_MAP_CHURN_READS     = 1000000,
+};
+
+typedef struct CConcurrentMapTestData {
+  CConcurrentMap* map;
+  size_t          thread_index;
+} CConcurrentMapTestData;
+
+#ifdef _WIN32
+typedef HANDLE                 CConcurrentMapTestThread;
+typedef LPTHREAD_START_ROUTINE CConcurrentMapTestThreadFn;
+#define CONCURRENT_MAP_TEST_THREAD_FN static DWORD WINAPI
+#else
+typedef pthread_t CConcurrentMapTestThread;
+typedef void* (*CConcurrentMapTestThreadFn)(void* param);
+#define CONCURRENT_MAP_TEST_THREAD_FN static void*
+#endif
+
+static void concurrent_map_test_spawn(CConcurrentMapTestThread*  thread,
+                                      CConcurrentMapTestThreadFn fn,
+                                      void*                      param);
+static void concurrent_map_test_join(CConcurrentMapTestThread thread);
+
+CONCURRENT_MAP_TEST_THREAD_FN
+concurrent_map_test_worker(void* param)
+{
+  CConcurrentMapTestData* data = param;
+  size_t const first = data->thread_index * CONCURRENT_MAP_KEYS_PER_THREAD;
+
+  for (size_t iii = first; iii < first + CONCURRENT_MAP_KEYS_PER_THREAD;
+       ++iii) {
+    c_map_error_t err
+        = c_concurrent_map_insert(data->map, &iii, &(size_t){iii + 1});
+    CONCURRENT_MAP_TEST(err);
+
+    // read back one of ours and one from the other threads' ranges
+    size_t value = 0;
+    err          = c_concurrent_map_get(data->map, &iii, &value);
+    CONCURRENT_MAP_TEST(err);
+    CONCURRENT_MAP_ASSERT(value == iii + 1);
+
+    size_t other = (iii * 7) % (CONCURRENT_MAP_THREADS
+                                * CONCURRENT_MAP_KEYS_PER_THREAD);
+    err          = c_concurrent_map_get(data->map, &other, &value);
+    CONCURRENT_MAP_ASSERT(err.code == C_MAP_ERROR_key_not_found.code
+                          || value == other + 1);
+  }
+
+  // remove the odd keys
+  for (size_t iii = first + 1; iii < first + CONCURRENT_MAP_KEYS_PER_THREAD;
+       iii += 2) {
+    size_t        value = 0;
+    c_map_error_t err   = c_concurrent_map_remove(data->map, &iii, &value);
+    CONCURRENT_MAP_TEST(err);
+    CONCURRENT_MAP_ASSERT(value == iii + 1);
+  }
+
+  return 0;
+}
+
+// fill the map then empty it again, over and over
+CONCURRENT_MAP_TEST_THREAD_FN
+concurrent_map_test_churn(void* param)
+{
+  CConcurrentMap* map = param;
+
+  for (size_t round = 0; round < CONCURRENT_MAP_CHURN_ROUNDS; ++round) {
+    for (size_t iii = 0; iii < CONCURRENT_MAP_CHURN_KEYS; ++iii) {
+      c_map_error_t err = c_concurrent_map_insert(map, &iii, &(size_t){~iii});
+      CONCURRENT_MAP_TEST(err);
+    }
+    for (size_t iii = 0; iii < CONCURRENT_MAP_CHURN_KEYS; ++iii) {
+      c_map_error_t err = c_concurrent_map_remove(map, &iii, NULL);
+      CONCURRENT_MAP_TEST(err);
+    }
+  }
+
+  return 0;
+}
+
+CONCURRENT_MAP_TEST_THREAD_FN
+concurrent_map_test_reader(void* param)
+{
+  CConcurrentMap* map = param;
+
+  for (size_t iii = 0; iii < CONCURRENT_MAP_CHURN_READS; ++iii) {
+    size_t        key   = iii % CONCURRENT_MAP_CHURN_KEYS;
+    size_t        value = 0;
+    c_map_error_t err   = c_concurrent_map_get(map, &key, &value);
+    CONCURRENT_MAP_ASSERT(err.code == C_MAP_ERROR_key_not_found.code
+                          || value == ~key);
+  }
+
+  return 0;
+}
+
+int
+main(void)
+{
+  c_map_error_t err = C_MAP_ERROR_none;
+
+  // test: single thread
+  {
+    CConcurrentMap map;
+    err = c_concurrent_map_create(sizeof(int), sizeof(int), 3, &map);
+    CONCURRENT_MAP_TEST(err);
+    CONCURRENT_MAP_ASSERT(map.shards_mask == 3);
+
+    err = c_concurrent_map_insert(&map, &(int){1}, &(int){10});
+    CONCURRENT_MAP_TEST(err);
+    err = c_concurrent_map_insert(&map, &(int){2}, &(int){20});
+    CONCURRENT_MAP_TEST(err);
+    err = c_concurrent_map_insert(&map, &(int){1}, &(int){11});
+    CONCURRENT_MAP_TEST(err);
+    CONCURRENT_MAP_ASSERT(c_concurrent_map_len(&map) == 2);
+
+    int value = 0;
+    err       = c_concurrent_map_get(&map, &(int){1}, &value);
+    CONCURRENT_MAP_TEST(err);
+    CONCURRENT_MAP_ASSERT(value == 11);
+
+    err = c_concurrent_map_get(&map, &(int){3}, &value);
+    CONCURRENT_MAP_ASSERT(err.code == C_MAP_ERROR_key_not_found.code);
+
+    err = c_concurrent_map_remove(&map, &(int){2}, &value);
+    CONCURRENT_MAP_TEST(err);
+    CONCURRENT_MAP_ASSERT(value == 20);
+    err = c_concurrent_map_get(&map, &(int){2}, &value);
+    CONCURRENT_MAP_ASSERT(err.code == C_MAP_ERROR_key_not_found.code);
+
+    c_concurrent_map_destroy(&map, NULL, NULL);
+  }
+
+  // test: multiple threads
+  {
+    CConcurrentMap map;
+    err = c_concurrent_map_create(sizeof(size_t), sizeof(size_t), 0, &map);
+    CONCURRENT_MAP_TEST(err);
+
+    CConcurrentMapTestData   data[CONCURRENT_MAP_THREADS];
+    CConcurrentMapTestThread threads[CONCURRENT_MAP_THREADS];
+    for (size_t iii = 0; iii < CONCURRENT_MAP_THREADS; ++iii) {
+      data[iii] = (CConcurrentMapTestData){.map = &map, .thread_index = iii};
+      concurrent_map_test_spawn(&threads[iii], concurrent_map_test_worker,
+                                &data[iii]);
+    }
+    for (size_t iii = 0; iii < CONCURRENT_MAP_THREADS; ++iii) {
+      concurrent_map_test_join(threads[iii]);
+    }
+
+    size_t const count
+        = CONCURRENT_MAP_THREADS * CONCURRENT_MAP_KEYS_PER_THREAD;
+    CONCURRENT_MAP_ASSERT(c_concurrent_map_len(&map) == count / 2);
+    for (size_t iii = 0; iii < count; ++iii) {
+      size_t value = 0;
+      err          = c_concurrent_map_get(&map, &iii, &value);
+      if (iii % 2) {
+        CONCURRENT_MAP_ASSERT(err.code == C_MAP_ERROR_key_not_found.code);
+      } else {
+        CONCURRENT_MAP_TEST(err);
+        CONCURRENT_MAP_ASSERT(value == iii + 1);
+      }
+    }
+
+    c_concurrent_map_destroy(&map, NULL, NULL);
+  }
+
+  // test: readers while a single shard is filled and emptied, removing must
+  //       never free the table they are probing
+  {
+    CConcurrentMap map;
+    err = c_concurrent_map_create(sizeof(size_t), sizeof(size_t), 1, &map);
+    CONCURRENT_MAP_TEST(err);
+
+    CConcurrentMapTestThread threads[CONCURRENT_MAP_THREADS];
+    concurrent_map_test_spawn(&threads[0], concurrent_map_test_churn, &map);
+    for (size_t iii = 1; iii < CONCURRENT_MAP_THREADS; ++iii) {
+      concurrent_map_test_spawn(&threads[iii], concurrent_map_test_reader,
+                                &map);
+    }
+    for (size_t iii = 0; iii < CONCURRENT_MAP_THREADS; ++iii) {
+      concurrent_map_test_join(threads[iii]);
+    }
+    CONCURRENT_MAP_ASSERT(c_concurrent_map_len(&map) == 0);
+
+    c_concurrent_map_destroy(&map, NULL, NULL);
+  }
+}
+
+void
+concurrent_map_test_spawn(CConcurrentMapTestThread*  thread,
+                          CConcurrentMapTestThreadFn fn,
+                          void*                      param)
+{
+#ifdef _WIN32
+  *thread = CreateThread(NULL, 0, fn, param, 0, NULL);
+  CONCURRENT_MAP_ASSERT(*thread);
+#else
+  int status = pthread_create(thread, NULL, fn, param);
+  CONCURRENT_MAP_ASSERT(status == 0);
+#endif
+}
+
+void
+concurrent_map_test_join(CConcurrentMapTestThread thread)
+{
+#ifdef _WIN32
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+#else
+  pthread_join(thread, NULL);
+#endif
+}
+
+#ifdef NDEBUG_
+#define NDEBUG
+#undef NDEBUG_
+#endif
+
+#undef CONCURRENT_MAP_TEST_PRINT_ABORT
+#undef CONCURRENT_MAP_TEST
+#undef CONCURRENT_MAP_ASSERT
+#undef CONCURRENT_MAP_TEST_THREAD_FN
+#undef CSTDLIB_CONCURRENT_MAP_UNIT_TESTS
+#endif // CSTDLIB_CONCURRENT_MAP_UNIT_TESTS
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Mohamed A. Elmeligy
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions: The above copyright
+ * notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS",
+ * WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
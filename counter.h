@@ -0,0 +1,328 @@
+/* How To  : To use this module, do this in *ONE* C file:
+ *              #define CSTDLIB_COUNTER_IMPLEMENTATION
+ *              #include "counter.h"
+ *           it depends on "map.h", so CSTDLIB_MAP_IMPLEMENTATION has to be
+ *           defined in one C file as well
+ * Tests   : To use run test, do this in *ONE* C file:
+ *              #define CSTDLIB_COUNTER_UNIT_TESTS
+ *              #include "counter.h"
+ * Options :
+ *           - C_COUNTER_DONT_CHECK_PARAMS: parameters will not get checked
+ *                                          (this is off by default)
+ * Notes   : a CCounter is a CMap of int64_t counts, `c_counter_increment`
+ *           finds or inserts the key and bumps its count in a single probe
+ *           (see `c_map_get_or_insert`) instead of a get then an insert.
+ *           it is not thread safe, nothing here is atomic
+ * License : MIT (go to the end of this file for details)
+ */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- header -------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifndef CSTDLIB_COUNTER_H
+#define CSTDLIB_COUNTER_H
+
+#include "map.h"
+
+typedef struct CCounter {
+  CMap map; // key -> int64_t
+} CCounter;
+
+/// @brief create an empty counter
+/// @param key_size
+/// @param out_counter
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_counter_create(size_t key_size, CCounter* out_counter);
+
+/// @brief same as `c_counter_create` but with allocating capacity
+/// @param key_size
+/// @param capacity
+/// @param out_counter
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_counter_create_with_capacity(size_t    key_size,
+                                             size_t    capacity,
+                                             CCounter* out_counter);
+
+/// @brief add `delta` to the count of `key`, a missing key starts at 0
+/// @param out_count the new count (can be NULL)
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_counter_increment(CCounter* self,
+                                  void*     key,
+                                  int64_t   delta,
+                                  int64_t*  out_count);
+
+/// @brief get the count of `key`
+/// @param out_count set to 0 if the key is not counted
+/// @return error (any value but zero is treated as an error)
+c_map_error_t
+c_counter_get(CCounter const* self, void* key, int64_t* out_count);
+
+/// @brief remove `key`, a count dropping to 0 does not remove its key
+/// @return C_MAP_ERROR_key_not_found if the key doesn't exist
+c_map_error_t c_counter_remove(CCounter* self, void* key);
+
+/// @brief number of counted keys
+size_t c_counter_len(CCounter const* self);
+
+bool
+c_counter_iter(CCounter* self, size_t* iter, void** key, int64_t* out_count);
+
+void c_counter_clear(CCounter* self,
+                     void      key_destroy_fn(void* key, void* user_data),
+                     void*     user_data);
+
+void c_counter_destroy(CCounter* self,
+                       void      key_destroy_fn(void* key, void* user_data),
+                       void*     user_data);
+
+#endif // CSTDLIB_COUNTER_H
+
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- implementation ---------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_COUNTER_IMPLEMENTATION
+#include <stdlib.h>
+#include <string.h>
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifndef C_COUNTER_DONT_CHECK_PARAMS
+#define C_COUNTER_CHECK_PARAMS(params)                                         \
+  if (!(params)) return C_MAP_ERROR_invalid_parameters;
+#else
+#define C_COUNTER_CHECK_PARAMS(params) ((void)0)
+#endif
+
+c_map_error_t
+c_counter_create(size_t key_size, CCounter* out_counter)
+{
+  return c_counter_create_with_capacity(key_size, CMAP_DEFAULT_CAPACITY,
+                                        out_counter);
+}
+
+c_map_error_t
+c_counter_create_with_capacity(size_t    key_size,
+                               size_t    capacity,
+                               CCounter* out_counter)
+{
+  if (!out_counter) { return C_MAP_ERROR_none; }
+
+  *out_counter = (CCounter){0};
+
+  return c_map_create_with_capacity(key_size, sizeof(int64_t), capacity,
+                                    &out_counter->map);
+}
+
+c_map_error_t
+c_counter_increment(CCounter* self,
+                    void*     key,
+                    int64_t   delta,
+                    int64_t*  out_count)
+{
+  C_COUNTER_CHECK_PARAMS(self && key);
+
+  int64_t*      count = NULL;
+  c_map_error_t err
+      = c_map_get_or_insert(&self->map, key, (void**)&count, NULL);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  *count += delta;
+  if (out_count) { *out_count = *count; }
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_counter_get(CCounter const* self, void* key, int64_t* out_count)
+{
+  C_COUNTER_CHECK_PARAMS(self);
+
+  if (!out_count) { return C_MAP_ERROR_none; }
+  *out_count = 0;
+
+  int64_t*      count = NULL;
+  c_map_error_t err   = c_map_get(&self->map, key, (void**)&count);
+  if (count) { *out_count = *count; }
+
+  return err;
+}
+
+c_map_error_t
+c_counter_remove(CCounter* self, void* key)
+{
+  C_COUNTER_CHECK_PARAMS(self);
+
+  void* value = NULL;
+  return c_map_remove(&self->map, key, &value);
+}
+
+size_t
+c_counter_len(CCounter const* self)
+{
+  return c_map_len(&self->map);
+}
+
+bool
+c_counter_iter(CCounter* self, size_t* iter, void** key, int64_t* out_count)
+{
+  int64_t* count = NULL;
+  if (!c_map_iter(&self->map, iter, key, (void**)&count)) { return false; }
+
+  if (out_count) { *out_count = *count; }
+
+  return true;
+}
+
+void
+c_counter_clear(CCounter* self,
+                void      key_destroy_fn(void* key, void* user_data),
+                void*     user_data)
+{
+  if (key_destroy_fn) {
+    size_t iter = 0;
+    void*  key  = NULL;
+    while (c_counter_iter(self, &iter, &key, NULL)) {
+      key_destroy_fn(key, user_data);
+    }
+  }
+
+  c_map_clear(&self->map, NULL, NULL);
+}
+
+void
+c_counter_destroy(CCounter* self,
+                  void      key_destroy_fn(void* key, void* user_data),
+                  void*     user_data)
+{
+  if (self && self->map.buckets) {
+    if (key_destroy_fn) { c_counter_clear(self, key_destroy_fn, user_data); }
+    c_map_destroy(&self->map, NULL, NULL);
+  }
+}
+
+#undef C_COUNTER_CHECK_PARAMS
+#undef CSTDLIB_COUNTER_IMPLEMENTATION
+#endif // CSTDLIB_COUNTER_IMPLEMENTATION
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_COUNTER_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#define CSTDLIB_MAP_IMPLEMENTATION
+#include "map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define COUNTER_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define COUNTER_TEST(err)                                                      \
+  ((err.code != C_MAP_ERROR_none.code) ? COUNTER_TEST_PRINT_ABORT(err.desc)    \
+                                       : (void)0)
+#define COUNTER_ASSERT(cond)                                                   \
+  (!(cond)) ? COUNTER_TEST_PRINT_ABORT(#cond) : (void)0
+
+int
+main(void)
+{
+  c_map_error_t err = C_MAP_ERROR_none;
+
+  // test: word count
+  {
+    char const words[][8] = {"error", "warn", "error", "info", "error", "warn"};
+
+    CCounter counter;
+    err = c_counter_create(sizeof(*words), &counter);
+    COUNTER_TEST(err);
+
+    int64_t count = 0;
+    for (size_t iii = 0; iii < sizeof(words) / sizeof(*words); ++iii) {
+      err = c_counter_increment(&counter, (void*)words[iii], 1, &count);
+      COUNTER_TEST(err);
+    }
+    COUNTER_ASSERT(count == 2);
+    COUNTER_ASSERT(c_counter_len(&counter) == 3);
+
+    err = c_counter_get(&counter, (void*)words[0], &count);
+    COUNTER_TEST(err);
+    COUNTER_ASSERT(count == 3);
+
+    err = c_counter_increment(&counter, (void*)words[0], -3, &count);
+    COUNTER_TEST(err);
+    COUNTER_ASSERT(count == 0 && c_counter_len(&counter) == 3);
+
+    err = c_counter_remove(&counter, (void*)words[0]);
+    COUNTER_TEST(err);
+    err = c_counter_get(&counter, (void*)words[0], &count);
+    COUNTER_TEST(err);
+    COUNTER_ASSERT(count == 0 && c_counter_len(&counter) == 2);
+
+    c_counter_destroy(&counter, NULL, NULL);
+  }
+
+  // test: group by
+  {
+    CCounter counter;
+    err = c_counter_create(sizeof(int), &counter);
+    COUNTER_TEST(err);
+
+    for (int iii = 0; iii < 10000; ++iii) {
+      err = c_counter_increment(&counter, &(int){iii % 100}, iii, NULL);
+      COUNTER_TEST(err);
+    }
+    COUNTER_ASSERT(c_counter_len(&counter) == 100);
+
+    size_t  iter  = 0;
+    int*    key   = NULL;
+    int64_t count = 0;
+    int64_t total = 0;
+    while (c_counter_iter(&counter, &iter, (void**)&key, &count)) {
+      // sum of key, key + 100, ..., key + 9900
+      COUNTER_ASSERT(count == ((int64_t)*key * 100) + (100 * 99 * 50));
+      total += count;
+    }
+    COUNTER_ASSERT(total == (int64_t)10000 * 9999 / 2);
+
+    c_counter_destroy(&counter, NULL, NULL);
+  }
+}
+
+#ifdef NDEBUG_
+#define NDEBUG
+#undef NDEBUG_
+#endif
+
+#undef COUNTER_TEST_PRINT_ABORT
+#undef COUNTER_TEST
+#undef COUNTER_ASSERT
+#undef CSTDLIB_COUNTER_UNIT_TESTS
+#endif // CSTDLIB_COUNTER_UNIT_TESTS
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Mohamed A. Elmeligy
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions: The above copyright
+ * notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS",
+ * WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -4,9 +4,32 @@
  * Tests  : To use run test, do this in *ONE* C file:
  *              #define CSTDLIB_MAP_UNIT_TESTS
  *              #include "map.h"
+ * Bench  : To run the benchmarks, do this in *ONE* C file (or configure with
+ *          -DENABLE_BENCHMARKS=ON and run `bench_map [buckets]`):
+ *              #define CSTDLIB_MAP_BENCHMARKS
+ *              #include "map.h"
+ *          build it in release, the numbers are compared against a plain
+ *          linear probing table using the same hash
  * Options :
  *           - C_MAP_DONT_CHECK_PARAMS: parameters will not get checked
  *                                      (this is off by default)
+ *           - C_MAP_STATS: count resizes, lookups and hash collisions for
+ *                          `c_map_stats` (this is off by default), the
+ *                          counters are not atomic so a counted map must
+ *                          only be used by one thread at a time (this rules
+ *                          out CConcurrentMap)
+ * Notes   : by default a resize rebuilds the whole table at once, use
+ *           `c_map_set_incremental_resize` to spread it over the following
+ *           insert/remove calls instead
+ *           every table keeps an occupancy bitmap (1 bit per bucket) so
+ *           `c_map_iter` skips empty buckets 64 at a time
+ *           `c_map_set_insertion_ordered` switches to a compact layout where
+ *           the buckets only hold an index into a dense array of entries,
+ *           iteration then follows the insertion order
+ *           `c_map_save` writes the tables as they are in memory, so
+ *           `c_map_open_mmap` can serve lookups straight from the file
+ *           the tables come from a `CMapAllocator` (malloc by default), see
+ *           `c_map_create_with_allocator` and `c_map_huge_page_allocator`
  * License: MIT (go to the end of this file for details)
  */
 
@@ -18,6 +41,18 @@
 #include <stdint.h>
 
 #define CMAP_DEFAULT_CAPACITY 16U
+#define CMAP_DEFAULT_MAX_LOAD_FACTOR 0.875f
+#define CMAP_DEFAULT_MIN_LOAD_FACTOR 0.25f
+#define CMAP_STATS_HISTOGRAM_LEN 16U
+
+/// @brief where a map gets its tables from, `free` is given the same size
+///        `alloc` was called with (an arena can make it a no-op and release
+///        all of its maps at once)
+typedef struct CMapAllocator {
+  void* (*alloc)(size_t size, void* ctx);
+  void (*free)(void* ptr, size_t size, void* ctx);
+  void* ctx;
+} CMapAllocator;
 
 typedef struct CMap {
   void*  buckets;       // { [CMapBucket, key, value], ... }
@@ -35,8 +70,49 @@ typedef struct CMap {
   } value_size;
   size_t bucket_size;
   size_t mask;
+  struct {
+    void*  buckets; // table being drained by an incremental resize (or NULL)
+    size_t capacity;
+    size_t len;
+    size_t mask;
+    size_t cursor; // next old bucket to be migrated
+    size_t step;   // entries migrated per operation, drains it in time
+  } old;
+  size_t rehash_step; // entries migrated per operation (0: resize at once)
+  struct {
+    float  max;
+    float  min;
+    size_t grow_len;   // grow once len reaches this
+    size_t shrink_len; // shrink once len drops to this
+  } load_factor;
+  struct {
+    void*  data;     // insertion ordered mode: { [key, value], ... } (or NULL)
+    size_t len;      // used entries, removed ones included
+    size_t capacity; // same as the table's, plus a spare one at the end
+    size_t size;
+  } entries;
+  struct {
+    void*  data; // `c_map_open_mmap`: the whole mapped file (or NULL)
+    size_t size;
+  } mapped;
+  CMapAllocator allocator;
+  struct CMapCounters* counters; // only allocated with C_MAP_STATS
 } CMap;
 
+typedef struct CMapStats {
+  size_t len;
+  size_t capacity;
+  double avg_distance;
+  size_t max_distance;
+  /// entries `index + 1` buckets away from their home bucket, the last one
+  /// counts the farther ones too
+  size_t histogram[CMAP_STATS_HISTOGRAM_LEN];
+  size_t resizes;
+  size_t lookups;
+  size_t collisions;     // same 48 bits hash, different key
+  double collision_rate; // collisions per lookup
+} CMapStats;
+
 typedef struct c_map_error_t {
   int         code;
   char const* desc;
@@ -63,7 +139,14 @@ typedef struct c_map_error_t {
 #define C_MAP_ERROR_wrong_iter                                                 \
   ((c_map_error_t){.code = 10, .desc = "map: invalid iter"})
 #define C_MAP_iter_done ((c_map_error_t){.code = 11, .desc = ""})
-
+#define C_MAP_ERROR_file_io                                                    \
+  ((c_map_error_t){.code = 12, .desc = "map: file io error"})
+#define C_MAP_ERROR_bad_snapshot                                               \
+  ((c_map_error_t){.code = 13, .desc = "map: invalid snapshot"})
+#define C_MAP_ERROR_read_only                                                  \
+  ((c_map_error_t){.code = 14, .desc = "map: read only"})
+
+/// @brief `value_size` can be 0 to store keys only (see set.h)
 c_map_error_t c_map_create(size_t key_size, size_t value_size, CMap* out_map);
 
 c_map_error_t c_map_create_with_capacity(size_t key_size,
@@ -71,12 +154,78 @@ c_map_error_t c_map_create_with_capacity(size_t key_size,
                                          size_t capacity,
                                          CMap*  out_map);
 
+/// @brief same as `c_map_create_with_capacity` but every table (and the
+///        entries of an insertion ordered map) comes from `allocator`
+/// @param allocator copied into the map, NULL for malloc
+c_map_error_t
+c_map_create_with_allocator(size_t               key_size,
+                            size_t               value_size,
+                            size_t               capacity,
+                            CMapAllocator const* allocator,
+                            CMap*                out_map);
+
+/// @brief an allocator backing big tables with huge pages to cut the TLB
+///        misses of random probes, MAP_HUGETLB first then transparent huge
+///        pages (MADV_HUGEPAGE) on linux, large pages then plain pages on
+///        windows, anything below a huge page still comes from malloc (and
+///        everything does when the system headers hide MAP_ANONYMOUS, as
+///        with -std=c99)
+CMapAllocator c_map_huge_page_allocator(void);
+
+/// @brief create a map from `len` keys and values stored back to back in
+///        `keys` and `values`, the table is sized once for all of them and
+///        the keys are hashed in batches and put without any capacity check
+///        (a key found twice keeps its last value)
+/// @param values can be NULL if `value_size` is 0
+c_map_error_t c_map_build_from(size_t      key_size,
+                               size_t      value_size,
+                               void const* keys,
+                               void const* values,
+                               size_t      len,
+                               CMap*       out_map);
+
+/// @brief create `out_map` as a copy of `self` with the same capacity and
+///        settings, the tables are copied as they are so no key gets hashed
+///        again (only the ones a pending incremental resize didn't migrate)
+/// @note the copy of a `c_map_open_mmap` map lives in memory and can be
+///       written to
+c_map_error_t c_map_clone(CMap const* self, CMap* out_map);
+
 c_map_error_t c_map_insert(CMap* self, void* key, void* value);
 
 c_map_error_t c_map_get(CMap const* self, void* key, void** out_value);
 
+/// @brief get the value of `key`, inserting the key with a zeroed value first
+///        if it is missing, both in a single probe
+/// @param out_value valid till the next insert or remove
+/// @param out_inserted can be NULL
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_map_get_or_insert(CMap*  self,
+                                  void*  key,
+                                  void** out_value,
+                                  bool*  out_inserted);
+
+/// @brief same as `c_map_get` but for `keys_len` keys stored back to back in
+///        `keys`, the keys are hashed and their buckets prefetched in batches
+///        before probing which hides most of the memory latency on big maps
+/// @param out_values an array of `keys_len` pointers, each one is set to the
+///                   value or NULL if the key is not found
+c_map_error_t c_map_get_many(CMap const* self,
+                             void const* keys,
+                             size_t      keys_len,
+                             void*       out_values[]);
+
 c_map_error_t c_map_remove(CMap* self, void* key, void** out_value);
 
+/// @brief keep only the entries `pred` returns true for, the table is swept
+///        once compacting the clusters in place (no per entry backward
+///        shift) and resized at most once at the end
+/// @note `pred` is called once per entry in an unspecified order, it can
+///       release whatever a removed entry holds before returning false
+c_map_error_t c_map_retain(CMap* self,
+                           bool  pred(void* key, void* value, void* ctx),
+                           void* ctx);
+
 void
 c_map_clear(CMap* self,
             void  element_destroy_fn(void* key, void* value, void* user_data),
@@ -84,6 +233,59 @@ c_map_clear(CMap* self,
 
 size_t c_map_len(CMap const* self);
 
+/// @brief switch between resizing the whole table at once (`buckets_per_op`
+///        equals 0, the default) and an incremental resize where the old
+///        table is kept around and at least `buckets_per_op` of its entries
+///        are migrated on every insert/remove until it is empty, more when
+///        that wouldn't empty it before the next resize is due
+c_map_error_t c_map_set_incremental_resize(CMap* self, size_t buckets_per_op);
+
+/// @brief the map grows (doubles) once `len / capacity` reaches
+///        `max_load_factor` and shrinks (halves) once it drops to
+///        `min_load_factor` (0 disables shrinking)
+///        defaults are CMAP_DEFAULT_MAX_LOAD_FACTOR and
+///        CMAP_DEFAULT_MIN_LOAD_FACTOR
+/// @param max_load_factor in range (0, 1)
+/// @param min_load_factor in range [0, max_load_factor / 2)
+c_map_error_t c_map_set_load_factors(CMap* self,
+                                     float max_load_factor,
+                                     float min_load_factor);
+
+/// @brief keep the entries in a dense array in insertion order, the buckets
+///        only hold the hash and an index into it (like compact dicts)
+///        removed entries leave holes that get compacted on the next resize
+///        or when the array is full, updating a key keeps its position
+/// @note the map has to be empty and can't be combined with the incremental
+///       resize
+c_map_error_t c_map_set_insertion_ordered(CMap* self, bool ordered);
+
+/// @brief write the map to `path` as a small header followed by the tables
+///        exactly as they are in memory
+/// @note keys and values are written as they are, so they must not hold
+///       pointers, and the file can only be read back on a machine with the
+///       same endianness and `size_t` size. a pending incremental resize
+///       is finished first
+c_map_error_t c_map_save(CMap* self, char const path[], size_t path_len);
+
+/// @brief read back a map written by `c_map_save`
+c_map_error_t c_map_load(char const path[], size_t path_len, CMap* out_map);
+
+/// @brief map a file written by `c_map_save` read only, lookups are served
+///        straight from the mapped pages without any deserialization
+/// @note values must not be written through, `c_map_insert`, `c_map_remove`
+///       and the setters return C_MAP_ERROR_read_only, `c_map_clear` only
+///       calls `element_destroy_fn` and `c_map_destroy` unmaps the file
+c_map_error_t
+c_map_open_mmap(char const path[], size_t path_len, CMap* out_map);
+
+/// @brief walk the table(s) for the probe distances, a cold path meant for
+///        diagnosing degraded maps
+/// @note resizes, lookups and collisions stay 0 unless C_MAP_STATS is
+///       defined, their counters are not atomic (single threaded use only)
+c_map_error_t c_map_stats(CMap const* self, CMapStats* out_stats);
+
+/// @brief `iter` has to start at 0, the order is unspecified unless the map
+///        is insertion ordered
 bool c_map_iter(CMap* self, size_t* iter, void** key, void** value);
 
 void
@@ -96,8 +298,17 @@ c_map_destroy(CMap* self,
 #ifdef CSTDLIB_MAP_IMPLEMENTATION
 #include <assert.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
 #error "You need MSVC must be higher that or equal to 1900"
@@ -108,6 +319,23 @@ c_map_destroy(CMap* self,
 #pragma warning(disable : 4996) // disable warning about unsafe functions
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+#define C_MAP_PREFETCH(addr) __builtin_prefetch((addr), 0, 1)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define C_MAP_PREFETCH(addr) _mm_prefetch((char const*)(addr), _MM_HINT_T0)
+#else
+#define C_MAP_PREFETCH(addr) ((void)(addr))
+#endif
+
+// how many lookups are in flight in `c_map_get_many`
+#define C_MAP_GET_MANY_BATCH 32U
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward64)
+#endif
+
 #ifndef C_ARR_DONT_CHECK_PARAMS
 #define C_ARR_CHECK_PARAMS(params)                                             \
   if (!(params)) return C_MAP_ERROR_invalid_parameters;
@@ -115,22 +343,137 @@ c_map_destroy(CMap* self,
 #define C_ARR_CHECK_PARAMS(params) ((void)0)
 #endif
 
+// kept behind a pointer so lookups on a const map can count without
+// writing to it, they are plain (not atomic) increments
+struct CMapCounters {
+  size_t resizes;
+  size_t lookups;
+  size_t collisions;
+};
+
+#ifdef C_MAP_STATS
+#define C_MAP_STATS_COUNT(self, counter)                                       \
+  ((self)->counters ? (void)((self)->counters->counter++) : (void)0)
+#else
+#define C_MAP_STATS_COUNT(self, counter) ((void)0)
+#endif
+
 typedef struct CMapBucket CMapBucket;
 struct CMapBucket {
   uint64_t distance_from_initial_bucket : 16;
   uint64_t hash : 48;
 };
 
-static const size_t spare_buckets_count = 2U;
+// `c_map_save` file header, followed by the table (spare buckets included)
+// then the entries array in insertion ordered mode
+typedef struct CMapSnapshotHeader {
+  char     magic[4]; // "CMAP"
+  uint16_t version;
+  uint16_t flags;
+  uint32_t byte_order; // 0x01020304 as written
+  uint32_t size_t_size;
+  uint64_t key_size;
+  uint64_t value_size;
+  uint64_t capacity;
+  uint64_t len;
+  uint64_t entries_len;
+  float    max_load_factor;
+  float    min_load_factor;
+} CMapSnapshotHeader; // 64 bytes, keeps the buckets aligned when mapped
+
+#define C_MAP_SNAPSHOT_VERSION 1U
+#define C_MAP_SNAPSHOT_ORDERED 1U
+
+// smaller allocations are not worth a whole huge page
+#define C_MAP_HUGE_PAGE_SIZE ((size_t)2U << 20U)
+
+#if !defined(_WIN32) && !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+// strict ISO modes (e.g. -std=c99) hide the anonymous mappings, the huge
+// page allocator then falls back to malloc
+#if defined(_WIN32) || defined(MAP_ANONYMOUS)
+#define C_MAP_HUGE_PAGES
+#endif
+
+// spare_bucket1, spare_bucket2 and a third one right before `buckets` used
+// to carry buckets while migrating from the old table
+static const size_t spare_buckets_count = 3U;
 
 static size_t        c_internal_map_hash(const void* data, size_t data_len);
 static size_t        c_internal_map_hash_fnv(const void* data, size_t data_len);
 static size_t        c_internal_map_clip_hash(size_t hash);
 static c_map_error_t c_internal_map_resize(CMap* self, size_t new_capacity);
-static inline void*  c_internal_map_get_key(CMap const* self, size_t index);
-static inline void*  c_internal_map_get_value(CMap const* self, size_t index);
+static c_map_error_t c_internal_map_resize_ordered(CMap*  self,
+                                                   size_t new_capacity);
+static void          c_internal_map_drop_entry(CMap* self, size_t index);
+static c_map_error_t c_internal_map_insert_entry(CMap*       self,
+                                                 void const* key,
+                                                 void const* value,
+                                                 size_t      hash);
+static void*  c_internal_map_alloc(CMap const* self, size_t size);
+static void   c_internal_map_free(CMap const* self, void* ptr, size_t size);
+static void*  c_internal_map_alloc_table(CMap const* self, size_t capacity);
+static void*  c_internal_map_alloc_entries(CMap const* self, size_t capacity);
+static size_t c_internal_map_table_size(CMap const* self, size_t capacity);
+static void   c_internal_map_set_table(CMap*  self,
+                                       void*  table,
+                                       size_t capacity);
+static size_t c_internal_map_entries_size(CMap const* self, size_t capacity);
+static void          c_internal_map_migrate(CMap* self, size_t steps);
+static void          c_internal_map_update_limits(CMap* self);
+static c_map_error_t c_internal_map_create_counters(CMap* self);
+static size_t        c_internal_map_alignment_of(size_t size);
+static void          c_internal_map_set_layout(CMap*  self,
+                                               size_t key_size,
+                                               size_t value_size);
+static c_map_error_t c_internal_map_parse_snapshot_header(
+    CMapSnapshotHeader const* header, CMap* out_map);
+static c_map_error_t c_internal_map_map_file(char const path[],
+                                             void**     out_data,
+                                             size_t*    out_size);
+static void          c_internal_map_unmap_file(void* data, size_t size);
+static void*         c_internal_map_malloc(size_t size, void* ctx);
+static void c_internal_map_malloc_free(void* ptr, size_t size, void* ctx);
+static void* c_internal_map_huge_page_alloc(size_t size, void* ctx);
+static void  c_internal_map_huge_page_free(void* ptr, size_t size, void* ctx);
+static CMapBucket*   c_internal_map_find(CMap const* self,
+                                         void*       buckets,
+                                         size_t      mask,
+                                         void const* key,
+                                         size_t      hash);
+static CMapBucket*   c_internal_map_put(CMap*       self,
+                                        void*       buckets,
+                                        size_t      mask,
+                                        CMapBucket* new_bucket,
+                                        void const* key);
+static void          c_internal_map_make_room(CMap*  self,
+                                              size_t index);
+static void          c_internal_map_erase(CMap*       self,
+                                          void*       buckets,
+                                          size_t      mask,
+                                          CMapBucket* bucket);
+static inline void*  c_internal_map_get_key(CMap const* self,
+                                            CMapBucket* bucket);
+static inline void*  c_internal_map_get_value(CMap const* self,
+                                              CMapBucket* bucket);
 static inline CMapBucket* c_internal_map_get_bucket(CMap const* self,
+                                                    void*       buckets,
                                                     size_t      index);
+static inline void*       c_internal_map_get_entry(CMap const* self,
+                                                   void*       entries,
+                                                   size_t      index);
+static inline uint64_t*   c_internal_map_get_bitmap(CMap const* self,
+                                                    void*       buckets,
+                                                    size_t      mask);
+static inline uint64_t*   c_internal_map_get_entries_bitmap(CMap const* self,
+                                                            void*  entries,
+                                                            size_t capacity);
+static size_t             c_internal_map_next_set_bit(uint64_t const* bitmap,
+                                                      size_t          index,
+                                                      size_t          end);
+static inline size_t      c_internal_map_ctz(uint64_t word);
 
 c_map_error_t
 c_map_create(size_t key_size, size_t value_size, CMap* out_map)
@@ -144,13 +487,28 @@ c_map_create_with_capacity(size_t key_size,
                            size_t value_size,
                            size_t capacity,
                            CMap*  out_map)
+{
+  return c_map_create_with_allocator(key_size, value_size, capacity, NULL,
+                                     out_map);
+}
+
+c_map_error_t
+c_map_create_with_allocator(size_t               key_size,
+                            size_t               value_size,
+                            size_t               capacity,
+                            CMapAllocator const* allocator,
+                            CMap*                out_map)
 {
   C_ARR_CHECK_PARAMS(key_size > 0);
-  C_ARR_CHECK_PARAMS(value_size > 0);
+  C_ARR_CHECK_PARAMS(!allocator || (allocator->alloc && allocator->free));
 
   if (!out_map) { return C_MAP_ERROR_none; }
 
   *out_map = (CMap){0};
+  out_map->allocator
+      = allocator ? *allocator
+                  : (CMapAllocator){c_internal_map_malloc,
+                                    c_internal_map_malloc_free, NULL};
 
   // make sure the capacity is multiplicate of 2
   if (capacity < CMAP_DEFAULT_CAPACITY) {
@@ -163,33 +521,145 @@ c_map_create_with_capacity(size_t key_size,
     capacity = new_capacity;
   }
 
-  // make sure the key and value sizes are multiplicate of sizeof(uintptr_t)
-  size_t aligned_key_size   = key_size;
-  size_t aligned_value_size = value_size;
-  while (aligned_key_size & (sizeof(uintptr_t) - 1)) {
-    aligned_key_size++;
+  c_internal_map_set_layout(out_map, key_size, value_size);
+  out_map->load_factor.max = CMAP_DEFAULT_MAX_LOAD_FACTOR;
+  out_map->load_factor.min = CMAP_DEFAULT_MIN_LOAD_FACTOR;
+
+  void* table = c_internal_map_alloc_table(out_map, capacity);
+  if (!table) {
+    *out_map = (CMap){0};
+    return C_MAP_ERROR_mem_allocation;
   }
-  while (aligned_value_size & (sizeof(uintptr_t) - 1)) {
-    aligned_value_size++;
+  c_internal_map_set_table(out_map, table, capacity);
+
+  return c_internal_map_create_counters(out_map);
+}
+
+CMapAllocator
+c_map_huge_page_allocator(void)
+{
+  return (CMapAllocator){c_internal_map_huge_page_alloc,
+                         c_internal_map_huge_page_free, NULL};
+}
+
+c_map_error_t
+c_map_build_from(size_t      key_size,
+                 size_t      value_size,
+                 void const* keys,
+                 void const* values,
+                 size_t      len,
+                 CMap*       out_map)
+{
+  C_ARR_CHECK_PARAMS(keys || !len);
+  C_ARR_CHECK_PARAMS(values || !len || !value_size);
+
+  if (!out_map) { return C_MAP_ERROR_none; }
+
+  // the smallest table that takes `len` keys without growing
+  size_t capacity = CMAP_DEFAULT_CAPACITY;
+  while ((size_t)((double)capacity * CMAP_DEFAULT_MAX_LOAD_FACTOR) <= len) {
+    capacity *= 2;
+  }
+
+  c_map_error_t err
+      = c_map_create_with_capacity(key_size, value_size, capacity, out_map);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  CMap*       self       = out_map;
+  CMapBucket* new_bucket = self->spare_bucket1;
+  size_t      hashes[C_MAP_GET_MANY_BATCH];
+
+  for (size_t batch_start = 0; batch_start < len;
+       batch_start += C_MAP_GET_MANY_BATCH) {
+    size_t batch_len = len - batch_start;
+    if (batch_len > C_MAP_GET_MANY_BATCH) batch_len = C_MAP_GET_MANY_BATCH;
+
+    char const* batch_keys = (char const*)keys + (batch_start * key_size);
+    char const* batch_values
+        = value_size ? (char const*)values + (batch_start * value_size) : NULL;
+
+    // [1] hash and prefetch the home buckets
+    for (size_t iii = 0; iii < batch_len; ++iii) {
+      hashes[iii]
+          = c_internal_map_hash(batch_keys + (iii * key_size), key_size);
+      C_MAP_PREFETCH(c_internal_map_get_bucket(self, self->buckets,
+                                               hashes[iii] & self->mask));
+    }
+
+    // [2] put, the table is big enough for all of them
+    for (size_t iii = 0; iii < batch_len; ++iii) {
+      void const* key = batch_keys + (iii * key_size);
+
+      new_bucket->distance_from_initial_bucket = 1;
+      new_bucket->hash                         = hashes[iii];
+      memcpy((char*)(&new_bucket[1]), key, key_size);
+      if (value_size) {
+        memcpy((char*)(&new_bucket[1]) + self->key_size.aligned,
+               batch_values + (iii * value_size), value_size);
+      }
+
+      if (!c_internal_map_put(self, self->buckets, self->mask, new_bucket,
+                              key)) {
+        self->len++;
+      }
+    }
   }
-  size_t bucket_size
-      = sizeof(CMapBucket) + aligned_key_size + aligned_value_size;
 
-  out_map->spare_bucket1
-      = malloc((capacity + spare_buckets_count) * bucket_size);
-  if (!out_map->spare_bucket1) return C_MAP_ERROR_mem_allocation;
-  memset(out_map->spare_bucket1, 0,
-         ((capacity + spare_buckets_count) * bucket_size));
-  out_map->spare_bucket2 = (char*)(out_map->spare_bucket1) + bucket_size;
-  out_map->buckets       = (char*)(out_map->spare_bucket2) + bucket_size;
-
-  out_map->capacity           = capacity;
-  out_map->key_size.orig      = key_size;
-  out_map->key_size.aligned   = aligned_key_size;
-  out_map->value_size.orig    = value_size;
-  out_map->value_size.aligned = aligned_value_size;
-  out_map->bucket_size        = bucket_size;
-  out_map->mask               = out_map->capacity - 1;
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_map_clone(CMap const* self, CMap* out_map)
+{
+  C_ARR_CHECK_PARAMS(self && self->buckets);
+
+  if (!out_map) { return C_MAP_ERROR_none; }
+
+  c_map_error_t err = c_map_create_with_allocator(
+      self->key_size.orig, self->value_size.orig, self->capacity,
+      self->mapped.data ? NULL : &self->allocator, out_map);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  if (self->entries.data) {
+    err = c_map_set_insertion_ordered(out_map, true);
+    if (err.code != C_MAP_ERROR_none.code) {
+      c_map_destroy(out_map, NULL, NULL);
+      return err;
+    }
+
+    memcpy(out_map->entries.data, self->entries.data,
+           c_internal_map_entries_size(self, self->entries.capacity));
+    out_map->entries.len = self->entries.len;
+  }
+
+  // the spare buckets and the bitmap come along
+  memcpy(out_map->spare_bucket1, self->spare_bucket1,
+         c_internal_map_table_size(self, self->capacity));
+  out_map->len         = self->len - self->old.len;
+  out_map->rehash_step = self->rehash_step;
+  out_map->load_factor = self->load_factor;
+
+  // the current table always has room for the entries still in the old one
+  if (self->old.len) {
+    uint64_t* bitmap
+        = c_internal_map_get_bitmap(self, self->old.buckets, self->old.mask);
+    CMapBucket* moved_bucket
+        = (CMapBucket*)((char*)out_map->buckets - out_map->bucket_size);
+
+    for (size_t iii = c_internal_map_next_set_bit(bitmap, 0,
+                                                  self->old.capacity);
+         iii < self->old.capacity;
+         iii = c_internal_map_next_set_bit(bitmap, iii + 1,
+                                           self->old.capacity)) {
+      memcpy(moved_bucket,
+             c_internal_map_get_bucket(self, self->old.buckets, iii),
+             self->bucket_size);
+      moved_bucket->distance_from_initial_bucket = 1;
+      c_internal_map_put(out_map, out_map->buckets, out_map->mask,
+                         moved_bucket, NULL);
+      out_map->len++;
+    }
+  }
 
   return C_MAP_ERROR_none;
 }
@@ -199,82 +669,197 @@ c_map_insert(CMap* self, void* key, void* value)
 {
   C_ARR_CHECK_PARAMS(self && self->buckets);
 
-  if (!key || !value) { return C_MAP_ERROR_none; }
+  if (self->mapped.data) { return C_MAP_ERROR_read_only; }
 
-  size_t hash  = c_internal_map_hash(key, self->key_size.orig);
-  size_t index = hash & self->mask;
+  // zero sized values (sets) don't need a value
+  if (!key || (!value && self->value_size.orig)) { return C_MAP_ERROR_none; }
 
-  if (self->capacity <= self->len) {
+  size_t hash = c_internal_map_hash(key, self->key_size.orig);
+
+  if (self->old.buckets) { c_internal_map_migrate(self, self->old.step); }
+
+  // grow before probing, the home bucket depends on the mask
+  if (self->len >= self->load_factor.grow_len) {
     c_map_error_t err = c_internal_map_resize(self, self->capacity * 2);
     if (err.code != 0) { return err; }
   }
 
+  if (self->entries.data) {
+    return c_internal_map_insert_entry(self, key, value, hash);
+  }
+
+  // the key could still live in the table being drained, update it there
+  if (self->old.len) {
+    CMapBucket* old_bucket = c_internal_map_find(
+        self, self->old.buckets, self->old.mask, key, hash);
+    if (old_bucket) {
+      if (value) {
+        memcpy(c_internal_map_get_value(self, old_bucket), value,
+               self->value_size.orig);
+      }
+      return C_MAP_ERROR_none;
+    }
+  }
+
   CMapBucket* new_bucket                   = self->spare_bucket1;
   new_bucket->distance_from_initial_bucket = 1;
   new_bucket->hash                         = hash;
   memcpy((char*)(&new_bucket[1]), key, self->key_size.orig);
-  memcpy((char*)(&new_bucket[1]) + self->key_size.aligned, value,
-         self->value_size.orig);
+  if (value) {
+    memcpy((char*)(&new_bucket[1]) + self->key_size.aligned, value,
+           self->value_size.orig);
+  }
 
-  for (;;) {
-    CMapBucket* bucket     = c_internal_map_get_bucket(self, index);
-    void*       bucket_key = c_internal_map_get_key(self, index);
+  if (!c_internal_map_put(self, self->buckets, self->mask, new_bucket, key)) {
+    self->len++;
+  }
 
-    // [1] empty bucket
-    if (bucket->distance_from_initial_bucket == 0) {
-      memcpy(bucket, new_bucket, self->bucket_size);
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_map_get(CMap const* self, void* key, void** out_value)
+{
+  C_ARR_CHECK_PARAMS(self && self->buckets);
+
+  if (!key || !out_value) return C_MAP_ERROR_none;
+
+  size_t hash = c_internal_map_hash(key, self->key_size.orig);
+
+  CMapBucket* bucket
+      = c_internal_map_find(self, self->buckets, self->mask, key, hash);
+  if (!bucket && self->old.len) {
+    bucket = c_internal_map_find(self, self->old.buckets, self->old.mask, key,
+                                 hash);
+  }
+
+  *out_value = bucket ? c_internal_map_get_value(self, bucket) : NULL;
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_map_get_or_insert(CMap* self, void* key, void** out_value, bool* out_inserted)
+{
+  C_ARR_CHECK_PARAMS(self && self->buckets && key);
+
+  if (!out_value) return C_MAP_ERROR_none;
+  *out_value = NULL;
+  if (out_inserted) *out_inserted = false;
+
+  if (self->mapped.data) { return C_MAP_ERROR_read_only; }
+
+  size_t hash = c_internal_map_hash(key, self->key_size.orig);
+
+  if (self->old.buckets) { c_internal_map_migrate(self, self->old.step); }
+
+  if (self->len >= self->load_factor.grow_len) {
+    c_map_error_t err = c_internal_map_resize(self, self->capacity * 2);
+    if (err.code != 0) { return err; }
+  }
+
+  // the entries array and the table being drained need their own lookups
+  if (self->entries.data || self->old.len) {
+    c_map_get(self, key, out_value);
+    if (*out_value) { return C_MAP_ERROR_none; }
+
+    c_map_error_t err = C_MAP_ERROR_none;
+    if (self->entries.data) {
+      err = c_internal_map_insert_entry(self, key, NULL, hash);
+    } else {
+      CMapBucket* new_bucket                   = self->spare_bucket1;
+      new_bucket->distance_from_initial_bucket = 1;
+      new_bucket->hash                         = hash;
+      memcpy((char*)(&new_bucket[1]), key, self->key_size.orig);
+      c_internal_map_put(self, self->buckets, self->mask, new_bucket, NULL);
       self->len++;
-      return C_MAP_ERROR_none;
     }
+    if (err.code != 0) { return err; }
 
-    // [2] found one, same hash, update it
-    /// TODO: we need external compare method
-    /// TODO: we need to return old data
-    if ((new_bucket->hash == bucket->hash)
-        && (memcmp(bucket_key, key, self->key_size.orig) == 0)) {
-      memcpy(bucket, new_bucket, self->bucket_size);
-      return C_MAP_ERROR_none;
-    }
+    *out_value = c_internal_map_get_value(
+        self, c_internal_map_find(self, self->buckets, self->mask, key, hash));
+    memset(*out_value, 0, self->value_size.orig);
+    if (out_inserted) *out_inserted = true;
 
-    // [3] found one, different hash, collision
-    if (bucket->distance_from_initial_bucket
-        < new_bucket->distance_from_initial_bucket) {
-      // swap
-      CMapBucket* tmp = (CMapBucket*)(self->spare_bucket2);
-      memcpy(tmp, bucket, self->bucket_size);
-      memcpy(bucket, new_bucket, self->bucket_size);
-      memcpy(new_bucket, tmp, self->bucket_size);
-    }
+    return C_MAP_ERROR_none;
+  }
 
-    index = (index + 1) & self->mask;
-    new_bucket->distance_from_initial_bucket++;
+  C_MAP_STATS_COUNT(self, lookups);
+
+  // stop at the first bucket the key would take from a richer one
+  size_t      index    = hash & self->mask;
+  size_t      distance = 1;
+  CMapBucket* bucket   = NULL;
+  for (;; index = (index + 1) & self->mask, distance++) {
+    bucket = c_internal_map_get_bucket(self, self->buckets, index);
+    if (bucket->distance_from_initial_bucket < distance) break;
+
+    if (bucket->hash == hash) {
+      if (memcmp(c_internal_map_get_key(self, bucket), key,
+                 self->key_size.orig)
+          == 0) {
+        *out_value = c_internal_map_get_value(self, bucket);
+        return C_MAP_ERROR_none;
+      }
+      C_MAP_STATS_COUNT(self, collisions);
+    }
   }
+
+  c_internal_map_make_room(self, index);
+
+  assert(distance < UINT16_MAX);
+  bucket->distance_from_initial_bucket = distance;
+  bucket->hash                         = hash;
+  memcpy(c_internal_map_get_key(self, bucket), key, self->key_size.orig);
+  *out_value = c_internal_map_get_value(self, bucket);
+  memset(*out_value, 0, self->value_size.orig);
+  self->len++;
+  if (out_inserted) *out_inserted = true;
+
+  return C_MAP_ERROR_none;
 }
 
 c_map_error_t
-c_map_get(CMap const* self, void* key, void** out_value)
+c_map_get_many(CMap const* self,
+               void const* keys,
+               size_t      keys_len,
+               void*       out_values[])
 {
   C_ARR_CHECK_PARAMS(self && self->buckets);
 
-  if (!key) return C_MAP_ERROR_none;
+  if (!keys || !out_values) return C_MAP_ERROR_none;
 
-  size_t hash = c_internal_map_hash(key, self->key_size.orig);
+  size_t hashes[C_MAP_GET_MANY_BATCH];
 
-  for (size_t index = hash & self->mask;; index = (index + 1) & self->mask) {
-    CMapBucket* bucket       = c_internal_map_get_bucket(self, index);
-    void*       bucket_key   = c_internal_map_get_key(self, index);
-    void*       bucket_value = c_internal_map_get_value(self, index);
+  for (size_t batch_start = 0; batch_start < keys_len;
+       batch_start += C_MAP_GET_MANY_BATCH) {
+    size_t batch_len = keys_len - batch_start;
+    if (batch_len > C_MAP_GET_MANY_BATCH) batch_len = C_MAP_GET_MANY_BATCH;
 
-    if (!bucket->distance_from_initial_bucket) {
-      *out_value = NULL;
-      break;
+    char const* batch_keys
+        = (char const*)keys + (batch_start * self->key_size.orig);
+
+    // [1] hash and prefetch the home buckets
+    for (size_t iii = 0; iii < batch_len; ++iii) {
+      hashes[iii] = c_internal_map_hash(
+          batch_keys + (iii * self->key_size.orig), self->key_size.orig);
+      C_MAP_PREFETCH(c_internal_map_get_bucket(self, self->buckets,
+                                               hashes[iii] & self->mask));
     }
 
-    if (bucket->hash == hash) {
-      if (memcmp(bucket_key, key, self->key_size.orig) == 0) {
-        *out_value = bucket_value;
-        break;
+    // [2] probe, the home buckets should be in the cache by now
+    for (size_t iii = 0; iii < batch_len; ++iii) {
+      void const* key = batch_keys + (iii * self->key_size.orig);
+
+      CMapBucket* bucket = c_internal_map_find(self, self->buckets, self->mask,
+                                               key, hashes[iii]);
+      if (!bucket && self->old.len) {
+        bucket = c_internal_map_find(self, self->old.buckets, self->old.mask,
+                                     key, hashes[iii]);
       }
+
+      out_values[batch_start + iii]
+          = bucket ? c_internal_map_get_value(self, bucket) : NULL;
     }
   }
 
@@ -286,46 +871,130 @@ c_map_remove(CMap* self, void* key, void** out_value)
 {
   C_ARR_CHECK_PARAMS(self && self->buckets);
 
+  if (self->mapped.data) { return C_MAP_ERROR_read_only; }
+
   if (!key || !out_value) return C_MAP_ERROR_none;
 
   size_t hash = c_internal_map_hash(key, self->key_size.orig);
 
-  for (size_t index = hash & self->mask;; index = (index + 1) & self->mask) {
-    CMapBucket* bucket = c_internal_map_get_bucket(self, index);
+  if (self->old.buckets) { c_internal_map_migrate(self, self->old.step); }
+
+  CMapBucket* bucket
+      = c_internal_map_find(self, self->buckets, self->mask, key, hash);
+  if (bucket) {
+    memcpy(self->spare_bucket1, bucket, self->bucket_size);
+    c_internal_map_erase(self, self->buckets, self->mask, bucket);
+  } else if (self->old.len) {
+    bucket = c_internal_map_find(self, self->old.buckets, self->old.mask, key,
+                                 hash);
+    if (!bucket) { return C_MAP_ERROR_key_not_found; }
+
+    memcpy(self->spare_bucket1, bucket, self->bucket_size);
+    c_internal_map_erase(self, self->old.buckets, self->old.mask, bucket);
+    self->old.len--;
+  } else {
+    return C_MAP_ERROR_key_not_found;
+  }
+
+  if (self->entries.data) {
+    // keep the entry in the spare one, its slot becomes a hole
+    size_t index = *(size_t*)(&((CMapBucket*)self->spare_bucket1)[1]);
+    memcpy(c_internal_map_get_entry(self, self->entries.data,
+                                    self->entries.capacity),
+           c_internal_map_get_entry(self, self->entries.data, index),
+           self->entries.size);
+    c_internal_map_drop_entry(self, index);
+  }
+
+  self->len--;
+
+  // a min load factor of 0 never shrinks, not even once the map is empty
+  if ((self->load_factor.min > 0.0f)
+      && (self->len <= self->load_factor.shrink_len)
+      && (self->capacity > CMAP_DEFAULT_CAPACITY)) {
+    c_internal_map_resize(self, self->capacity / 2);
+  }
+
+  if (self->entries.data) {
+    *out_value = (char*)c_internal_map_get_entry(self, self->entries.data,
+                                                 self->entries.capacity)
+                 + self->key_size.aligned;
+  } else {
+    *out_value = c_internal_map_get_value(self, self->spare_bucket1);
+  }
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_map_retain(CMap* self,
+             bool  pred(void* key, void* value, void* ctx),
+             void* ctx)
+{
+  C_ARR_CHECK_PARAMS(self && self->buckets && pred);
+
+  if (self->mapped.data) { return C_MAP_ERROR_read_only; }
+
+  if (self->old.buckets) { c_internal_map_migrate(self, SIZE_MAX); }
+
+  // start right after an empty bucket, no cluster wraps around it, so
+  // every position below is an offset from there that never wraps
+  size_t start = 0;
+  while (c_internal_map_get_bucket(self, self->buckets, start)
+             ->distance_from_initial_bucket) {
+    start++;
+  }
+
+  // each kept bucket moves back to the first free position of its cluster
+  // but never before its home, which is what backward shifting every
+  // removed bucket one by one ends up with
+  uint64_t* bitmap = c_internal_map_get_bitmap(self, self->buckets, self->mask);
+  size_t    write  = 1;
+  for (size_t offset = 1; offset <= self->capacity; ++offset) {
+    size_t      index = (start + offset) & self->mask;
+    CMapBucket* bucket = c_internal_map_get_bucket(self, self->buckets, index);
     if (!bucket->distance_from_initial_bucket) {
-      return C_MAP_ERROR_key_not_found;
+      write = offset + 1;
+      continue;
     }
 
-    void* bucket_key = c_internal_map_get_key(self, index);
-    if (bucket->hash == hash
-        && (memcmp(bucket_key, key, self->key_size.orig) == 0)) {
-      memcpy(self->spare_bucket1, bucket, self->bucket_size);
+    size_t home = offset - (bucket->distance_from_initial_bucket - 1);
+    if (!pred(c_internal_map_get_key(self, bucket),
+              c_internal_map_get_value(self, bucket), ctx)) {
+      if (self->entries.data) {
+        c_internal_map_drop_entry(self, *(size_t*)(&bucket[1]));
+      }
       bucket->distance_from_initial_bucket = 0;
+      bitmap[index / 64] &= ~((uint64_t)1 << (index % 64));
+      self->len--;
+      continue;
+    }
 
-      for (;;) {
-        CMapBucket* prev   = bucket;
-        index              = (index + 1) & self->mask;
-        CMapBucket* bucket = c_internal_map_get_bucket(self, index);
-        if (bucket->distance_from_initial_bucket <= 1) {
-          prev->distance_from_initial_bucket = 0;
-          break;
-        }
-
-        memcpy(prev, bucket, self->bucket_size);
-        prev->distance_from_initial_bucket--;
-      }
+    size_t target = (write > home) ? write : home;
+    write         = target + 1;
+    if (target == offset) continue;
 
-      self->len--;
+    size_t      target_index = (start + target) & self->mask;
+    CMapBucket* target_bucket
+        = c_internal_map_get_bucket(self, self->buckets, target_index);
+    memcpy(target_bucket, bucket, self->bucket_size);
+    target_bucket->distance_from_initial_bucket = target - home + 1;
+    bitmap[target_index / 64] |= (uint64_t)1 << (target_index % 64);
 
-      if ((self->len <= (self->capacity / 4))
-          && (self->len > CMAP_DEFAULT_CAPACITY)) {
-        c_internal_map_resize(self, self->capacity / 2);
-      }
+    bucket->distance_from_initial_bucket = 0;
+    bitmap[index / 64] &= ~((uint64_t)1 << (index % 64));
+  }
 
-      *out_value = (char*)self->spare_bucket1 + sizeof(CMapBucket)
-                   + self->key_size.aligned;
-      break;
-    }
+  // a single resize to where the removals one by one would have ended
+  size_t new_capacity = self->capacity;
+  while ((self->load_factor.min > 0.0f)
+         && (new_capacity > CMAP_DEFAULT_CAPACITY)
+         && (self->len
+             <= (size_t)((double)new_capacity * self->load_factor.min))) {
+    new_capacity /= 2;
+  }
+  if (new_capacity != self->capacity) {
+    return c_internal_map_resize(self, new_capacity);
   }
 
   return C_MAP_ERROR_none;
@@ -345,7 +1014,20 @@ c_map_clear(CMap* self,
     }
   }
 
-  memset(self->spare_bucket1, 0, (self->capacity + 2) * self->bucket_size);
+  if (self->mapped.data) { return; }
+
+  if (self->old.buckets) {
+    self->old.len = 0;
+    c_internal_map_migrate(self, 0); // frees the drained table
+  }
+
+  memset(self->spare_bucket1, 0,
+         c_internal_map_table_size(self, self->capacity));
+  if (self->entries.data) {
+    memset(self->entries.data, 0,
+           c_internal_map_entries_size(self, self->entries.capacity));
+    self->entries.len = 0;
+  }
   self->len = 0;
 }
 
@@ -355,216 +1037,1962 @@ c_map_len(CMap const* self)
   return self->len;
 }
 
-bool
-c_map_iter(CMap* self, size_t* iter, void** key, void** value)
+c_map_error_t
+c_map_set_incremental_resize(CMap* self, size_t buckets_per_op)
 {
-  if (!iter) return false;
+  C_ARR_CHECK_PARAMS(self && self->buckets);
+  // the entries array is compacted on resize, it can't be done in steps
+  C_ARR_CHECK_PARAMS(!buckets_per_op || !self->entries.data);
 
-  for (; *iter < self->capacity; ++(*iter)) {
-    CMapBucket* bucket = c_internal_map_get_bucket(self, *iter);
-    if (bucket->distance_from_initial_bucket) {
-      if (key) { *key = c_internal_map_get_key(self, *iter); }
-      if (value) { *value = c_internal_map_get_value(self, *iter); }
-      (*iter)++;
-      break;
-    }
-  }
+  if (self->mapped.data) { return C_MAP_ERROR_read_only; }
 
-  if (*iter >= self->capacity) {
-    return false;
-  } else {
-    return true;
-  }
-}
+  self->rehash_step = buckets_per_op;
+  if (self->old.step < buckets_per_op) { self->old.step = buckets_per_op; }
 
-void
-c_map_destroy(CMap* self,
-              void  element_destroy_fn(void* key, void* value, void* user_data),
-              void* user_data)
-{
-  if (self && self->buckets) {
-    if (element_destroy_fn) {
-      c_map_clear(self, element_destroy_fn, user_data);
-    }
-    free(self->spare_bucket1);
-    *self = (CMap){0};
+  // leaving the incremental mode, finish any pending migration
+  if (!buckets_per_op && self->old.buckets) {
+    c_internal_map_migrate(self, SIZE_MAX);
   }
-}
 
-// ------------------------- internal ------------------------- //
-
-size_t
-c_internal_map_hash(const void* data, size_t data_len)
-{
-  /// TODO: make the hash algo changeable
-  return c_internal_map_clip_hash(c_internal_map_hash_fnv(data, data_len));
+  return C_MAP_ERROR_none;
 }
 
-size_t
-c_internal_map_hash_fnv(const void* data, size_t data_len)
+c_map_error_t
+c_map_set_load_factors(CMap* self, float max_load_factor, float min_load_factor)
 {
-  // Constants for the FNV-1a hash function
-  const size_t fnv_prime = 1099511628211U;
-  size_t       hash      = 14695981039346656037U; // FNV offset basis
+  C_ARR_CHECK_PARAMS(self && self->buckets);
+  C_ARR_CHECK_PARAMS(max_load_factor > 0.0f && max_load_factor < 1.0f);
+  C_ARR_CHECK_PARAMS(min_load_factor >= 0.0f);
+  // a shrink must not leave the map above the max load factor
+  C_ARR_CHECK_PARAMS(min_load_factor < (max_load_factor / 2.0f));
 
-  const uint8_t* bytes = (const uint8_t*)data;
+  if (self->mapped.data) { return C_MAP_ERROR_read_only; }
 
-  for (size_t i = 0; i < data_len; i++) {
-    hash ^= bytes[i];  // XOR the byte with the hash
-    hash *= fnv_prime; // Multiply by the FNV prime
-  }
+  self->load_factor.max = max_load_factor;
+  self->load_factor.min = min_load_factor;
+  c_internal_map_update_limits(self);
 
-  return hash;
+  return C_MAP_ERROR_none;
 }
 
 c_map_error_t
-c_internal_map_resize(CMap* self, size_t new_capacity)
+c_map_set_insertion_ordered(CMap* self, bool ordered)
 {
-  CMap          new_map = {0};
-  c_map_error_t err     = c_map_create_with_capacity(
-      self->key_size.orig, self->value_size.orig, new_capacity, &new_map);
-  if (err.code != 0) return err;
+  C_ARR_CHECK_PARAMS(self && self->buckets);
+  C_ARR_CHECK_PARAMS(!ordered || !self->rehash_step);
 
-  for (size_t iii = 0; iii < self->capacity; iii++) {
-    CMapBucket* bucket = c_internal_map_get_bucket(self, iii);
-    if (!bucket->distance_from_initial_bucket) continue;
+  if (self->mapped.data) { return C_MAP_ERROR_read_only; }
+  if (ordered == (self->entries.data != NULL)) return C_MAP_ERROR_none;
+  // the buckets layout changes, there is nothing to carry over
+  if (self->len) return C_MAP_ERROR_wrong_len;
 
-    bucket->distance_from_initial_bucket = 1;
+  if (self->old.buckets) {
+    self->old.len = 0;
+    c_internal_map_migrate(self, 0); // frees the drained table
+  }
 
-    for (size_t new_index = bucket->hash & new_map.mask;;
-         new_index        = (new_index + 1) & new_map.mask) {
-      CMapBucket* new_map_bucket
-          = c_internal_map_get_bucket(&new_map, new_index);
+  size_t old_bucket_size = self->bucket_size;
+  size_t old_table_size  = c_internal_map_table_size(self, self->capacity);
+  self->bucket_size      = ordered ? (sizeof(CMapBucket) + sizeof(size_t))
+                                   : (sizeof(CMapBucket) + self->entries.size);
 
-      if (new_map_bucket->distance_from_initial_bucket == 0) {
-        memcpy(new_map_bucket, bucket, self->bucket_size);
-        break;
-      }
+  void* table   = c_internal_map_alloc_table(self, self->capacity);
+  void* entries = NULL;
+  if (table && ordered) {
+    entries = c_internal_map_alloc_entries(self, self->capacity);
+  }
+  if (!table || (ordered && !entries)) {
+    c_internal_map_free(self, table,
+                        c_internal_map_table_size(self, self->capacity));
+    self->bucket_size = old_bucket_size;
+    return C_MAP_ERROR_mem_allocation;
+  }
 
-      if (new_map_bucket->distance_from_initial_bucket
-          < bucket->distance_from_initial_bucket) {
-        // swap
-        memcpy(self->spare_bucket2, bucket, self->bucket_size);
-        memcpy(bucket, new_map_bucket, self->bucket_size);
-        memcpy(new_map_bucket, self->spare_bucket2, self->bucket_size);
-      }
+  c_internal_map_free(self, self->spare_bucket1, old_table_size);
+  c_internal_map_free(
+      self, self->entries.data,
+      c_internal_map_entries_size(self, self->entries.capacity));
 
-      bucket->distance_from_initial_bucket += 1;
-    }
+  self->entries.data     = entries;
+  self->entries.len      = 0;
+  self->entries.capacity = ordered ? self->capacity : 0;
+  c_internal_map_set_table(self, table, self->capacity);
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_map_save(CMap* self, char const path[], size_t path_len)
+{
+  C_ARR_CHECK_PARAMS(self && self->buckets);
+  C_ARR_CHECK_PARAMS(path && (path_len > 0) && (path[path_len] == '\0'));
+
+  // the snapshot holds a single table
+  if (self->old.buckets) { c_internal_map_migrate(self, SIZE_MAX); }
+
+  CMapSnapshotHeader header = {0};
+  memcpy(header.magic, "CMAP", sizeof(header.magic));
+  header.version         = C_MAP_SNAPSHOT_VERSION;
+  header.flags           = self->entries.data ? C_MAP_SNAPSHOT_ORDERED : 0;
+  header.byte_order      = 0x01020304;
+  header.size_t_size     = sizeof(size_t);
+  header.key_size        = self->key_size.orig;
+  header.value_size      = self->value_size.orig;
+  header.capacity        = self->capacity;
+  header.len             = self->len;
+  header.entries_len     = self->entries.len;
+  header.max_load_factor = self->load_factor.max;
+  header.min_load_factor = self->load_factor.min;
+
+  FILE* file = fopen(path, "wb");
+  if (!file) return C_MAP_ERROR_file_io;
+
+  bool written
+      = (fwrite(&header, sizeof(header), 1, file) == 1)
+        && (fwrite(self->spare_bucket1,
+                   c_internal_map_table_size(self, self->capacity), 1, file)
+            == 1)
+        && (!self->entries.data
+            || (fwrite(self->entries.data,
+                       c_internal_map_entries_size(self,
+                                                   self->entries.capacity),
+                       1, file)
+                == 1));
+  written = (fclose(file) == 0) && written;
+
+  return written ? C_MAP_ERROR_none : C_MAP_ERROR_file_io;
+}
+
+c_map_error_t
+c_map_load(char const path[], size_t path_len, CMap* out_map)
+{
+  C_ARR_CHECK_PARAMS(path && (path_len > 0) && (path[path_len] == '\0'));
+
+  if (!out_map) { return C_MAP_ERROR_none; }
+
+  *out_map = (CMap){0};
+
+  FILE* file = fopen(path, "rb");
+  if (!file) return C_MAP_ERROR_file_io;
+
+  CMapSnapshotHeader header = {0};
+  CMap               map    = {0};
+  c_map_error_t      err    = C_MAP_ERROR_bad_snapshot;
+  if (fread(&header, sizeof(header), 1, file) == 1) {
+    err = c_internal_map_parse_snapshot_header(&header, &map);
+  }
+  if (err.code != 0) {
+    fclose(file);
+    return err;
+  }
+
+  map.allocator = (CMapAllocator){c_internal_map_malloc,
+                                  c_internal_map_malloc_free, NULL};
+
+  size_t capacity = (size_t)header.capacity;
+  bool   ordered  = header.flags & C_MAP_SNAPSHOT_ORDERED;
+  void*  table    = c_internal_map_alloc_table(&map, capacity);
+  void*  entries
+      = ordered ? c_internal_map_alloc_entries(&map, capacity) : NULL;
+  if (!table || (ordered && !entries)) {
+    c_internal_map_free(&map, table, c_internal_map_table_size(&map, capacity));
+    c_internal_map_free(&map, entries,
+                        c_internal_map_entries_size(&map, capacity));
+    fclose(file);
+    return C_MAP_ERROR_mem_allocation;
+  }
+
+  bool loaded
+      = (fread(table, c_internal_map_table_size(&map, capacity), 1, file) == 1)
+        && (!entries
+            || (fread(entries, c_internal_map_entries_size(&map, capacity), 1,
+                      file)
+                == 1));
+  fclose(file);
+  if (!loaded) {
+    c_internal_map_free(&map, table, c_internal_map_table_size(&map, capacity));
+    c_internal_map_free(&map, entries,
+                        c_internal_map_entries_size(&map, capacity));
+    return C_MAP_ERROR_bad_snapshot;
+  }
+
+  c_internal_map_set_table(&map, table, capacity);
+  map.entries.data     = entries;
+  map.entries.capacity = ordered ? capacity : 0;
+  *out_map             = map;
+
+  return c_internal_map_create_counters(out_map);
+}
+
+c_map_error_t
+c_map_open_mmap(char const path[], size_t path_len, CMap* out_map)
+{
+  C_ARR_CHECK_PARAMS(path && (path_len > 0) && (path[path_len] == '\0'));
+
+  if (!out_map) { return C_MAP_ERROR_none; }
+
+  *out_map = (CMap){0};
+
+  void*         data = NULL;
+  size_t        size = 0;
+  c_map_error_t err  = c_internal_map_map_file(path, &data, &size);
+  if (err.code != 0) return err;
+
+  CMapSnapshotHeader const* header = data;
+  CMap                      map    = {0};
+  err = c_internal_map_parse_snapshot_header(header, &map);
+
+  size_t capacity   = (size_t)header->capacity;
+  bool   ordered    = header->flags & C_MAP_SNAPSHOT_ORDERED;
+  size_t table_size = 0;
+  if (err.code == 0) {
+    table_size = c_internal_map_table_size(&map, capacity);
+    if (size != (sizeof(*header) + table_size
+                 + (ordered ? c_internal_map_entries_size(&map, capacity)
+                            : 0))) {
+      err = C_MAP_ERROR_bad_snapshot;
+    }
+  }
+  if (err.code != 0) {
+    c_internal_map_unmap_file(data, size);
+    return err;
+  }
+
+  char* table = (char*)data + sizeof(*header);
+  c_internal_map_set_table(&map, table, capacity);
+  map.entries.data     = ordered ? (table + table_size) : NULL;
+  map.entries.capacity = ordered ? capacity : 0;
+  map.mapped.data      = data;
+  map.mapped.size      = size;
+  *out_map             = map;
+
+  return c_internal_map_create_counters(out_map);
+}
+
+c_map_error_t
+c_map_stats(CMap const* self, CMapStats* out_stats)
+{
+  C_ARR_CHECK_PARAMS(self && self->buckets);
+
+  if (!out_stats) return C_MAP_ERROR_none;
+  *out_stats = (CMapStats){0};
+
+  out_stats->len        = self->len;
+  out_stats->capacity   = self->capacity;
+  if (self->counters) {
+    out_stats->resizes    = self->counters->resizes;
+    out_stats->lookups    = self->counters->lookups;
+    out_stats->collisions = self->counters->collisions;
+  }
+  if (out_stats->lookups) {
+    out_stats->collision_rate
+        = (double)out_stats->collisions / (double)out_stats->lookups;
+  }
+
+  // an incremental resize can leave entries in the old table too
+  struct {
+    void*  buckets;
+    size_t mask;
+  } const tables[] = {
+      {self->buckets, self->mask},
+      {self->old.buckets, self->old.mask},
+  };
+
+  size_t total_distance = 0;
+  size_t entries        = 0;
+  for (size_t ttt = 0; ttt < (sizeof(tables) / sizeof(*tables)); ++ttt) {
+    void*  buckets = tables[ttt].buckets;
+    size_t mask    = tables[ttt].mask;
+    if (!buckets) continue;
+
+    size_t    capacity = mask + 1;
+    uint64_t* bitmap   = c_internal_map_get_bitmap(self, buckets, mask);
+    for (size_t iii = c_internal_map_next_set_bit(bitmap, 0, capacity);
+         iii < capacity;
+         iii = c_internal_map_next_set_bit(bitmap, iii + 1, capacity)) {
+      size_t distance = c_internal_map_get_bucket(self, buckets, iii)
+                            ->distance_from_initial_bucket;
+
+      total_distance += distance;
+      entries++;
+      if (distance > out_stats->max_distance) {
+        out_stats->max_distance = distance;
+      }
+      out_stats->histogram[(distance < CMAP_STATS_HISTOGRAM_LEN)
+                               ? (distance - 1)
+                               : (CMAP_STATS_HISTOGRAM_LEN - 1)]++;
+    }
+  }
+
+  if (entries) {
+    out_stats->avg_distance = (double)total_distance / (double)entries;
+  }
+
+  return C_MAP_ERROR_none;
+}
+
+bool
+c_map_iter(CMap* self, size_t* iter, void** key, void** value)
+{
+  if (!iter) return false;
+
+  if (self->entries.data) {
+    *iter = c_internal_map_next_set_bit(
+        c_internal_map_get_entries_bitmap(self, self->entries.data,
+                                          self->entries.capacity),
+        *iter, self->entries.len);
+    if (*iter >= self->entries.len) return false;
+
+    char* entry
+        = c_internal_map_get_entry(self, self->entries.data, *iter);
+    if (key) { *key = entry; }
+    if (value) { *value = entry + self->key_size.aligned; }
+    (*iter)++;
+    return true;
+  }
+
+  // the current table first then the one being drained (if any)
+  CMapBucket* bucket = NULL;
+  if (*iter < self->capacity) {
+    *iter = c_internal_map_next_set_bit(
+        c_internal_map_get_bitmap(self, self->buckets, self->mask), *iter,
+        self->capacity);
+    if (*iter < self->capacity) {
+      bucket = c_internal_map_get_bucket(self, self->buckets, *iter);
+    }
+  }
+  if (!bucket && self->old.buckets) {
+    *iter = self->capacity
+            + c_internal_map_next_set_bit(
+                c_internal_map_get_bitmap(self, self->old.buckets,
+                                          self->old.mask),
+                *iter - self->capacity, self->old.capacity);
+    if (*iter < (self->capacity + self->old.capacity)) {
+      bucket = c_internal_map_get_bucket(self, self->old.buckets,
+                                         *iter - self->capacity);
+    }
+  }
+  if (!bucket) return false;
+
+  if (key) { *key = c_internal_map_get_key(self, bucket); }
+  if (value) { *value = c_internal_map_get_value(self, bucket); }
+  (*iter)++;
+
+  return true;
+}
+
+void
+c_map_destroy(CMap* self,
+              void  element_destroy_fn(void* key, void* value, void* user_data),
+              void* user_data)
+{
+  if (self && self->buckets) {
+    if (element_destroy_fn) {
+      c_map_clear(self, element_destroy_fn, user_data);
+    }
+    if (self->old.buckets) {
+      c_internal_map_free(
+          self,
+          (char*)self->old.buckets - (spare_buckets_count * self->bucket_size),
+          c_internal_map_table_size(self, self->old.capacity));
+    }
+    if (self->mapped.data) {
+      c_internal_map_unmap_file(self->mapped.data, self->mapped.size);
+    } else {
+      c_internal_map_free(self, self->spare_bucket1,
+                          c_internal_map_table_size(self, self->capacity));
+      c_internal_map_free(
+          self, self->entries.data,
+          c_internal_map_entries_size(self, self->entries.capacity));
+    }
+    free(self->counters);
+    *self = (CMap){0};
+  }
+}
+
+// ------------------------- internal ------------------------- //
+
+size_t
+c_internal_map_hash(const void* data, size_t data_len)
+{
+  /// TODO: make the hash algo changeable
+  return c_internal_map_clip_hash(c_internal_map_hash_fnv(data, data_len));
+}
+
+size_t
+c_internal_map_hash_fnv(const void* data, size_t data_len)
+{
+  // Constants for the FNV-1a hash function
+  const size_t fnv_prime = 1099511628211U;
+  size_t       hash      = 14695981039346656037U; // FNV offset basis
+
+  const uint8_t* bytes = (const uint8_t*)data;
+
+  for (size_t i = 0; i < data_len; i++) {
+    hash ^= bytes[i];  // XOR the byte with the hash
+    hash *= fnv_prime; // Multiply by the FNV prime
+  }
+
+  return hash;
+}
+
+c_map_error_t
+c_internal_map_resize(CMap* self, size_t new_capacity)
+{
+  if (self->entries.data) {
+    c_map_error_t err = c_internal_map_resize_ordered(self, new_capacity);
+    if (!err.code) { C_MAP_STATS_COUNT(self, resizes); }
+    return err;
+  }
+
+  // only one table can be drained at a time
+  if (self->old.buckets) { c_internal_map_migrate(self, SIZE_MAX); }
+
+  void* table = c_internal_map_alloc_table(self, new_capacity);
+  if (!table) return C_MAP_ERROR_mem_allocation;
+
+  // spare_bucket1 and spare_bucket2
+  memcpy(table, self->spare_bucket1, 2 * self->bucket_size);
+
+  if (self->rehash_step) {
+    // keep the current table around, it gets drained by later operations
+    self->old.buckets  = self->buckets;
+    self->old.capacity = self->capacity;
+    self->old.len      = self->len;
+    self->old.mask     = self->mask;
+    self->old.cursor   = 0;
+  } else {
+    void* buckets = (char*)table + (spare_buckets_count * self->bucket_size);
+    uint64_t* bitmap
+        = c_internal_map_get_bitmap(self, self->buckets, self->mask);
+
+    for (size_t iii = c_internal_map_next_set_bit(bitmap, 0, self->capacity);
+         iii < self->capacity;
+         iii = c_internal_map_next_set_bit(bitmap, iii + 1, self->capacity)) {
+      CMapBucket* bucket
+          = c_internal_map_get_bucket(self, self->buckets, iii);
+
+      bucket->distance_from_initial_bucket = 1;
+      c_internal_map_put(self, buckets, new_capacity - 1, bucket, NULL);
+    }
+
+    c_internal_map_free(self, self->spare_bucket1,
+                        c_internal_map_table_size(self, self->capacity));
+  }
+
+  c_internal_map_set_table(self, table, new_capacity);
+  C_MAP_STATS_COUNT(self, resizes);
+
+  if (self->old.buckets) {
+    // the operations left before the next grow or shrink have to empty the
+    // old table, otherwise that resize would move the rest all at once. the
+    // one that triggers it doesn't count, it is already empty by then
+    size_t room = (self->load_factor.grow_len > self->len)
+                      ? self->load_factor.grow_len - self->len - 1
+                      : 0;
+    if ((self->load_factor.min > 0.0f)
+        && (self->len > self->load_factor.shrink_len)
+        && (self->len - self->load_factor.shrink_len - 1 < room)) {
+      room = self->len - self->load_factor.shrink_len - 1;
+    }
+
+    self->old.step = room ? (self->old.len + room - 1) / room : SIZE_MAX;
+    if (self->old.step < self->rehash_step) {
+      self->old.step = self->rehash_step;
+    }
+  }
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_internal_map_resize_ordered(CMap* self, size_t new_capacity)
+{
+  void* table   = c_internal_map_alloc_table(self, new_capacity);
+  void* entries = c_internal_map_alloc_entries(self, new_capacity);
+  if (!table || !entries) {
+    c_internal_map_free(self, table,
+                        c_internal_map_table_size(self, new_capacity));
+    c_internal_map_free(self, entries,
+                        c_internal_map_entries_size(self, new_capacity));
+    return C_MAP_ERROR_mem_allocation;
+  }
+
+  // spare_bucket1 and spare_bucket2
+  memcpy(table, self->spare_bucket1, 2 * self->bucket_size);
+  // the spare entry (the last removed one)
+  memcpy(c_internal_map_get_entry(self, entries, new_capacity),
+         c_internal_map_get_entry(self, self->entries.data,
+                                  self->entries.capacity),
+         self->entries.size);
+
+  // compact the entries dropping the holes, then index them again
+  void* buckets = (char*)table + (spare_buckets_count * self->bucket_size);
+  CMapBucket* moved_bucket
+      = (CMapBucket*)((char*)buckets - self->bucket_size);
+  uint64_t* old_bitmap = c_internal_map_get_entries_bitmap(
+      self, self->entries.data, self->entries.capacity);
+  uint64_t* new_bitmap
+      = c_internal_map_get_entries_bitmap(self, entries, new_capacity);
+  size_t len = 0;
+
+  for (size_t iii = c_internal_map_next_set_bit(old_bitmap, 0,
+                                                self->entries.len);
+       iii < self->entries.len;
+       iii = c_internal_map_next_set_bit(old_bitmap, iii + 1,
+                                         self->entries.len)) {
+    void* entry = c_internal_map_get_entry(self, entries, len);
+    memcpy(entry, c_internal_map_get_entry(self, self->entries.data, iii),
+           self->entries.size);
+    new_bitmap[len / 64] |= (uint64_t)1 << (len % 64);
+
+    moved_bucket->distance_from_initial_bucket = 1;
+    moved_bucket->hash = c_internal_map_hash(entry, self->key_size.orig);
+    *(size_t*)(&moved_bucket[1]) = len;
+    c_internal_map_put(self, buckets, new_capacity - 1, moved_bucket, NULL);
+
+    len++;
+  }
+  assert(len == self->len);
+
+  c_internal_map_free(self, self->spare_bucket1,
+                      c_internal_map_table_size(self, self->capacity));
+  c_internal_map_free(
+      self, self->entries.data,
+      c_internal_map_entries_size(self, self->entries.capacity));
+
+  self->entries.data     = entries;
+  self->entries.len      = len;
+  self->entries.capacity = new_capacity;
+  c_internal_map_set_table(self, table, new_capacity);
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_internal_map_insert_entry(CMap*       self,
+                            void const* key,
+                            void const* value,
+                            size_t      hash)
+{
+  CMapBucket* bucket
+      = c_internal_map_find(self, self->buckets, self->mask, key, hash);
+  if (bucket) {
+    // updating a key keeps its position
+    if (value) {
+      memcpy(c_internal_map_get_value(self, bucket), value,
+             self->value_size.orig);
+    }
+    return C_MAP_ERROR_none;
+  }
+
+  // `len` is below the capacity, so a full array has holes to compact
+  if (self->entries.len == self->entries.capacity) {
+    c_map_error_t err = c_internal_map_resize_ordered(self, self->capacity);
+    if (err.code != 0) { return err; }
+  }
+
+  size_t index = self->entries.len++;
+  char*  entry = c_internal_map_get_entry(self, self->entries.data, index);
+  memcpy(entry, key, self->key_size.orig);
+  if (value) {
+    memcpy(entry + self->key_size.aligned, value, self->value_size.orig);
+  }
+  uint64_t* bitmap = c_internal_map_get_entries_bitmap(
+      self, self->entries.data, self->entries.capacity);
+  bitmap[index / 64] |= (uint64_t)1 << (index % 64);
+
+  CMapBucket* new_bucket                   = self->spare_bucket1;
+  new_bucket->distance_from_initial_bucket = 1;
+  new_bucket->hash                         = hash;
+  *(size_t*)(&new_bucket[1])               = index;
+  c_internal_map_put(self, self->buckets, self->mask, new_bucket, NULL);
+  self->len++;
+
+  return C_MAP_ERROR_none;
+}
+
+void
+c_internal_map_drop_entry(CMap* self, size_t index)
+{
+  // the slot becomes a hole, unless it is the last one
+  uint64_t* bitmap = c_internal_map_get_entries_bitmap(
+      self, self->entries.data, self->entries.capacity);
+  bitmap[index / 64] &= ~((uint64_t)1 << (index % 64));
+  if (index == (self->entries.len - 1)) { self->entries.len--; }
+}
+
+void*
+c_internal_map_alloc(CMap const* self, size_t size)
+{
+  return self->allocator.alloc(size, self->allocator.ctx);
+}
+
+void
+c_internal_map_free(CMap const* self, void* ptr, size_t size)
+{
+  if (ptr) { self->allocator.free(ptr, size, self->allocator.ctx); }
+}
+
+void*
+c_internal_map_alloc_table(CMap const* self, size_t capacity)
+{
+  size_t size  = c_internal_map_table_size(self, capacity);
+  void*  table = c_internal_map_alloc(self, size);
+  if (table) { memset(table, 0, size); }
+
+  return table;
+}
+
+void*
+c_internal_map_alloc_entries(CMap const* self, size_t capacity)
+{
+  size_t size    = c_internal_map_entries_size(self, capacity);
+  void*  entries = c_internal_map_alloc(self, size);
+  if (entries) { memset(entries, 0, size); }
+
+  return entries;
+}
+
+size_t
+c_internal_map_table_size(CMap const* self, size_t capacity)
+{
+  // { [spare buckets], [buckets], [occupancy bitmap] }
+  return ((capacity + spare_buckets_count) * self->bucket_size)
+         + (((capacity + 63) / 64) * sizeof(uint64_t));
+}
+
+void
+c_internal_map_set_table(CMap* self, void* table, size_t capacity)
+{
+  self->spare_bucket1 = table;
+  self->spare_bucket2 = (char*)table + self->bucket_size;
+  self->buckets  = (char*)table + (spare_buckets_count * self->bucket_size);
+  self->capacity = capacity;
+  self->mask     = capacity - 1;
+  c_internal_map_update_limits(self);
+}
+
+size_t
+c_internal_map_entries_size(CMap const* self, size_t capacity)
+{
+  // { [entries], [spare entry], [occupancy bitmap] }
+  return ((capacity + 1) * self->entries.size)
+         + (((capacity + 63) / 64) * sizeof(uint64_t));
+}
+
+void
+c_internal_map_migrate(CMap* self, size_t steps)
+{
+  // the old table stays a valid robin hood table the whole time (removals are
+  // backward shifts), so the cursor is only a hint of where to look next.
+  // only moved entries count as steps, the backward shift often leaves the
+  // cursor on an empty bucket and skipping it doesn't drain anything
+  while (steps && self->old.len) {
+    CMapBucket* bucket = c_internal_map_get_bucket(self, self->old.buckets,
+                                                   self->old.cursor);
+    if (!bucket->distance_from_initial_bucket) {
+      self->old.cursor = (self->old.cursor + 1) & self->old.mask;
+      continue;
+    }
+    steps--;
+
+    CMapBucket* moved_bucket
+        = (CMapBucket*)((char*)self->buckets - self->bucket_size);
+    memcpy(moved_bucket, bucket, self->bucket_size);
+    c_internal_map_erase(self, self->old.buckets, self->old.mask, bucket);
+    self->old.len--;
+
+    moved_bucket->distance_from_initial_bucket = 1;
+    c_internal_map_put(self, self->buckets, self->mask, moved_bucket, NULL);
+  }
+
+  if (self->old.buckets && !self->old.len) {
+    c_internal_map_free(
+        self,
+        (char*)self->old.buckets - (spare_buckets_count * self->bucket_size),
+        c_internal_map_table_size(self, self->old.capacity));
+    self->old.buckets  = NULL;
+    self->old.capacity = 0;
+    self->old.mask     = 0;
+    self->old.cursor   = 0;
+    self->old.step     = 0;
+  }
+}
+
+c_map_error_t
+c_internal_map_create_counters(CMap* self)
+{
+#ifdef C_MAP_STATS
+  self->counters = calloc(1, sizeof(*self->counters));
+  if (!self->counters) {
+    c_map_destroy(self, NULL, NULL);
+    return C_MAP_ERROR_mem_allocation;
+  }
+#else
+  (void)self;
+#endif
+
+  return C_MAP_ERROR_none;
+}
+
+void
+c_internal_map_update_limits(CMap* self)
+{
+  self->load_factor.grow_len
+      = (size_t)((double)self->capacity * self->load_factor.max);
+  self->load_factor.shrink_len
+      = (size_t)((double)self->capacity * self->load_factor.min);
+
+  // always keep an empty bucket so probing for a missing key terminates
+  if (self->load_factor.grow_len >= self->capacity) {
+    self->load_factor.grow_len = self->capacity - 1;
+  }
+  if (self->load_factor.grow_len == 0) { self->load_factor.grow_len = 1; }
+}
+
+void
+c_internal_map_set_layout(CMap* self, size_t key_size, size_t value_size)
+{
+  // pack the key and the value as tight as their natural alignment allows,
+  // the key only gets padded so the value is aligned and the value so the
+  // next bucket header is aligned
+  size_t value_alignment    = c_internal_map_alignment_of(value_size);
+  size_t aligned_key_size   = key_size;
+  size_t aligned_value_size = value_size;
+  while (aligned_key_size & (value_alignment - 1)) {
+    aligned_key_size++;
+  }
+  while ((sizeof(CMapBucket) + aligned_key_size + aligned_value_size)
+         & (sizeof(CMapBucket) - 1)) {
+    aligned_value_size++;
+  }
+
+  self->key_size.orig      = key_size;
+  self->key_size.aligned   = aligned_key_size;
+  self->value_size.orig    = value_size;
+  self->value_size.aligned = aligned_value_size;
+  self->bucket_size
+      = sizeof(CMapBucket) + aligned_key_size + aligned_value_size;
+  self->entries.size = aligned_key_size + aligned_value_size;
+}
+
+c_map_error_t
+c_internal_map_parse_snapshot_header(CMapSnapshotHeader const* header,
+                                     CMap*                     out_map)
+{
+  if ((memcmp(header->magic, "CMAP", sizeof(header->magic)) != 0)
+      || (header->version != C_MAP_SNAPSHOT_VERSION)
+      || (header->byte_order != 0x01020304)
+      || (header->size_t_size != sizeof(size_t))) {
+    return C_MAP_ERROR_bad_snapshot;
   }
 
-  memcpy(new_map.spare_bucket1, self->spare_bucket1, self->bucket_size);
-  memcpy(new_map.spare_bucket2, self->spare_bucket2, self->bucket_size);
-  free(self->spare_bucket1);
+  // everything below is trusted later on, e.g. `len` must leave an empty
+  // bucket or lookups never terminate
+  bool   ordered  = header->flags & C_MAP_SNAPSHOT_ORDERED;
+  size_t capacity = (size_t)header->capacity;
+  if ((header->key_size == 0) || (header->key_size > SIZE_MAX / 4)
+      || (header->value_size > SIZE_MAX / 4)
+      || (capacity != header->capacity) || (capacity < CMAP_DEFAULT_CAPACITY)
+      || (capacity & (capacity - 1)) || (capacity > (SIZE_MAX / 1024))
+      || (header->len >= capacity)
+      || (ordered
+          && ((header->entries_len > capacity)
+              || (header->entries_len < header->len)))
+      || (!ordered && header->entries_len)
+      || !(header->max_load_factor > 0.0f && header->max_load_factor < 1.0f)
+      || !(header->min_load_factor >= 0.0f
+           && header->min_load_factor < (header->max_load_factor / 2.0f))) {
+    return C_MAP_ERROR_bad_snapshot;
+  }
 
-  self->spare_bucket1 = new_map.spare_bucket1;
-  self->spare_bucket2 = new_map.spare_bucket2;
-  self->buckets       = new_map.buckets;
-  self->capacity      = new_map.capacity;
-  self->mask          = new_map.mask;
+  c_internal_map_set_layout(out_map, (size_t)header->key_size,
+                            (size_t)header->value_size);
+  if (ordered) { out_map->bucket_size = sizeof(CMapBucket) + sizeof(size_t); }
+  out_map->len             = (size_t)header->len;
+  out_map->entries.len     = (size_t)header->entries_len;
+  out_map->load_factor.max = header->max_load_factor;
+  out_map->load_factor.min = header->min_load_factor;
 
   return C_MAP_ERROR_none;
 }
 
-void*
-c_internal_map_get_key(const CMap* self, size_t index)
-{
-  return (void*)(((char*)(c_internal_map_get_bucket(self, index)))
-                 + sizeof(CMapBucket));
-}
+c_map_error_t
+c_internal_map_map_file(char const path[], void** out_data, size_t* out_size)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return C_MAP_ERROR_file_io;
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size)) {
+    CloseHandle(file);
+    return C_MAP_ERROR_file_io;
+  }
+  if ((uint64_t)file_size.QuadPart < sizeof(CMapSnapshotHeader)) {
+    CloseHandle(file);
+    return C_MAP_ERROR_bad_snapshot;
+  }
+
+  // the view keeps the file mapped, both handles can go
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (!mapping) return C_MAP_ERROR_file_io;
+
+  *out_data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!*out_data) return C_MAP_ERROR_file_io;
+
+  *out_size = (size_t)file_size.QuadPart;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return C_MAP_ERROR_file_io;
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    close(fd);
+    return C_MAP_ERROR_file_io;
+  }
+  if ((size_t)file_stat.st_size < sizeof(CMapSnapshotHeader)) {
+    close(fd);
+    return C_MAP_ERROR_bad_snapshot;
+  }
+
+  // the mapping keeps the file alive, the descriptor can go
+  void* data
+      = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return C_MAP_ERROR_file_io;
+
+  *out_data = data;
+  *out_size = (size_t)file_stat.st_size;
+#endif
+
+  return C_MAP_ERROR_none;
+}
+
+void
+c_internal_map_unmap_file(void* data, size_t size)
+{
+#ifdef _WIN32
+  (void)size;
+  UnmapViewOfFile(data);
+#else
+  munmap(data, size);
+#endif
+}
+
+void*
+c_internal_map_malloc(size_t size, void* ctx)
+{
+  (void)ctx;
+  return malloc(size);
+}
+
+void
+c_internal_map_malloc_free(void* ptr, size_t size, void* ctx)
+{
+  (void)size;
+  (void)ctx;
+  free(ptr);
+}
+
+void*
+c_internal_map_huge_page_alloc(size_t size, void* ctx)
+{
+  (void)ctx;
+
+#ifndef C_MAP_HUGE_PAGES
+  return malloc(size);
+#else
+  if (size < C_MAP_HUGE_PAGE_SIZE) { return malloc(size); }
+  size = (size + (C_MAP_HUGE_PAGE_SIZE - 1)) & ~(C_MAP_HUGE_PAGE_SIZE - 1);
+
+#ifdef _WIN32
+  // large pages need the "lock pages in memory" privilege
+  void*  ptr        = NULL;
+  SIZE_T large_page = GetLargePageMinimum();
+  if (large_page && !(size % large_page)) {
+    ptr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                       PAGE_READWRITE);
+  }
+  if (!ptr) {
+    ptr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  }
+
+  return ptr;
+#else
+#ifdef MAP_HUGETLB
+  // only works if huge pages were reserved (vm.nr_hugepages)
+  void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (ptr != MAP_FAILED) { return ptr; }
+#endif
+
+  // transparent huge pages only back huge page aligned ranges, so map one
+  // huge page more than needed and trim both ends
+  char* range = mmap(NULL, size + C_MAP_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (range == MAP_FAILED) { return NULL; }
+
+  size_t head = (C_MAP_HUGE_PAGE_SIZE
+                 - ((uintptr_t)range & (C_MAP_HUGE_PAGE_SIZE - 1)))
+                & (C_MAP_HUGE_PAGE_SIZE - 1);
+  if (head) { munmap(range, head); }
+  munmap(range + head + size, C_MAP_HUGE_PAGE_SIZE - head);
+
+#ifdef MADV_HUGEPAGE
+  madvise(range + head, size, MADV_HUGEPAGE);
+#endif
+
+  return range + head;
+#endif
+#endif // C_MAP_HUGE_PAGES
+}
+
+void
+c_internal_map_huge_page_free(void* ptr, size_t size, void* ctx)
+{
+  (void)ctx;
+
+#ifndef C_MAP_HUGE_PAGES
+  (void)size;
+  free(ptr);
+#else
+  if (size < C_MAP_HUGE_PAGE_SIZE) {
+    free(ptr);
+    return;
+  }
+
+#ifdef _WIN32
+  VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+  munmap(ptr,
+         (size + (C_MAP_HUGE_PAGE_SIZE - 1)) & ~(C_MAP_HUGE_PAGE_SIZE - 1));
+#endif
+#endif // C_MAP_HUGE_PAGES
+}
+
+size_t
+c_internal_map_alignment_of(size_t size)
+{
+  // a type's alignment divides its size, so the largest power of 2 dividing
+  // the size (up to the bucket header's) is always enough
+  size_t alignment = 1;
+  while ((alignment < sizeof(CMapBucket)) && !(size & alignment)) {
+    alignment *= 2;
+  }
+
+  return alignment;
+}
+
+CMapBucket*
+c_internal_map_find(CMap const* self,
+                    void*       buckets,
+                    size_t      mask,
+                    void const* key,
+                    size_t      hash)
+{
+  C_MAP_STATS_COUNT(self, lookups);
+
+  for (size_t index = hash & mask, distance = 1;;
+       index = (index + 1) & mask, distance++) {
+    CMapBucket* bucket = c_internal_map_get_bucket(self, buckets, index);
+
+    // robin hood: the key would have taken this bucket from a richer one
+    if (bucket->distance_from_initial_bucket < distance) { return NULL; }
+
+    /// TODO: we need external compare method
+    if (bucket->hash == hash) {
+      if (memcmp(c_internal_map_get_key(self, bucket), key,
+                 self->key_size.orig)
+          == 0) {
+        return bucket;
+      }
+      C_MAP_STATS_COUNT(self, collisions);
+    }
+  }
+}
+
+CMapBucket*
+c_internal_map_put(CMap*       self,
+                   void*       buckets,
+                   size_t      mask,
+                   CMapBucket* new_bucket,
+                   void const* key)
+{
+  // `new_bucket` is the carried bucket, it gets swapped with richer ones on
+  // the way. if `key` is given and found before the first swap the existing
+  // bucket is overridden and returned
+  if (key) { C_MAP_STATS_COUNT(self, lookups); }
+
+  for (size_t index = new_bucket->hash & mask;; index = (index + 1) & mask) {
+    CMapBucket* bucket = c_internal_map_get_bucket(self, buckets, index);
+
+    // [1] empty bucket
+    if (bucket->distance_from_initial_bucket == 0) {
+      memcpy(bucket, new_bucket, self->bucket_size);
+      c_internal_map_get_bitmap(self, buckets, mask)[index / 64]
+          |= (uint64_t)1 << (index % 64);
+      return NULL;
+    }
+
+    // [2] found one, same hash, update it
+    /// TODO: we need external compare method
+    /// TODO: we need to return old data
+    if (key && (new_bucket->hash == bucket->hash)) {
+      if (memcmp(c_internal_map_get_key(self, bucket), key,
+                 self->key_size.orig)
+          == 0) {
+        memcpy(bucket, new_bucket, self->bucket_size);
+        return bucket;
+      }
+      C_MAP_STATS_COUNT(self, collisions);
+    }
+
+    // [3] found one, different hash, collision
+    if (bucket->distance_from_initial_bucket
+        < new_bucket->distance_from_initial_bucket) {
+      // swap
+      CMapBucket* tmp = (CMapBucket*)(self->spare_bucket2);
+      memcpy(tmp, bucket, self->bucket_size);
+      memcpy(bucket, new_bucket, self->bucket_size);
+      memcpy(new_bucket, tmp, self->bucket_size);
+      key = NULL; // the carried bucket is not the new key anymore
+    }
+
+    assert(new_bucket->distance_from_initial_bucket < UINT16_MAX);
+    new_bucket->distance_from_initial_bucket++;
+  }
+}
+
+void
+c_internal_map_make_room(CMap* self, size_t index)
+{
+  // shift the buckets from `index` up to the next empty one forward by one,
+  // the same as carrying them with `c_internal_map_put` but without probing
+  // from their home buckets again
+  size_t empty = index;
+  while (c_internal_map_get_bucket(self, self->buckets, empty)
+             ->distance_from_initial_bucket) {
+    empty = (empty + 1) & self->mask;
+  }
+  c_internal_map_get_bitmap(self, self->buckets, self->mask)[empty / 64]
+      |= (uint64_t)1 << (empty % 64);
+
+  for (size_t iii = empty; iii != index;) {
+    size_t      prev   = (iii - 1) & self->mask;
+    CMapBucket* bucket = c_internal_map_get_bucket(self, self->buckets, iii);
+    memcpy(bucket, c_internal_map_get_bucket(self, self->buckets, prev),
+           self->bucket_size);
+    assert(bucket->distance_from_initial_bucket < UINT16_MAX);
+    bucket->distance_from_initial_bucket++;
+    iii = prev;
+  }
+}
+
+void
+c_internal_map_erase(CMap* self, void* buckets, size_t mask, CMapBucket* bucket)
+{
+  // backward shift deletion
+  size_t index = (size_t)((char*)bucket - (char*)buckets) / self->bucket_size;
+
+  for (;;) {
+    CMapBucket* prev       = bucket;
+    size_t      prev_index = index;
+    index                  = (index + 1) & mask;
+    bucket = c_internal_map_get_bucket(self, buckets, index);
+    if (bucket->distance_from_initial_bucket <= 1) {
+      prev->distance_from_initial_bucket = 0;
+      c_internal_map_get_bitmap(self, buckets, mask)[prev_index / 64]
+          &= ~((uint64_t)1 << (prev_index % 64));
+      break;
+    }
+
+    memcpy(prev, bucket, self->bucket_size);
+    prev->distance_from_initial_bucket--;
+  }
+}
+
+void*
+c_internal_map_get_key(const CMap* self, CMapBucket* bucket)
+{
+  if (self->entries.data) {
+    return c_internal_map_get_entry(self, self->entries.data,
+                                    *(size_t*)(&bucket[1]));
+  }
+
+  return (void*)(((char*)bucket) + sizeof(CMapBucket));
+}
+
+void*
+c_internal_map_get_value(const CMap* self, CMapBucket* bucket)
+{
+  return (void*)(((char*)c_internal_map_get_key(self, bucket))
+                 + self->key_size.aligned);
+}
+
+CMapBucket*
+c_internal_map_get_bucket(const CMap* self, void* buckets, size_t index)
+{
+  return (CMapBucket*)(((char*)buckets) + (self->bucket_size * index));
+}
+
+void*
+c_internal_map_get_entry(const CMap* self, void* entries, size_t index)
+{
+  return (void*)(((char*)entries) + (self->entries.size * index));
+}
+
+uint64_t*
+c_internal_map_get_bitmap(const CMap* self, void* buckets, size_t mask)
+{
+  return (uint64_t*)(((char*)buckets) + (self->bucket_size * (mask + 1)));
+}
+
+uint64_t*
+c_internal_map_get_entries_bitmap(const CMap* self,
+                                  void*       entries,
+                                  size_t      capacity)
+{
+  return (uint64_t*)(((char*)entries) + (self->entries.size * (capacity + 1)));
+}
+
+size_t
+c_internal_map_next_set_bit(uint64_t const* bitmap, size_t index, size_t end)
+{
+  if (index >= end) return end;
+
+  // bits past `end` are never set
+  uint64_t word = bitmap[index / 64] & (UINT64_MAX << (index % 64));
+  index -= index % 64;
+  while (!word) {
+    index += 64;
+    if (index >= end) return end;
+    word = bitmap[index / 64];
+  }
+
+  index += c_internal_map_ctz(word);
+  return (index < end) ? index : end;
+}
+
+size_t
+c_internal_map_ctz(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (size_t)__builtin_ctzll(word);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, word);
+  return index;
+#else
+  size_t index = 0;
+  while (!(word & 1)) {
+    word >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+size_t
+c_internal_map_clip_hash(size_t hash)
+{
+  return hash & 0xFFFFFFFFFFFF;
+}
+
+#undef CSTDLIB_MAP_IMPLEMENTATION
+#endif // CSTDLIB_MAP_IMPLEMENTATION
+
+#ifdef CSTDLIB_MAP_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#include <stdio.h>
+
+#define MAP_STR(str) str, (sizeof(str) - 1)
+#define MAP_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define MAP_TEST(err)                                                          \
+  ((err.code != C_MAP_ERROR_none.code) ? MAP_TEST_PRINT_ABORT(err.desc)        \
+                                       : (void)0)
+#define MAP_ASSERT(cond) (!(cond)) ? MAP_TEST_PRINT_ABORT(#cond) : (void)0
+
+static bool  map_test_retain_below(void* key, void* value, void* ctx);
+static void* map_test_alloc(size_t size, void* ctx);
+static void  map_test_free(void* ptr, size_t size, void* ctx);
+
+int
+main(void)
+{
+  c_map_error_t err = {0};
+  CMap          map = {0};
+  err               = c_map_create(sizeof(char[20]), sizeof(int), &map);
+  MAP_TEST(err);
+
+  {
+    err = c_map_insert(&map, (char[20]){"abc"}, &(int){1});
+    MAP_TEST(err);
+    err = c_map_insert(&map, (char[20]){"ahmed here"}, &(int){2});
+    MAP_TEST(err);
+    err = c_map_insert(&map, (char[20]){"abcd"}, &(int){3});
+    MAP_TEST(err);
+    err = c_map_insert(&map, (char[20]){"abc"}, &(int){4}); // test override
+    MAP_TEST(err);
+
+    int* value = NULL;
+
+    err = c_map_get(&map, (char[20]){"abc"}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(value && *value == 4);
+
+    err = c_map_get(&map, (char[20]){"abcd"}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(value && *value == 3);
+
+    err = c_map_get(&map, (char[20]){"xyz"}, (void**)&value); // test not exist
+    MAP_TEST(err);
+    MAP_ASSERT(!value);
+  }
+
+  // test: bucket packing
+  {
+    CMap small_map;
+    err = c_map_create(sizeof(uint32_t), sizeof(uint32_t), &small_map);
+    MAP_TEST(err);
+    MAP_ASSERT(small_map.bucket_size == 16);
+    c_map_destroy(&small_map, NULL, NULL);
+
+    // the value still gets aligned
+    err = c_map_create(sizeof(char[3]), sizeof(uint32_t), &small_map);
+    MAP_TEST(err);
+    MAP_ASSERT(small_map.bucket_size == 16);
+    MAP_ASSERT(small_map.key_size.aligned == 4);
+
+    err = c_map_insert(&small_map, (char[3]){"ab"}, &(uint32_t){7});
+    MAP_TEST(err);
+    uint32_t* value = NULL;
+    err = c_map_get(&small_map, (char[3]){"ab"}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(value && ((uintptr_t)value % sizeof(uint32_t)) == 0);
+    MAP_ASSERT(*value == 7);
+    c_map_destroy(&small_map, NULL, NULL);
+
+    err = c_map_create(sizeof(char[20]), sizeof(int), &small_map);
+    MAP_TEST(err);
+    MAP_ASSERT(small_map.bucket_size == 32);
+    c_map_destroy(&small_map, NULL, NULL);
+  }
+
+  // test: foreach
+  {
+    size_t iter  = 0;
+    char*  key   = NULL;
+    int*   value = NULL;
+    while (c_map_iter(&map, &iter, (void**)&key, (void**)&value)) {
+      printf("%s: %d\n", key, *value);
+    }
+  }
+
+  // test: remove
+  {
+    err = c_map_insert(&map, (char[20]){"new bucket"}, &(int){100});
+    MAP_TEST(err);
+
+    int* value;
+    err = c_map_remove(&map, (char[20]){"new bucket"}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(*value == 100);
+  }
+
+  c_map_destroy(&map, NULL, NULL);
+
+  // test: incremental resize
+  {
+    CMap imap;
+    err = c_map_create(sizeof(size_t), sizeof(size_t), &imap);
+    MAP_TEST(err);
+    err = c_map_set_incremental_resize(&imap, 4);
+    MAP_TEST(err);
+
+    size_t const count = 1000;
+    for (size_t iii = 0; iii < count; ++iii) {
+      err = c_map_insert(&imap, &iii, &(size_t){iii * 2});
+      MAP_TEST(err);
+    }
+    MAP_ASSERT(c_map_len(&imap) == count);
+
+    size_t* value = NULL;
+    for (size_t iii = 0; iii < count; ++iii) {
+      err = c_map_get(&imap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(value && *value == iii * 2);
+    }
+
+    size_t iter         = 0;
+    size_t visited_count = 0;
+    while (c_map_iter(&imap, &iter, NULL, NULL)) {
+      visited_count++;
+    }
+    MAP_ASSERT(visited_count == count);
+
+    for (size_t iii = 0; iii < count; iii += 2) {
+      err = c_map_remove(&imap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(*value == iii * 2);
+    }
+    MAP_ASSERT(c_map_len(&imap) == count / 2);
+
+    for (size_t iii = 0; iii < count; ++iii) {
+      err = c_map_get(&imap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT((iii % 2) ? (value && *value == iii * 2) : !value);
+    }
+
+    c_map_destroy(&imap, NULL, NULL);
+
+    // one entry per operation still empties the old table before the next
+    // resize is due, in both directions
+    err = c_map_create(sizeof(size_t), sizeof(size_t), &imap);
+    MAP_TEST(err);
+    err = c_map_set_load_factors(&imap, 0.9f, 0.2f);
+    MAP_TEST(err);
+    err = c_map_set_incremental_resize(&imap, 1);
+    MAP_TEST(err);
+
+    size_t resizes = 0;
+    for (size_t iii = 0; iii < 100000; ++iii) {
+      if (imap.len >= imap.load_factor.grow_len) {
+        MAP_ASSERT(!imap.old.buckets);
+        resizes++;
+      }
+      err = c_map_insert(&imap, &iii, &iii);
+      MAP_TEST(err);
+    }
+    for (size_t iii = 0; iii < 100000; ++iii) {
+      if ((imap.len - 1 <= imap.load_factor.shrink_len)
+          && (imap.capacity > CMAP_DEFAULT_CAPACITY)) {
+        MAP_ASSERT(!imap.old.buckets);
+        resizes++;
+      }
+      err = c_map_remove(&imap, &iii, (void**)&value);
+      MAP_TEST(err);
+    }
+    MAP_ASSERT(resizes > 20 && c_map_len(&imap) == 0);
+
+    c_map_destroy(&imap, NULL, NULL);
+  }
+
+  // test: load factors
+  {
+    CMap lmap;
+    err = c_map_create(sizeof(int), sizeof(int), &lmap);
+    MAP_TEST(err);
+
+    err = c_map_set_load_factors(&lmap, 1.0f, 0.1f);
+    MAP_ASSERT(err.code == C_MAP_ERROR_invalid_parameters.code);
+    err = c_map_set_load_factors(&lmap, 0.5f, 0.3f);
+    MAP_ASSERT(err.code == C_MAP_ERROR_invalid_parameters.code);
+    err = c_map_set_load_factors(&lmap, 0.5f, 0.125f);
+    MAP_TEST(err);
+
+    for (int iii = 0; iii < 100; ++iii) {
+      err = c_map_insert(&lmap, &iii, &iii);
+      MAP_TEST(err);
+      MAP_ASSERT(c_map_len(&lmap) <= lmap.capacity / 2);
+    }
+    MAP_ASSERT(lmap.capacity == 256);
+
+    int* value = NULL;
+    for (int iii = 0; iii < 90; ++iii) {
+      err = c_map_remove(&lmap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(*value == iii);
+    }
+    MAP_ASSERT(lmap.capacity == 64);
+
+    // 0 never shrinks, not even when the last key goes
+    err = c_map_set_load_factors(&lmap, 0.5f, 0.0f);
+    MAP_TEST(err);
+    for (int iii = 90; iii < 100; ++iii) {
+      err = c_map_remove(&lmap, &iii, (void**)&value);
+      MAP_TEST(err);
+    }
+    MAP_ASSERT(c_map_len(&lmap) == 0 && lmap.capacity == 64);
+
+    for (int iii = 0; iii < 100; ++iii) {
+      err = c_map_insert(&lmap, &iii, &iii);
+      MAP_TEST(err);
+    }
+    err = c_map_retain(&lmap, map_test_retain_below, &(int){0});
+    MAP_TEST(err);
+    MAP_ASSERT(c_map_len(&lmap) == 0 && lmap.capacity == 256);
+
+    c_map_destroy(&lmap, NULL, NULL);
+  }
+
+  // test: get many
+  {
+    CMap gmap;
+    err = c_map_create(sizeof(int), sizeof(int), &gmap);
+    MAP_TEST(err);
+
+    for (int iii = 0; iii < 100; ++iii) {
+      err = c_map_insert(&gmap, &iii, &(int){iii * 3});
+      MAP_TEST(err);
+    }
+
+    // more than one batch, with keys that are not in the map
+    int   keys[40];
+    void* values[40];
+    for (int iii = 0; iii < 40; ++iii) {
+      keys[iii] = iii * 5;
+    }
+
+    err = c_map_get_many(&gmap, keys, 40, values);
+    MAP_TEST(err);
+    for (int iii = 0; iii < 40; ++iii) {
+      if (keys[iii] < 100) {
+        MAP_ASSERT(values[iii] && *(int*)values[iii] == keys[iii] * 3);
+      } else {
+        MAP_ASSERT(!values[iii]);
+      }
+    }
+
+    c_map_destroy(&gmap, NULL, NULL);
+  }
+
+  // test: iterating a sparse map
+  {
+    CMap smap;
+    err = c_map_create(sizeof(int), sizeof(int), &smap);
+    MAP_TEST(err);
+    err = c_map_set_load_factors(&smap, CMAP_DEFAULT_MAX_LOAD_FACTOR, 0.0f);
+    MAP_TEST(err);
+
+    for (int iii = 0; iii < 1000; ++iii) {
+      err = c_map_insert(&smap, &iii, &iii);
+      MAP_TEST(err);
+    }
+    int* value = NULL;
+    for (int iii = 0; iii < 1000; ++iii) {
+      if (iii % 300 == 0) continue;
+      err = c_map_remove(&smap, &iii, (void**)&value);
+      MAP_TEST(err);
+    }
+
+    size_t iter = 0;
+    int*   key  = NULL;
+    int    sum  = 0;
+    while (c_map_iter(&smap, &iter, (void**)&key, (void**)&value)) {
+      MAP_ASSERT(*key == *value);
+      sum += *key;
+    }
+    MAP_ASSERT(sum == 0 + 300 + 600 + 900);
+
+    c_map_destroy(&smap, NULL, NULL);
+  }
+
+  // test: insertion ordered
+  {
+    CMap omap;
+    err = c_map_create(sizeof(int), sizeof(int), &omap);
+    MAP_TEST(err);
+    err = c_map_set_insertion_ordered(&omap, true);
+    MAP_TEST(err);
+    err = c_map_set_incremental_resize(&omap, 4);
+    MAP_ASSERT(err.code == C_MAP_ERROR_invalid_parameters.code);
+
+    for (int iii = 99; iii >= 0; --iii) {
+      err = c_map_insert(&omap, &iii, &(int){iii * 2});
+      MAP_TEST(err);
+    }
+    err = c_map_set_insertion_ordered(&omap, false);
+    MAP_ASSERT(err.code == C_MAP_ERROR_wrong_len.code);
+
+    // remove the even keys, then keep churning so the holes get compacted
+    int* value = NULL;
+    for (int iii = 0; iii < 100; iii += 2) {
+      err = c_map_remove(&omap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(*value == iii * 2);
+    }
+    for (int iii = 100; iii < 1000; ++iii) {
+      err = c_map_insert(&omap, &iii, &(int){iii * 2});
+      MAP_TEST(err);
+      err = c_map_remove(&omap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(*value == iii * 2);
+    }
+    err = c_map_insert(&omap, &(int){51}, &(int){-1}); // keeps its position
+    MAP_TEST(err);
+    MAP_ASSERT(c_map_len(&omap) == 50);
+
+    size_t iter     = 0;
+    int*   key      = NULL;
+    int    expected = 99;
+    while (c_map_iter(&omap, &iter, (void**)&key, (void**)&value)) {
+      MAP_ASSERT(*key == expected);
+      MAP_ASSERT(*value == ((expected == 51) ? -1 : expected * 2));
+      expected -= 2;
+    }
+    MAP_ASSERT(expected == -1);
+
+    for (int iii = 1; iii < 100; iii += 2) {
+      err = c_map_get(&omap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(value && *value == ((iii == 51) ? -1 : iii * 2));
+    }
+
+    c_map_destroy(&omap, NULL, NULL);
+  }
+
+  // test: save, load and mmap
+  {
+    // under the temp directory, the tests run from the source tree
+    char        path[512];
+    char const* tmp_dir = getenv("TMPDIR");
+#ifdef _WIN32
+    if (!tmp_dir) { tmp_dir = getenv("TEMP"); }
+    if (!tmp_dir) { tmp_dir = "."; }
+#else
+    if (!tmp_dir) { tmp_dir = "/tmp"; }
+#endif
+#ifdef _WIN32
+    unsigned long const pid = (unsigned long)GetCurrentProcessId();
+#else
+    unsigned long const pid = (unsigned long)getpid();
+#endif
+    // the pid keeps the variants of this test (run in parallel) apart
+    int const path_len = snprintf(path, sizeof(path),
+                                  "%s/cstdlib_map_snapshot_%lu.bin", tmp_dir,
+                                  pid);
+    MAP_ASSERT(path_len > 0 && (size_t)path_len < sizeof(path));
+
+    CMap smap;
+    err = c_map_create(sizeof(int), sizeof(int), &smap);
+    MAP_TEST(err);
+    for (int iii = 0; iii < 1000; ++iii) {
+      err = c_map_insert(&smap, &iii, &(int){iii * 7});
+      MAP_TEST(err);
+    }
+    err = c_map_save(&smap, path, (size_t)path_len);
+    MAP_TEST(err);
+    c_map_destroy(&smap, NULL, NULL);
+
+    CMap lmap;
+    err = c_map_load(path, (size_t)path_len, &lmap);
+    MAP_TEST(err);
+    MAP_ASSERT(c_map_len(&lmap) == 1000);
+    int* value = NULL;
+    err        = c_map_insert(&lmap, &(int){1000}, &(int){0});
+    MAP_TEST(err);
+    err = c_map_remove(&lmap, &(int){5}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(*value == 35);
+    err = c_map_get(&lmap, &(int){999}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(value && *value == 999 * 7);
+    c_map_destroy(&lmap, NULL, NULL);
+
+    CMap mmap_map;
+    err = c_map_open_mmap(path, (size_t)path_len, &mmap_map);
+    MAP_TEST(err);
+    MAP_ASSERT(c_map_len(&mmap_map) == 1000);
+    for (int iii = 0; iii < 1000; ++iii) {
+      err = c_map_get(&mmap_map, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(value && *value == iii * 7);
+    }
+    err = c_map_get(&mmap_map, &(int){1000}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(!value);
+    err = c_map_insert(&mmap_map, &(int){1000}, &(int){0});
+    MAP_ASSERT(err.code == C_MAP_ERROR_read_only.code);
+    err = c_map_remove(&mmap_map, &(int){1}, (void**)&value);
+    MAP_ASSERT(err.code == C_MAP_ERROR_read_only.code);
+
+    size_t iter       = 0;
+    size_t iter_count = 0;
+    while (c_map_iter(&mmap_map, &iter, NULL, NULL)) {
+      iter_count++;
+    }
+    MAP_ASSERT(iter_count == 1000);
+    c_map_destroy(&mmap_map, NULL, NULL);
+
+    // insertion ordered maps keep their order
+    CMap omap;
+    err = c_map_create(sizeof(int), sizeof(int), &omap);
+    MAP_TEST(err);
+    err = c_map_set_insertion_ordered(&omap, true);
+    MAP_TEST(err);
+    for (int iii = 50; iii > 0; --iii) {
+      err = c_map_insert(&omap, &iii, &iii);
+      MAP_TEST(err);
+    }
+    err = c_map_remove(&omap, &(int){25}, (void**)&value);
+    MAP_TEST(err);
+    err = c_map_save(&omap, path, (size_t)path_len);
+    MAP_TEST(err);
+    c_map_destroy(&omap, NULL, NULL);
+
+    err = c_map_open_mmap(path, (size_t)path_len, &omap);
+    MAP_TEST(err);
+    int* key      = NULL;
+    int  expected = 50;
+    iter          = 0;
+    while (c_map_iter(&omap, &iter, (void**)&key, (void**)&value)) {
+      if (expected == 25) expected--;
+      MAP_ASSERT(*key == expected && *value == expected);
+      expected--;
+    }
+    MAP_ASSERT(expected == 0);
+    c_map_destroy(&omap, NULL, NULL);
+
+    // not a snapshot
+    FILE* file = fopen(path, "wb");
+    MAP_ASSERT(file);
+    fputs("definitely not a map snapshot, but long enough to have a header",
+          file);
+    fclose(file);
+    err = c_map_load(path, (size_t)path_len, &lmap);
+    MAP_ASSERT(err.code == C_MAP_ERROR_bad_snapshot.code);
+    err = c_map_open_mmap(path, (size_t)path_len, &lmap);
+    MAP_ASSERT(err.code == C_MAP_ERROR_bad_snapshot.code);
+
+    remove(path);
+  }
+
+  // test: build from arrays
+  {
+    enum { build_count = 1000 };
+    int keys[build_count + 1];
+    int values[build_count + 1];
+    for (int iii = 0; iii < build_count; ++iii) {
+      keys[iii]   = iii;
+      values[iii] = iii * 3;
+    }
+    keys[build_count]   = 7; // a duplicate, the last value wins
+    values[build_count] = -7;
 
-void*
-c_internal_map_get_value(const CMap* self, size_t index)
-{
-  return (void*)(((char*)(c_internal_map_get_bucket(self, index)))
-                 + sizeof(CMapBucket) + self->key_size.aligned);
-}
+    CMap bmap;
+    err = c_map_build_from(sizeof(int), sizeof(int), keys, values,
+                           build_count + 1, &bmap);
+    MAP_TEST(err);
+    MAP_ASSERT(c_map_len(&bmap) == build_count);
+    MAP_ASSERT(bmap.capacity == 2048);
 
-CMapBucket*
-c_internal_map_get_bucket(const CMap* self, size_t index)
-{
-  return (CMapBucket*)(((char*)(self->buckets)) + (self->bucket_size * index));
-}
+    int* value = NULL;
+    for (int iii = 0; iii < build_count; ++iii) {
+      err = c_map_get(&bmap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(value && *value == ((iii == 7) ? -7 : iii * 3));
+    }
 
-size_t
-c_internal_map_clip_hash(size_t hash)
-{
-  return hash & 0xFFFFFFFFFFFF;
-}
+    // a regular map afterwards
+    err = c_map_insert(&bmap, &(int){build_count}, &(int){0});
+    MAP_TEST(err);
+    err = c_map_remove(&bmap, &(int){0}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(*value == 0);
+    MAP_ASSERT(c_map_len(&bmap) == build_count);
 
-#undef CSTDLIB_MAP_IMPLEMENTATION
-#endif // CSTDLIB_MAP_IMPLEMENTATION
+    c_map_destroy(&bmap, NULL, NULL);
+  }
 
-#ifdef CSTDLIB_MAP_UNIT_TESTS
-#ifdef NDEBUG
-#define NDEBUG_
-#undef NDEBUG
-#endif
+  // test: clone, in every mode
+  for (int mode = 0; mode < 3; ++mode) {
+    CMap omap;
+    err = c_map_create(sizeof(int), sizeof(int), &omap);
+    MAP_TEST(err);
+    if (mode == 1) {
+      err = c_map_set_incremental_resize(&omap, 1);
+      MAP_TEST(err);
+    } else if (mode == 2) {
+      err = c_map_set_insertion_ordered(&omap, true);
+      MAP_TEST(err);
+    }
 
-#include <stdio.h>
+    for (int iii = 0; iii < 1000; iii += 3) {
+      err = c_map_insert(&omap, &iii, &(int){iii * 5});
+      MAP_TEST(err);
+      err = c_map_remove(&omap, &iii, (void**)&(int*){NULL});
+      MAP_TEST(err);
+    }
+    // the incremental one is cloned in the middle of a migration
+    int count = 0;
+    while (count < 1000 || (mode == 1 && !omap.old.buckets)) {
+      if (count % 3) {
+        err = c_map_insert(&omap, &count, &(int){count * 5});
+        MAP_TEST(err);
+      }
+      count++;
+    }
+    MAP_ASSERT((mode == 1) == (omap.old.buckets != NULL));
 
-#define MAP_STR(str) str, (sizeof(str) - 1)
-#define MAP_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
-#define MAP_TEST(err)                                                          \
-  ((err.code != C_MAP_ERROR_none.code) ? MAP_TEST_PRINT_ABORT(err.desc)        \
-                                       : (void)0)
-#define MAP_ASSERT(cond) (!(cond)) ? MAP_TEST_PRINT_ABORT(#cond) : (void)0
+    CMap copy;
+    err = c_map_clone(&omap, &copy);
+    MAP_TEST(err);
+    MAP_ASSERT(c_map_len(&copy) == c_map_len(&omap));
+    MAP_ASSERT(copy.capacity == omap.capacity && !copy.old.buckets);
+
+    for (int iii = 0; iii < count; ++iii) {
+      int* value = NULL;
+      err        = c_map_get(&copy, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT((iii % 3) ? (value && *value == iii * 5) : !value);
+    }
 
-int
-main(void)
-{
-  c_map_error_t err = {0};
-  CMap          map = {0};
-  err               = c_map_create(sizeof(char[20]), sizeof(int), &map);
-  MAP_TEST(err);
+    // both iterate the same entries, in the same order when ordered
+    size_t iter      = 0;
+    size_t copy_iter = 0;
+    int*   key       = NULL;
+    int*   copy_key  = NULL;
+    size_t visited   = 0;
+    while (c_map_iter(&copy, &copy_iter, (void**)&copy_key, NULL)) {
+      MAP_ASSERT(c_map_iter(&omap, &iter, (void**)&key, NULL));
+      MAP_ASSERT((mode != 2) || (*key == *copy_key));
+      visited++;
+    }
+    MAP_ASSERT(visited == c_map_len(&omap));
 
-  {
-    err = c_map_insert(&map, (char[20]){"abc"}, &(int){1});
+    // and they don't share anything
+    err = c_map_insert(&copy, &(int){5000}, &(int){1});
     MAP_TEST(err);
-    err = c_map_insert(&map, (char[20]){"ahmed here"}, &(int){2});
+    err = c_map_remove(&copy, &(int){1}, (void**)&key);
     MAP_TEST(err);
-    err = c_map_insert(&map, (char[20]){"abcd"}, &(int){3});
+    int* value = NULL;
+    err        = c_map_get(&omap, &(int){5000}, (void**)&value);
+    MAP_ASSERT(!value);
+    err = c_map_get(&omap, &(int){1}, (void**)&value);
     MAP_TEST(err);
-    err = c_map_insert(&map, (char[20]){"abc"}, &(int){4}); // test override
+    MAP_ASSERT(value && *value == 5);
+
+    c_map_destroy(&copy, NULL, NULL);
+    c_map_destroy(&omap, NULL, NULL);
+  }
+
+  // test: retain
+  {
+    CMap rmap;
+    err = c_map_create(sizeof(int), sizeof(int), &rmap);
+    MAP_TEST(err);
+    for (int iii = 0; iii < 1000; ++iii) {
+      err = c_map_insert(&rmap, &iii, &iii);
+      MAP_TEST(err);
+    }
+
+    int limit = 100;
+    err       = c_map_retain(&rmap, map_test_retain_below, &limit);
     MAP_TEST(err);
+    MAP_ASSERT(c_map_len(&rmap) == 100);
+    // shrunk once, as far as the removals one by one would have
+    MAP_ASSERT(rmap.capacity == 256);
 
     int* value = NULL;
+    for (int iii = 0; iii < 1000; ++iii) {
+      err = c_map_get(&rmap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT((iii < limit) ? (value && *value == iii) : !value);
+    }
+    c_map_destroy(&rmap, NULL, NULL);
 
-    err = c_map_get(&map, (char[20]){"abc"}, (void**)&value);
+    // insertion ordered maps keep their order
+    err = c_map_create(sizeof(int), sizeof(int), &rmap);
     MAP_TEST(err);
-    MAP_ASSERT(value && *value == 4);
+    err = c_map_set_insertion_ordered(&rmap, true);
+    MAP_TEST(err);
+    for (int iii = 200; iii > 0; --iii) {
+      err = c_map_insert(&rmap, &iii, &iii);
+      MAP_TEST(err);
+    }
+    limit = 50;
+    err   = c_map_retain(&rmap, map_test_retain_below, &limit);
+    MAP_TEST(err);
+    MAP_ASSERT(c_map_len(&rmap) == 49);
+
+    size_t iter     = 0;
+    int*   key      = NULL;
+    int    expected = 49;
+    while (c_map_iter(&rmap, &iter, (void**)&key, (void**)&value)) {
+      MAP_ASSERT(*key == expected && *value == expected);
+      expected--;
+    }
+    MAP_ASSERT(expected == 0);
+    c_map_destroy(&rmap, NULL, NULL);
+  }
 
-    err = c_map_get(&map, (char[20]){"abcd"}, (void**)&value);
+  // test: get or insert, in every mode
+  for (int mode = 0; mode < 3; ++mode) {
+    CMap cmap;
+    err = c_map_create(sizeof(int), sizeof(int), &cmap);
     MAP_TEST(err);
-    MAP_ASSERT(value && *value == 3);
+    if (mode == 1) {
+      err = c_map_set_incremental_resize(&cmap, 1);
+      MAP_TEST(err);
+    } else if (mode == 2) {
+      err = c_map_set_insertion_ordered(&cmap, true);
+      MAP_TEST(err);
+    }
 
-    err = c_map_get(&map, (char[20]){"xyz"}, (void**)&value); // test not exist
+    size_t inserted_count = 0;
+    for (int iii = 0; iii < 2000; ++iii) {
+      int  key      = (iii * 7) % 500;
+      int* count    = NULL;
+      bool inserted = false;
+      err = c_map_get_or_insert(&cmap, &key, (void**)&count, &inserted);
+      MAP_TEST(err);
+      MAP_ASSERT(count && (inserted == (*count == 0)));
+      (*count)++;
+      inserted_count += inserted;
+    }
+    MAP_ASSERT(inserted_count == 500 && c_map_len(&cmap) == 500);
+
+    for (int iii = 0; iii < 500; ++iii) {
+      int* count = NULL;
+      err        = c_map_get(&cmap, &iii, (void**)&count);
+      MAP_TEST(err);
+      MAP_ASSERT(count && *count == 4);
+    }
+    c_map_destroy(&cmap, NULL, NULL);
+  }
+
+  // test: allocator
+  for (int mode = 0; mode < 3; ++mode) {
+    // live bytes, and the sizes have to match between alloc and free
+    size_t        live      = 0;
+    CMapAllocator allocator = {map_test_alloc, map_test_free, &live};
+
+    CMap amap;
+    err = c_map_create_with_allocator(sizeof(int), sizeof(int), 0, &allocator,
+                                      &amap);
     MAP_TEST(err);
-    MAP_ASSERT(!value);
+    MAP_ASSERT(live > 0);
+    if (mode == 1) {
+      err = c_map_set_incremental_resize(&amap, 2);
+      MAP_TEST(err);
+    } else if (mode == 2) {
+      err = c_map_set_insertion_ordered(&amap, true);
+      MAP_TEST(err);
+    }
+
+    for (int iii = 0; iii < 3000; ++iii) {
+      err = c_map_insert(&amap, &iii, &iii);
+      MAP_TEST(err);
+    }
+    int* value = NULL;
+    for (int iii = 0; iii < 2990; ++iii) {
+      err = c_map_remove(&amap, &iii, (void**)&value);
+      MAP_TEST(err);
+    }
+    c_map_destroy(&amap, NULL, NULL);
+    MAP_ASSERT(live == 0);
   }
 
-  // test: foreach
+  // test: huge page allocator
   {
-    size_t iter  = 0;
-    char*  key   = NULL;
-    int*   value = NULL;
-    while (c_map_iter(&map, &iter, (void**)&key, (void**)&value)) {
-      printf("%s: %d\n", key, *value);
+    CMapAllocator allocator = c_map_huge_page_allocator();
+
+    // 16 bytes buckets, so a few MBs of table
+    CMap hmap;
+    err = c_map_create_with_allocator(sizeof(int), sizeof(int), 1U << 18,
+                                      &allocator, &hmap);
+    MAP_TEST(err);
+    for (int iii = 0; iii < 200000; ++iii) {
+      err = c_map_insert(&hmap, &iii, &iii);
+      MAP_TEST(err);
+    }
+    int* value = NULL;
+    for (int iii = 0; iii < 200000; iii += 997) {
+      err = c_map_get(&hmap, &iii, (void**)&value);
+      MAP_TEST(err);
+      MAP_ASSERT(value && *value == iii);
     }
+    c_map_destroy(&hmap, NULL, NULL);
   }
 
-  // test: remove
+  // test: stats
   {
-    err = c_map_insert(&map, (char[20]){"new bucket"}, &(int){100});
+    CMap smap;
+    err = c_map_create(sizeof(int), sizeof(int), &smap);
     MAP_TEST(err);
+    for (int iii = 0; iii < 1000; ++iii) {
+      err = c_map_insert(&smap, &iii, &iii);
+      MAP_TEST(err);
+    }
 
-    int* value;
-    err = c_map_remove(&map, (char[20]){"new bucket"}, (void**)&value);
+    CMapStats stats;
+    err = c_map_stats(&smap, &stats);
     MAP_TEST(err);
-    MAP_ASSERT(*value == 100);
+    MAP_ASSERT(stats.len == 1000 && stats.capacity == smap.capacity);
+    MAP_ASSERT(stats.max_distance >= 1);
+    MAP_ASSERT(stats.avg_distance >= 1.0
+               && stats.avg_distance <= (double)stats.max_distance);
+
+    size_t histogram_len = 0;
+    for (size_t iii = 0; iii < CMAP_STATS_HISTOGRAM_LEN; ++iii) {
+      histogram_len += stats.histogram[iii];
+    }
+    MAP_ASSERT(histogram_len == 1000);
+#ifdef C_MAP_STATS
+    MAP_ASSERT(stats.resizes > 0 && stats.lookups >= 1000);
+
+    // lookups through a const map are counted too
+    CMap const*  const_map = &smap;
+    size_t const lookups   = stats.lookups;
+    int*         value     = NULL;
+    err = c_map_get(const_map, &(int){7}, (void**)&value);
+    MAP_TEST(err);
+    MAP_ASSERT(value && *value == 7);
+    err = c_map_stats(const_map, &stats);
+    MAP_TEST(err);
+    MAP_ASSERT(stats.lookups == lookups + 1);
+#else
+    MAP_ASSERT(!stats.resizes && !stats.lookups && !stats.collisions);
+#endif
+
+    // entries still in the old table are counted too
+    err = c_map_set_incremental_resize(&smap, 1);
+    MAP_TEST(err);
+    for (int iii = 1000; iii < 1800; ++iii) {
+      err = c_map_insert(&smap, &iii, &iii);
+      MAP_TEST(err);
+    }
+    MAP_ASSERT(smap.old.buckets);
+    err = c_map_stats(&smap, &stats);
+    MAP_TEST(err);
+    histogram_len = 0;
+    for (size_t iii = 0; iii < CMAP_STATS_HISTOGRAM_LEN; ++iii) {
+      histogram_len += stats.histogram[iii];
+    }
+    MAP_ASSERT(histogram_len == 1800);
+
+    c_map_destroy(&smap, NULL, NULL);
   }
+}
 
-  c_map_destroy(&map, NULL, NULL);
+static bool
+map_test_retain_below(void* key, void* value, void* ctx)
+{
+  (void)value;
+  return *(int*)key < *(int*)ctx;
+}
+
+static void*
+map_test_alloc(size_t size, void* ctx)
+{
+  *(size_t*)ctx += size;
+  return malloc(size);
+}
+
+static void
+map_test_free(void* ptr, size_t size, void* ctx)
+{
+  *(size_t*)ctx -= size;
+  free(ptr);
 }
 
 void
@@ -586,6 +3014,489 @@ c_map_handler(void* key, void* value, void* extra_data)
 #undef CSTDLIB_MAP_UNIT_TESTS
 #endif // CSTDLIB_MAP_UNIT_TESTS
 
+#ifdef CSTDLIB_MAP_BENCHMARKS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAP_BENCH_DEFAULT_CAPACITY (1U << 18)
+#define MAP_BENCH_HISTOGRAM_LEN 9 // probes 1..8, then 9 and more
+
+/// a reference table: linear probing, backward shift deletion and the same
+/// hash as CMap, every slot is { [uint64_t hash (0: empty), key, value] }
+typedef struct MapBenchRef {
+  char*  slots;
+  size_t capacity;
+  size_t mask;
+  size_t len;
+  size_t key_size;
+  size_t value_size;
+  size_t slot_size;
+  float  max_load_factor;
+} MapBenchRef;
+
+typedef struct MapBenchResult {
+  double   mops[5]; // insert, get hit, get miss, remove, iterate
+  double   load;
+  double   bytes_per_entry;
+  double   avg_probe;
+  size_t   max_probe;
+  size_t   histogram[MAP_BENCH_HISTOGRAM_LEN];
+  uint64_t checksum;
+} MapBenchResult;
+
+static void map_bench_run_cmap(size_t          key_size,
+                               size_t          value_size,
+                               float           max_load_factor,
+                               char const*     keys,
+                               char const*     missing_keys,
+                               char const*     values,
+                               size_t          len,
+                               MapBenchResult* out_result);
+static void map_bench_run_ref(size_t          key_size,
+                              size_t          value_size,
+                              float           max_load_factor,
+                              char const*     keys,
+                              char const*     missing_keys,
+                              char const*     values,
+                              size_t          len,
+                              MapBenchResult* out_result);
+static void map_bench_fill_key(char* out_key, size_t key_size, uint64_t index);
+static double map_bench_mops(size_t ops, clock_t start);
+static void   map_bench_print(char const* name, MapBenchResult const* result);
+
+static MapBenchRef map_bench_ref_create(size_t key_size,
+                                        size_t value_size,
+                                        float  max_load_factor);
+static void        map_bench_ref_insert(MapBenchRef* self,
+                                        void const*  key,
+                                        void const*  value);
+static char*       map_bench_ref_find(MapBenchRef const* self, void const* key);
+static void        map_bench_ref_remove(MapBenchRef* self, void const* key);
+static void        map_bench_ref_grow(MapBenchRef* self);
+static void        map_bench_ref_destroy(MapBenchRef* self);
+
+int
+main(int argc, char* argv[])
+{
+  // every run fills a table of `capacity` buckets up to its max load factor
+  size_t capacity = MAP_BENCH_DEFAULT_CAPACITY;
+  if (argc > 1) { capacity = (size_t)strtoull(argv[1], NULL, 10); }
+  if (capacity < CMAP_DEFAULT_CAPACITY) capacity = MAP_BENCH_DEFAULT_CAPACITY;
+  while (capacity & (capacity - 1)) {
+    capacity &= capacity - 1;
+  }
+
+  size_t const key_sizes[]        = {4, 8, 16, 64};
+  size_t const value_sizes[]      = {8, 32};
+  float const  max_load_factors[] = {0.5f, 0.875f, 0.95f};
+
+  printf("map benchmark: %zu buckets, Mops/s (iterate: M entries/s)\n\n",
+         capacity);
+  printf("key val   lf table   load B/entry   insert  get hit get miss"
+         "   remove  iterate  probe avg/max\n");
+
+  for (size_t kkk = 0; kkk < sizeof(key_sizes) / sizeof(*key_sizes); ++kkk) {
+    size_t key_size = key_sizes[kkk];
+
+    // the first `capacity` keys can get inserted, the others are the misses
+    char* keys = malloc(2 * capacity * key_size);
+    if (!keys) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+    for (size_t iii = 0; iii < (2 * capacity); ++iii) {
+      map_bench_fill_key(keys + (iii * key_size), key_size, iii);
+    }
+
+    for (size_t vvv = 0; vvv < sizeof(value_sizes) / sizeof(*value_sizes);
+         ++vvv) {
+      size_t value_size = value_sizes[vvv];
+      char*  values     = malloc(capacity * value_size);
+      if (!values) {
+        fprintf(stderr, "out of memory\n");
+        free(keys);
+        return 1;
+      }
+      for (size_t iii = 0; iii < (capacity * value_size); ++iii) {
+        values[iii] = (char)iii;
+      }
+
+      for (size_t lll = 0;
+           lll < sizeof(max_load_factors) / sizeof(*max_load_factors); ++lll) {
+        // one key short of growing
+        size_t len = (size_t)((double)capacity * max_load_factors[lll]) - 1;
+
+        MapBenchResult cmap_result;
+        MapBenchResult ref_result;
+        map_bench_run_cmap(key_size, value_size, max_load_factors[lll], keys,
+                           keys + (capacity * key_size), values, len,
+                           &cmap_result);
+        map_bench_run_ref(key_size, value_size, max_load_factors[lll], keys,
+                          keys + (capacity * key_size), values, len,
+                          &ref_result);
+
+        printf("%3zu %3zu %4.2f ", key_size, value_size,
+               (double)max_load_factors[lll]);
+        map_bench_print("cmap", &cmap_result);
+        printf("%13s", "");
+        map_bench_print("ref", &ref_result);
+
+        printf("%13sprobes:", "");
+        for (size_t iii = 0; iii < MAP_BENCH_HISTOGRAM_LEN; ++iii) {
+          printf(" %zu%s:%.1f%%", iii + 1,
+                 (iii == (MAP_BENCH_HISTOGRAM_LEN - 1)) ? "+" : "",
+                 100.0 * (double)cmap_result.histogram[iii] / (double)len);
+        }
+        printf("\n");
+
+        if (cmap_result.checksum != ref_result.checksum) {
+          fprintf(stderr, "cmap and ref disagree\n");
+          free(values);
+          free(keys);
+          return 1;
+        }
+      }
+
+      free(values);
+    }
+
+    free(keys);
+  }
+
+  return 0;
+}
+
+void
+map_bench_run_cmap(size_t          key_size,
+                   size_t          value_size,
+                   float           max_load_factor,
+                   char const*     keys,
+                   char const*     missing_keys,
+                   char const*     values,
+                   size_t          len,
+                   MapBenchResult* out_result)
+{
+  *out_result = (MapBenchResult){0};
+
+  CMap          map;
+  c_map_error_t err = c_map_create(key_size, value_size, &map);
+  if (!err.code) {
+    err = c_map_set_load_factors(&map, max_load_factor,
+                                 CMAP_DEFAULT_MIN_LOAD_FACTOR
+                                     * (max_load_factor
+                                        / CMAP_DEFAULT_MAX_LOAD_FACTOR));
+  }
+  if (err.code) {
+    fprintf(stderr, "%s\n", err.desc);
+    exit(1);
+  }
+
+  clock_t start = clock();
+  for (size_t iii = 0; iii < len; ++iii) {
+    c_map_insert(&map, (void*)(keys + (iii * key_size)),
+                 (void*)(values + (iii * value_size)));
+  }
+  out_result->mops[0] = map_bench_mops(len, start);
+
+  out_result->load = (double)map.len / (double)map.capacity;
+  out_result->bytes_per_entry
+      = (double)c_internal_map_table_size(&map, map.capacity) / (double)map.len;
+
+  CMapStats stats;
+  c_map_stats(&map, &stats);
+  out_result->avg_probe = stats.avg_distance;
+  out_result->max_probe = stats.max_distance;
+  for (size_t iii = 0; iii < CMAP_STATS_HISTOGRAM_LEN; ++iii) {
+    out_result->histogram[(iii < MAP_BENCH_HISTOGRAM_LEN)
+                              ? iii
+                              : (MAP_BENCH_HISTOGRAM_LEN - 1)]
+        += stats.histogram[iii];
+  }
+
+  void* value = NULL;
+  start       = clock();
+  for (size_t iii = 0; iii < len; ++iii) {
+    c_map_get(&map, (void*)(keys + (iii * key_size)), &value);
+    out_result->checksum += value ? *(unsigned char*)value : 0;
+  }
+  out_result->mops[1] = map_bench_mops(len, start);
+
+  start = clock();
+  for (size_t iii = 0; iii < len; ++iii) {
+    c_map_get(&map, (void*)(missing_keys + (iii * key_size)), &value);
+    out_result->checksum += value ? 1 : 0;
+  }
+  out_result->mops[2] = map_bench_mops(len, start);
+
+  size_t iter = 0;
+  void*  key  = NULL;
+  start       = clock();
+  while (c_map_iter(&map, &iter, &key, &value)) {
+    out_result->checksum += *(unsigned char*)value;
+  }
+  out_result->mops[4] = map_bench_mops(len, start);
+
+  start = clock();
+  for (size_t iii = 0; iii < len; ++iii) {
+    c_map_remove(&map, (void*)(keys + (iii * key_size)), &value);
+  }
+  out_result->mops[3] = map_bench_mops(len, start);
+  out_result->checksum += map.len;
+
+  c_map_destroy(&map, NULL, NULL);
+}
+
+void
+map_bench_run_ref(size_t          key_size,
+                  size_t          value_size,
+                  float           max_load_factor,
+                  char const*     keys,
+                  char const*     missing_keys,
+                  char const*     values,
+                  size_t          len,
+                  MapBenchResult* out_result)
+{
+  *out_result = (MapBenchResult){0};
+
+  MapBenchRef ref = map_bench_ref_create(key_size, value_size, max_load_factor);
+
+  clock_t start = clock();
+  for (size_t iii = 0; iii < len; ++iii) {
+    map_bench_ref_insert(&ref, keys + (iii * key_size),
+                         values + (iii * value_size));
+  }
+  out_result->mops[0] = map_bench_mops(len, start);
+
+  out_result->load = (double)ref.len / (double)ref.capacity;
+  out_result->bytes_per_entry
+      = (double)(ref.capacity * ref.slot_size) / (double)ref.len;
+
+  size_t total_probes = 0;
+  for (size_t iii = 0; iii < ref.capacity; ++iii) {
+    uint64_t hash = *(uint64_t*)(ref.slots + (iii * ref.slot_size));
+    if (!hash) continue;
+
+    size_t distance = ((iii - (size_t)hash) & ref.mask) + 1;
+    total_probes += distance;
+    if (distance > out_result->max_probe) out_result->max_probe = distance;
+  }
+  out_result->avg_probe = (double)total_probes / (double)ref.len;
+
+  start = clock();
+  for (size_t iii = 0; iii < len; ++iii) {
+    char* slot = map_bench_ref_find(&ref, keys + (iii * key_size));
+    out_result->checksum
+        += slot ? *(unsigned char*)(slot + sizeof(uint64_t) + key_size) : 0;
+  }
+  out_result->mops[1] = map_bench_mops(len, start);
+
+  start = clock();
+  for (size_t iii = 0; iii < len; ++iii) {
+    out_result->checksum
+        += map_bench_ref_find(&ref, missing_keys + (iii * key_size)) ? 1 : 0;
+  }
+  out_result->mops[2] = map_bench_mops(len, start);
+
+  start = clock();
+  for (size_t iii = 0; iii < ref.capacity; ++iii) {
+    char* slot = ref.slots + (iii * ref.slot_size);
+    if (*(uint64_t*)slot) {
+      out_result->checksum
+          += *(unsigned char*)(slot + sizeof(uint64_t) + ref.key_size);
+    }
+  }
+  out_result->mops[4] = map_bench_mops(len, start);
+
+  start = clock();
+  for (size_t iii = 0; iii < len; ++iii) {
+    map_bench_ref_remove(&ref, keys + (iii * key_size));
+  }
+  out_result->mops[3] = map_bench_mops(len, start);
+  out_result->checksum += ref.len;
+
+  map_bench_ref_destroy(&ref);
+}
+
+void
+map_bench_fill_key(char* out_key, size_t key_size, uint64_t index)
+{
+  // splitmix64's finalizer is a bijection, so the first 8 bytes are unique
+  // (4 bytes keys use the 32 bits variant of it)
+  if (key_size < sizeof(uint64_t)) {
+    uint32_t word = (uint32_t)index;
+    word          = (word ^ (word >> 16)) * 0x45d9f3bU;
+    word          = (word ^ (word >> 16)) * 0x45d9f3bU;
+    word          = word ^ (word >> 16);
+    memcpy(out_key, &word, key_size);
+    return;
+  }
+
+  for (size_t offset = 0; offset < key_size; offset += sizeof(uint64_t)) {
+    uint64_t word = index + (offset * 0x9e3779b97f4a7c15ULL);
+    word          = (word ^ (word >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    word          = (word ^ (word >> 27)) * 0x94d049bb133111ebULL;
+    word          = word ^ (word >> 31);
+
+    size_t size = key_size - offset;
+    memcpy(out_key + offset, &word,
+           (size < sizeof(uint64_t)) ? size : sizeof(uint64_t));
+  }
+}
+
+double
+map_bench_mops(size_t ops, clock_t start)
+{
+  double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+  return (seconds > 0.0) ? ((double)ops / seconds / 1e6) : 0.0;
+}
+
+void
+map_bench_print(char const* name, MapBenchResult const* result)
+{
+  printf("%-5s %6.2f %8.1f", name, result->load, result->bytes_per_entry);
+  for (size_t iii = 0; iii < 5; ++iii) {
+    printf(" %8.1f", result->mops[iii]);
+  }
+  printf(" %6.2f/%zu\n", result->avg_probe, result->max_probe);
+}
+
+MapBenchRef
+map_bench_ref_create(size_t key_size, size_t value_size, float max_load_factor)
+{
+  MapBenchRef ref = {
+      .capacity        = CMAP_DEFAULT_CAPACITY,
+      .mask            = CMAP_DEFAULT_CAPACITY - 1,
+      .key_size        = key_size,
+      .value_size      = value_size,
+      .slot_size       = (sizeof(uint64_t) + key_size + value_size + 7) & ~7U,
+      .max_load_factor = max_load_factor,
+  };
+  ref.slots = calloc(ref.capacity, ref.slot_size);
+  if (!ref.slots) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  return ref;
+}
+
+void
+map_bench_ref_insert(MapBenchRef* self, void const* key, void const* value)
+{
+  char* slot = map_bench_ref_find(self, key);
+  if (!slot) {
+    if ((double)(self->len + 1)
+        > ((double)self->capacity * self->max_load_factor)) {
+      map_bench_ref_grow(self);
+    }
+
+    // the top bit marks the slot as used
+    uint64_t hash = (uint64_t)c_internal_map_hash(key, self->key_size)
+                    | ((uint64_t)1 << 63);
+    size_t index = (size_t)hash & self->mask;
+    while (*(uint64_t*)(self->slots + (index * self->slot_size))) {
+      index = (index + 1) & self->mask;
+    }
+
+    slot             = self->slots + (index * self->slot_size);
+    *(uint64_t*)slot = hash;
+    memcpy(slot + sizeof(uint64_t), key, self->key_size);
+    self->len++;
+  }
+
+  memcpy(slot + sizeof(uint64_t) + self->key_size, value, self->value_size);
+}
+
+char*
+map_bench_ref_find(MapBenchRef const* self, void const* key)
+{
+  uint64_t hash = (uint64_t)c_internal_map_hash(key, self->key_size)
+                  | ((uint64_t)1 << 63);
+  for (size_t index = (size_t)hash & self->mask;;
+       index        = (index + 1) & self->mask) {
+    char*    slot      = self->slots + (index * self->slot_size);
+    uint64_t slot_hash = *(uint64_t*)slot;
+    if (!slot_hash) return NULL;
+    if ((slot_hash == hash)
+        && !memcmp(slot + sizeof(uint64_t), key, self->key_size)) {
+      return slot;
+    }
+  }
+}
+
+void
+map_bench_ref_remove(MapBenchRef* self, void const* key)
+{
+  char* hole = map_bench_ref_find(self, key);
+  if (!hole) return;
+
+  // backward shift: pull back every following slot that may live in the hole
+  size_t hole_index = (size_t)(hole - self->slots) / self->slot_size;
+  for (size_t index = (hole_index + 1) & self->mask;;
+       index        = (index + 1) & self->mask) {
+    char*    slot      = self->slots + (index * self->slot_size);
+    uint64_t slot_hash = *(uint64_t*)slot;
+    if (!slot_hash) break;
+
+    size_t home = (size_t)slot_hash & self->mask;
+    if (((index - home) & self->mask) >= ((index - hole_index) & self->mask)) {
+      memcpy(hole, slot, self->slot_size);
+      hole       = slot;
+      hole_index = index;
+    }
+  }
+
+  *(uint64_t*)hole = 0;
+  self->len--;
+}
+
+void
+map_bench_ref_grow(MapBenchRef* self)
+{
+  MapBenchRef grown = *self;
+  grown.capacity *= 2;
+  grown.mask      = grown.capacity - 1;
+  grown.len       = 0;
+  grown.slots     = calloc(grown.capacity, grown.slot_size);
+  if (!grown.slots) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+
+  for (size_t iii = 0; iii < self->capacity; ++iii) {
+    char*    slot = self->slots + (iii * self->slot_size);
+    uint64_t hash = *(uint64_t*)slot;
+    if (!hash) continue;
+
+    for (size_t index = (size_t)hash & grown.mask;;
+         index        = (index + 1) & grown.mask) {
+      char* grown_slot = grown.slots + (index * grown.slot_size);
+      if (!*(uint64_t*)grown_slot) {
+        memcpy(grown_slot, slot, grown.slot_size);
+        grown.len++;
+        break;
+      }
+    }
+  }
+
+  free(self->slots);
+  *self = grown;
+}
+
+void
+map_bench_ref_destroy(MapBenchRef* self)
+{
+  free(self->slots);
+  *self = (MapBenchRef){0};
+}
+
+#undef MAP_BENCH_DEFAULT_CAPACITY
+#undef MAP_BENCH_HISTOGRAM_LEN
+#undef CSTDLIB_MAP_BENCHMARKS
+#endif // CSTDLIB_MAP_BENCHMARKS
+
 /*
  * MIT License
  *
@@ -0,0 +1,511 @@
+/* How To  : To use this module, do this in *ONE* C file:
+ *              #define CSTDLIB_MULTIMAP_IMPLEMENTATION
+ *              #include "multimap.h"
+ *           it depends on "map.h", so CSTDLIB_MAP_IMPLEMENTATION has to be
+ *           defined in one C file as well
+ * Tests   : To use run test, do this in *ONE* C file:
+ *              #define CSTDLIB_MULTIMAP_UNIT_TESTS
+ *              #include "multimap.h"
+ * Options :
+ *           - C_MULTIMAP_DONT_CHECK_PARAMS: parameters will not get checked
+ *                                           (this is off by default)
+ * Notes   : a CMultiMap holds any number of values per key, the CMap only
+ *           maps a key to the head and tail of a singly linked list of
+ *           nodes in a separate value pool, so adding a value costs a single
+ *           probe (see `c_map_get_or_insert`) and never moves the buckets.
+ *           the values of a key are kept in insertion order.
+ *           the pool grows by doubling, value pointers are valid till the
+ *           next insert
+ * License : MIT (go to the end of this file for details)
+ */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- header -------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifndef CSTDLIB_MULTIMAP_H
+#define CSTDLIB_MULTIMAP_H
+
+#include "map.h"
+
+typedef struct CMultiMap {
+  CMap     map;  // key -> CMultiMapList
+  void*    pool; // { [next node index, value], ... }
+  size_t   node_size;
+  size_t   value_size;
+  size_t   pool_capacity;
+  size_t   pool_len; // nodes ever handed out, the free ones included
+  size_t   len;      // values of all the keys
+  uint32_t free_head;
+} CMultiMap;
+
+/// @brief the values of a single key, see `c_multimap_get`
+typedef struct CMultiMapIter {
+  uint32_t node;
+} CMultiMapIter;
+
+/// @brief create an empty multimap
+/// @param key_size
+/// @param value_size
+/// @param out_multimap
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_multimap_create(size_t     key_size,
+                                size_t     value_size,
+                                CMultiMap* out_multimap);
+
+/// @brief add `value` to the values of `key`
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_multimap_insert(CMultiMap* self, void* key, void* value);
+
+/// @brief get the values of `key`, walk them with `c_multimap_iter_values`
+/// @param out_iter yields nothing if the key doesn't exist
+/// @param out_count can be NULL
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_multimap_get(CMultiMap const* self,
+                             void*            key,
+                             CMultiMapIter*   out_iter,
+                             size_t*          out_count);
+
+/// @brief next value of the key `iter` was created for, in insertion order
+bool c_multimap_iter_values(CMultiMap const* self,
+                            CMultiMapIter*   iter,
+                            void**           out_value);
+
+/// @brief remove `key` and all of its values
+/// @param value_destroy_fn called with every removed value (can be NULL)
+/// @return C_MAP_ERROR_key_not_found if the key doesn't exist
+c_map_error_t c_multimap_remove(CMultiMap* self,
+                                void*      key,
+                                void       value_destroy_fn(void* value,
+                                                            void* user_data),
+                                void*      user_data);
+
+/// @brief number of values of all the keys
+size_t c_multimap_len(CMultiMap const* self);
+
+/// @brief number of distinct keys
+size_t c_multimap_keys_len(CMultiMap const* self);
+
+/// @brief iterate over the keys, `iter` has to start at 0
+/// @param out_values the values of `key` (can be NULL)
+bool c_multimap_iter(CMultiMap*     self,
+                     size_t*        iter,
+                     void**         key,
+                     CMultiMapIter* out_values);
+
+void c_multimap_clear(CMultiMap* self,
+                      void       element_destroy_fn(void* key,
+                                                    void* value,
+                                                    void* user_data),
+                      void*      user_data);
+
+void c_multimap_destroy(CMultiMap* self,
+                        void       element_destroy_fn(void* key,
+                                                      void* value,
+                                                      void* user_data),
+                        void*      user_data);
+
+#endif // CSTDLIB_MULTIMAP_H
+
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- implementation ---------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_MULTIMAP_IMPLEMENTATION
+#include <stdlib.h>
+#include <string.h>
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifndef C_MULTIMAP_DONT_CHECK_PARAMS
+#define C_MULTIMAP_CHECK_PARAMS(params)                                        \
+  if (!(params)) return C_MAP_ERROR_invalid_parameters;
+#else
+#define C_MULTIMAP_CHECK_PARAMS(params) ((void)0)
+#endif
+
+#define C_MULTIMAP_NIL UINT32_MAX
+#define C_MULTIMAP_DEFAULT_POOL_CAPACITY 16U
+// the node header, padded so the value stays 8 bytes aligned
+#define C_MULTIMAP_VALUE_OFFSET sizeof(uint64_t)
+
+typedef struct CMultiMapList {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t len; // 0: the key was just inserted by `c_map_get_or_insert`
+} CMultiMapList;
+
+static c_map_error_t    c_internal_multimap_alloc_node(CMultiMap* self,
+                                                       uint32_t*  out_index);
+static inline uint32_t* c_internal_multimap_get_next(CMultiMap const* self,
+                                                     uint32_t         index);
+static inline void*     c_internal_multimap_get_value(CMultiMap const* self,
+                                                      uint32_t         index);
+
+c_map_error_t
+c_multimap_create(size_t key_size, size_t value_size, CMultiMap* out_multimap)
+{
+  if (!out_multimap) { return C_MAP_ERROR_none; }
+
+  *out_multimap = (CMultiMap){0};
+
+  c_map_error_t err = c_map_create(key_size, sizeof(CMultiMapList),
+                                   &out_multimap->map);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  out_multimap->value_size = value_size;
+  out_multimap->node_size
+      = C_MULTIMAP_VALUE_OFFSET
+        + ((value_size + (sizeof(uint64_t) - 1)) & ~(sizeof(uint64_t) - 1));
+  out_multimap->free_head = C_MULTIMAP_NIL;
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_multimap_insert(CMultiMap* self, void* key, void* value)
+{
+  C_MULTIMAP_CHECK_PARAMS(self && self->map.buckets);
+
+  if (!key || (!value && self->value_size)) { return C_MAP_ERROR_none; }
+
+  // take the node first, a failed insert can then hand it back untouched
+  uint32_t      index = C_MULTIMAP_NIL;
+  c_map_error_t err   = c_internal_multimap_alloc_node(self, &index);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  CMultiMapList* list = NULL;
+  err = c_map_get_or_insert(&self->map, key, (void**)&list, NULL);
+  if (err.code != C_MAP_ERROR_none.code) {
+    *c_internal_multimap_get_next(self, index) = self->free_head;
+    self->free_head                            = index;
+    return err;
+  }
+
+  *c_internal_multimap_get_next(self, index) = C_MULTIMAP_NIL;
+  if (value) {
+    memcpy(c_internal_multimap_get_value(self, index), value,
+           self->value_size);
+  }
+
+  if (list->len) {
+    *c_internal_multimap_get_next(self, list->tail) = index;
+  } else {
+    list->head = index;
+  }
+  list->tail = index;
+  list->len++;
+  self->len++;
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_multimap_get(CMultiMap const* self,
+               void*            key,
+               CMultiMapIter*   out_iter,
+               size_t*          out_count)
+{
+  C_MULTIMAP_CHECK_PARAMS(self && self->map.buckets);
+
+  if (out_iter) { *out_iter = (CMultiMapIter){C_MULTIMAP_NIL}; }
+  if (out_count) { *out_count = 0; }
+
+  CMultiMapList* list = NULL;
+  c_map_error_t  err  = c_map_get(&self->map, key, (void**)&list);
+  if (err.code != C_MAP_ERROR_none.code || !list) { return err; }
+
+  if (out_iter) { out_iter->node = list->head; }
+  if (out_count) { *out_count = list->len; }
+
+  return C_MAP_ERROR_none;
+}
+
+bool
+c_multimap_iter_values(CMultiMap const* self,
+                       CMultiMapIter*   iter,
+                       void**           out_value)
+{
+  if (!self || !iter || (iter->node == C_MULTIMAP_NIL)) { return false; }
+
+  if (out_value) {
+    *out_value = c_internal_multimap_get_value(self, iter->node);
+  }
+  iter->node = *c_internal_multimap_get_next(self, iter->node);
+
+  return true;
+}
+
+c_map_error_t
+c_multimap_remove(CMultiMap* self,
+                  void*      key,
+                  void       value_destroy_fn(void* value, void* user_data),
+                  void*      user_data)
+{
+  C_MULTIMAP_CHECK_PARAMS(self && self->map.buckets);
+
+  CMultiMapList* list = NULL;
+  c_map_error_t  err  = c_map_get(&self->map, key, (void**)&list);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+  if (!list) { return C_MAP_ERROR_key_not_found; }
+
+  for (uint32_t index = list->head; index != C_MULTIMAP_NIL;) {
+    uint32_t next = *c_internal_multimap_get_next(self, index);
+    if (value_destroy_fn) {
+      value_destroy_fn(c_internal_multimap_get_value(self, index), user_data);
+    }
+    *c_internal_multimap_get_next(self, index) = self->free_head;
+    self->free_head                            = index;
+    index                                      = next;
+  }
+  self->len -= list->len;
+
+  void* removed = NULL;
+  return c_map_remove(&self->map, key, &removed);
+}
+
+size_t
+c_multimap_len(CMultiMap const* self)
+{
+  return self->len;
+}
+
+size_t
+c_multimap_keys_len(CMultiMap const* self)
+{
+  return c_map_len(&self->map);
+}
+
+bool
+c_multimap_iter(CMultiMap*     self,
+                size_t*        iter,
+                void**         key,
+                CMultiMapIter* out_values)
+{
+  CMultiMapList* list = NULL;
+  if (!c_map_iter(&self->map, iter, key, (void**)&list)) { return false; }
+
+  if (out_values) { out_values->node = list->head; }
+
+  return true;
+}
+
+void
+c_multimap_clear(CMultiMap* self,
+                 void       element_destroy_fn(void* key,
+                                               void* value,
+                                               void* user_data),
+                 void*      user_data)
+{
+  if (element_destroy_fn) {
+    size_t        iter   = 0;
+    void*         key    = NULL;
+    CMultiMapIter values = {0};
+    while (c_multimap_iter(self, &iter, &key, &values)) {
+      void* value = NULL;
+      while (c_multimap_iter_values(self, &values, &value)) {
+        element_destroy_fn(key, value, user_data);
+      }
+    }
+  }
+
+  // the pool is kept, all of its nodes are free again
+  c_map_clear(&self->map, NULL, NULL);
+  self->pool_len  = 0;
+  self->len       = 0;
+  self->free_head = C_MULTIMAP_NIL;
+}
+
+void
+c_multimap_destroy(CMultiMap* self,
+                   void       element_destroy_fn(void* key,
+                                                 void* value,
+                                                 void* user_data),
+                   void*      user_data)
+{
+  if (self && self->map.buckets) {
+    c_multimap_clear(self, element_destroy_fn, user_data);
+    c_map_destroy(&self->map, NULL, NULL);
+    free(self->pool);
+    *self = (CMultiMap){0};
+  }
+}
+
+c_map_error_t
+c_internal_multimap_alloc_node(CMultiMap* self, uint32_t* out_index)
+{
+  if (self->free_head != C_MULTIMAP_NIL) {
+    *out_index      = self->free_head;
+    self->free_head = *c_internal_multimap_get_next(self, self->free_head);
+    return C_MAP_ERROR_none;
+  }
+
+  if (self->pool_len == self->pool_capacity) {
+    size_t new_capacity = self->pool_capacity
+                              ? (self->pool_capacity * 2)
+                              : C_MULTIMAP_DEFAULT_POOL_CAPACITY;
+    if (new_capacity > C_MULTIMAP_NIL) { new_capacity = C_MULTIMAP_NIL; }
+    if (new_capacity == self->pool_len) { return C_MAP_ERROR_mem_allocation; }
+
+    void* pool = realloc(self->pool, new_capacity * self->node_size);
+    if (!pool) { return C_MAP_ERROR_mem_allocation; }
+    self->pool          = pool;
+    self->pool_capacity = new_capacity;
+  }
+
+  *out_index = (uint32_t)self->pool_len++;
+
+  return C_MAP_ERROR_none;
+}
+
+uint32_t*
+c_internal_multimap_get_next(CMultiMap const* self, uint32_t index)
+{
+  return (uint32_t*)((char*)self->pool + (self->node_size * index));
+}
+
+void*
+c_internal_multimap_get_value(CMultiMap const* self, uint32_t index)
+{
+  return (char*)self->pool + (self->node_size * index)
+         + C_MULTIMAP_VALUE_OFFSET;
+}
+
+#undef C_MULTIMAP_NIL
+#undef C_MULTIMAP_DEFAULT_POOL_CAPACITY
+#undef C_MULTIMAP_VALUE_OFFSET
+#undef C_MULTIMAP_CHECK_PARAMS
+#undef CSTDLIB_MULTIMAP_IMPLEMENTATION
+#endif // CSTDLIB_MULTIMAP_IMPLEMENTATION
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_MULTIMAP_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#define CSTDLIB_MAP_IMPLEMENTATION
+#include "map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MULTIMAP_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define MULTIMAP_TEST(err)                                                     \
+  ((err.code != C_MAP_ERROR_none.code) ? MULTIMAP_TEST_PRINT_ABORT(err.desc)   \
+                                       : (void)0)
+#define MULTIMAP_ASSERT(cond)                                                  \
+  (!(cond)) ? MULTIMAP_TEST_PRINT_ABORT(#cond) : (void)0
+
+static void
+multimap_test_sum(void* key, void* value, void* user_data)
+{
+  (void)key;
+  *(int*)user_data += *(int*)value;
+}
+
+int
+main(void)
+{
+  c_map_error_t err = C_MAP_ERROR_none;
+
+  // test: group by
+  {
+    CMultiMap multimap;
+    err = c_multimap_create(sizeof(int), sizeof(int), &multimap);
+    MULTIMAP_TEST(err);
+
+    // every key gets its values in increasing order
+    for (int iii = 0; iii < 1000; ++iii) {
+      err = c_multimap_insert(&multimap, &(int){iii % 10}, &iii);
+      MULTIMAP_TEST(err);
+    }
+    MULTIMAP_ASSERT(c_multimap_len(&multimap) == 1000);
+    MULTIMAP_ASSERT(c_multimap_keys_len(&multimap) == 10);
+
+    CMultiMapIter values = {0};
+    size_t        count  = 0;
+    err = c_multimap_get(&multimap, &(int){3}, &values, &count);
+    MULTIMAP_TEST(err);
+    MULTIMAP_ASSERT(count == 100);
+
+    int  expected = 3;
+    int* value    = NULL;
+    while (c_multimap_iter_values(&multimap, &values, (void**)&value)) {
+      MULTIMAP_ASSERT(*value == expected);
+      expected += 10;
+    }
+    MULTIMAP_ASSERT(expected == 1003);
+
+    err = c_multimap_get(&multimap, &(int){10}, &values, &count);
+    MULTIMAP_TEST(err);
+    MULTIMAP_ASSERT(count == 0);
+    MULTIMAP_ASSERT(!c_multimap_iter_values(&multimap, &values, NULL));
+
+    // the removed values' nodes get reused
+    err = c_multimap_remove(&multimap, &(int){3}, NULL, NULL);
+    MULTIMAP_TEST(err);
+    err = c_multimap_remove(&multimap, &(int){3}, NULL, NULL);
+    MULTIMAP_ASSERT(err.code == C_MAP_ERROR_key_not_found.code);
+    MULTIMAP_ASSERT(c_multimap_len(&multimap) == 900);
+
+    size_t pool_len = multimap.pool_len;
+    for (int iii = 0; iii < 100; ++iii) {
+      err = c_multimap_insert(&multimap, &(int){42}, &iii);
+      MULTIMAP_TEST(err);
+    }
+    MULTIMAP_ASSERT(multimap.pool_len == pool_len);
+
+    size_t iter  = 0;
+    int*   key   = NULL;
+    size_t total = 0;
+    while (c_multimap_iter(&multimap, &iter, (void**)&key, &values)) {
+      while (c_multimap_iter_values(&multimap, &values, NULL)) {
+        total++;
+      }
+    }
+    MULTIMAP_ASSERT(total == 1000);
+
+    int sum = 0;
+    c_multimap_destroy(&multimap, multimap_test_sum, &sum);
+    // 0..999 without 3, 13, ..., 993, plus 0..99
+    MULTIMAP_ASSERT(sum == (999 * 500) - ((3 + 993) * 50) + (99 * 50));
+  }
+}
+
+#ifdef NDEBUG_
+#define NDEBUG
+#undef NDEBUG_
+#endif
+
+#undef MULTIMAP_TEST_PRINT_ABORT
+#undef MULTIMAP_TEST
+#undef MULTIMAP_ASSERT
+#undef CSTDLIB_MULTIMAP_UNIT_TESTS
+#endif // CSTDLIB_MULTIMAP_UNIT_TESTS
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Mohamed A. Elmeligy
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions: The above copyright
+ * notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS",
+ * WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,754 @@
+/* How To  : To use this module, do this in *ONE* C file:
+ *              #define CSTDLIB_ROPE_IMPLEMENTATION
+ *              #include "rope.h"
+ *           it depends on "str.h", so CSTDLIB_STR_IMPLEMENTATION has to be
+ *           defined in one C file as well
+ * Tests   : To use run test, do this in *ONE* C file:
+ *              #define CSTDLIB_ROPE_UNIT_TESTS
+ *              #include "rope.h"
+ * Options :
+ *           - C_ROPE_DONT_CHECK_PARAMS: parameters will not get checked
+ *                                       (this is off by default)
+ *           - C_ROPE_CHUNK_SIZE: the most bytes a chunk grows to before new
+ *                                text goes into a chunk of its own
+ *                                (1024 by default)
+ * Notes   : a rope keeps the text as a sequence of `CStr` chunks in an
+ *           implicit treap (a binary tree ordered by position, every node
+ *           knows the bytes under it, and balanced by random priorities), so
+ *           insert, remove and index are O(log n) instead of moving the whole
+ *           tail of the text.
+ *           small edits go straight into the chunk they land in while it has
+ *           room, typing one byte at a time doesn't create a node per byte
+ * License : MIT (go to the end of this file for details)
+ */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- header -------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifndef CSTDLIB_ROPE_H
+#define CSTDLIB_ROPE_H
+
+#include "str.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef C_ROPE_CHUNK_SIZE
+#define C_ROPE_CHUNK_SIZE 1024U
+#endif
+
+typedef struct CRope {
+  void*    root;
+  size_t   len;  // bytes
+  uint64_t seed; // state of the priorities generator
+} CRope;
+
+/// @brief create an empty rope
+/// @param out_rope
+/// @return error (any value but zero is treated as an error)
+c_str_error_t c_rope_create(CRope* out_rope);
+
+/// @brief create a rope holding `cstr_len` bytes of `cstr`
+/// @return error (any value but zero is treated as an error)
+c_str_error_t
+c_rope_create_from_cstr(char const cstr[], size_t cstr_len, CRope* out_rope);
+
+/// @brief insert `cstr_len` bytes of `cstr` before the byte at `index`
+/// @param index can be `c_rope_len(self)` to append
+/// @return C_STR_ERROR_wrong_index if `index` is past the end
+c_str_error_t
+c_rope_insert(CRope* self, size_t index, char const cstr[], size_t cstr_len);
+
+/// @brief remove `range` bytes starting at `index`
+/// @param range is clipped to the end of the rope
+/// @param out_range_size the number of removed bytes (can be NULL)
+/// @return C_STR_ERROR_wrong_index if `index` is past the end
+c_str_error_t c_rope_remove(CRope* self,
+                            size_t index,
+                            size_t range,
+                            size_t* out_range_size);
+
+/// @brief get the byte at `index`
+/// @return C_STR_ERROR_wrong_index if `index` is past the end
+c_str_error_t c_rope_get(CRope const* self, size_t index, char* out_char);
+
+size_t c_rope_len(CRope const* self);
+
+/// @brief walk the chunks in order without copying them, `iter` is a byte
+///        offset so it can start anywhere (0 for the beginning). the rope
+///        must not be modified while iterating
+/// @param out_chunk the rest of the chunk `*iter` falls in
+/// @return false once the end is reached
+bool c_rope_iter(CRope const* self, size_t* iter, CStrView* out_chunk);
+
+/// @brief copy the whole text into a new `CStr`
+/// @param out_str
+/// @return error (any value but zero is treated as an error)
+c_str_error_t c_rope_to_str(CRope const* self, CStr* out_str);
+
+void c_rope_destroy(CRope* self);
+
+#endif // CSTDLIB_ROPE_H
+
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- implementation ---------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_ROPE_IMPLEMENTATION
+#include <stdlib.h>
+#include <string.h>
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifndef C_ROPE_DONT_CHECK_PARAMS
+#define C_ROPE_CHECK_PARAMS(params)                                            \
+  if (!(params)) return C_STR_ERROR_invalid_parameters;
+#else
+#define C_ROPE_CHECK_PARAMS(params) ((void)0)
+#endif
+
+// a node is a chunk and the root of a subtree, chunks are never empty
+typedef struct CRopeNode CRopeNode;
+struct CRopeNode {
+  CRopeNode* left;
+  CRopeNode* right;
+  size_t     size; // bytes of the whole subtree
+  uint64_t   priority;
+  CStr       chunk;
+};
+
+static c_str_error_t c_internal_rope_node_create(CRope*      self,
+                                                 char const  cstr[],
+                                                 size_t      cstr_len,
+                                                 CRopeNode** out_node);
+static void          c_internal_rope_node_destroy(CRopeNode* node);
+static CRopeNode*    c_internal_rope_merge(CRopeNode* left, CRopeNode* right);
+static void          c_internal_rope_split(CRopeNode*  node,
+                                           size_t      offset,
+                                           CRopeNode** spare,
+                                           CRopeNode** out_left,
+                                           CRopeNode** out_right);
+static c_str_error_t c_internal_rope_prepare_split(CRope*      self,
+                                                   size_t      offset,
+                                                   CRopeNode** out_spare);
+static bool          c_internal_rope_edit_in_place(CRope*     self,
+                                                   size_t     index,
+                                                   char const cstr[],
+                                                   size_t     cstr_len,
+                                                   size_t     range);
+static c_str_error_t c_internal_rope_append_to_str(CRopeNode const* node,
+                                                   CStr*            str);
+static inline size_t c_internal_rope_size(CRopeNode const* node);
+static inline void   c_internal_rope_update(CRopeNode* node);
+
+c_str_error_t
+c_rope_create(CRope* out_rope)
+{
+  if (!out_rope) { return C_STR_ERROR_none; }
+
+  *out_rope = (CRope){.seed = 0x9E3779B97F4A7C15U};
+
+  return C_STR_ERROR_none;
+}
+
+c_str_error_t
+c_rope_create_from_cstr(char const cstr[], size_t cstr_len, CRope* out_rope)
+{
+  C_ROPE_CHECK_PARAMS(cstr || cstr_len == 0);
+
+  if (!out_rope) { return C_STR_ERROR_none; }
+
+  c_rope_create(out_rope);
+  if (cstr_len == 0) { return C_STR_ERROR_none; }
+
+  c_str_error_t err = c_rope_insert(out_rope, 0, cstr, cstr_len);
+  if (err.code != C_STR_ERROR_none.code) { c_rope_destroy(out_rope); }
+
+  return err;
+}
+
+c_str_error_t
+c_rope_insert(CRope* self, size_t index, char const cstr[], size_t cstr_len)
+{
+  C_ROPE_CHECK_PARAMS(self);
+  C_ROPE_CHECK_PARAMS(cstr || cstr_len == 0);
+
+  if (index > self->len) { return C_STR_ERROR_wrong_index; }
+  if (cstr_len == 0) { return C_STR_ERROR_none; }
+
+  if (c_internal_rope_edit_in_place(self, index, cstr, cstr_len, 0)) {
+    return C_STR_ERROR_none;
+  }
+
+  // [1] everything that can fail comes first: the new text as a treap of
+  //     its own and the node the split may need
+  CRopeNode* middle = NULL;
+  for (size_t done = 0; done < cstr_len; done += C_ROPE_CHUNK_SIZE) {
+    size_t const chunk_len = (cstr_len - done < C_ROPE_CHUNK_SIZE)
+                                 ? cstr_len - done
+                                 : C_ROPE_CHUNK_SIZE;
+
+    CRopeNode*    node = NULL;
+    c_str_error_t err
+        = c_internal_rope_node_create(self, cstr + done, chunk_len, &node);
+    if (err.code != C_STR_ERROR_none.code) {
+      c_internal_rope_node_destroy(middle);
+      return err;
+    }
+    middle = c_internal_rope_merge(middle, node);
+  }
+
+  CRopeNode*    spare = NULL;
+  c_str_error_t err   = c_internal_rope_prepare_split(self, index, &spare);
+  if (err.code != C_STR_ERROR_none.code) {
+    c_internal_rope_node_destroy(middle);
+    return err;
+  }
+
+  // [2] split at `index` and put the text in between
+  CRopeNode* left  = NULL;
+  CRopeNode* right = NULL;
+  c_internal_rope_split(self->root, index, &spare, &left, &right);
+
+  left       = c_internal_rope_merge(left, middle);
+  self->root = c_internal_rope_merge(left, right);
+  self->len += cstr_len;
+
+  return C_STR_ERROR_none;
+}
+
+c_str_error_t
+c_rope_remove(CRope* self, size_t index, size_t range, size_t* out_range_size)
+{
+  C_ROPE_CHECK_PARAMS(self);
+
+  if (index >= self->len) { return C_STR_ERROR_wrong_index; }
+  if (range > self->len - index) { range = self->len - index; }
+  if (out_range_size) { *out_range_size = range; }
+  if (range == 0) { return C_STR_ERROR_none; }
+
+  if (c_internal_rope_edit_in_place(self, index, NULL, 0, range)) {
+    return C_STR_ERROR_none;
+  }
+
+  // each end of the range may cut a chunk in two. when both ends are in the
+  // same chunk the first spare holds too much text, but it lands in the
+  // removed part anyway
+  CRopeNode*    spare_begin = NULL;
+  CRopeNode*    spare_end   = NULL;
+  c_str_error_t err = c_internal_rope_prepare_split(self, index, &spare_begin);
+  if (err.code == C_STR_ERROR_none.code) {
+    err = c_internal_rope_prepare_split(self, index + range, &spare_end);
+  }
+  if (err.code != C_STR_ERROR_none.code) {
+    c_internal_rope_node_destroy(spare_begin);
+    return err;
+  }
+
+  CRopeNode* left   = NULL;
+  CRopeNode* middle = NULL;
+  CRopeNode* right  = NULL;
+  c_internal_rope_split(self->root, index + range, &spare_end, &left, &right);
+  c_internal_rope_split(left, index, &spare_begin, &left, &middle);
+
+  c_internal_rope_node_destroy(middle);
+  self->root = c_internal_rope_merge(left, right);
+  self->len -= range;
+
+  return C_STR_ERROR_none;
+}
+
+c_str_error_t
+c_rope_get(CRope const* self, size_t index, char* out_char)
+{
+  C_ROPE_CHECK_PARAMS(self);
+
+  if (index >= self->len) { return C_STR_ERROR_wrong_index; }
+
+  CRopeNode const* node = self->root;
+  while (node) {
+    size_t const left_size = c_internal_rope_size(node->left);
+    size_t const chunk_len = c_str_len(&node->chunk);
+
+    if (index < left_size) {
+      node = node->left;
+    } else if (index < left_size + chunk_len) {
+      if (out_char) { *out_char = c_str_data(&node->chunk)[index - left_size]; }
+      break;
+    } else {
+      index -= left_size + chunk_len;
+      node = node->right;
+    }
+  }
+
+  return C_STR_ERROR_none;
+}
+
+size_t
+c_rope_len(CRope const* self)
+{
+  return self->len;
+}
+
+bool
+c_rope_iter(CRope const* self, size_t* iter, CStrView* out_chunk)
+{
+  if (!self || !iter || *iter >= self->len) { return false; }
+
+  size_t           index = *iter;
+  CRopeNode const* node  = self->root;
+  while (node) {
+    size_t const left_size = c_internal_rope_size(node->left);
+    size_t const chunk_len = c_str_len(&node->chunk);
+
+    if (index < left_size) {
+      node = node->left;
+    } else if (index < left_size + chunk_len) {
+      size_t const offset = index - left_size;
+      if (out_chunk) {
+        *out_chunk = (CStrView){.ptr = c_str_data(&node->chunk) + offset,
+                                .len = chunk_len - offset};
+      }
+      *iter += chunk_len - offset;
+      return true;
+    } else {
+      index -= left_size + chunk_len;
+      node = node->right;
+    }
+  }
+
+  return false;
+}
+
+c_str_error_t
+c_rope_to_str(CRope const* self, CStr* out_str)
+{
+  C_ROPE_CHECK_PARAMS(self);
+
+  if (!out_str) { return C_STR_ERROR_none; }
+
+  c_str_error_t err = c_str_create_empty(self->len + 1, out_str);
+  if (err.code != C_STR_ERROR_none.code) { return err; }
+
+  err = c_internal_rope_append_to_str(self->root, out_str);
+  if (err.code != C_STR_ERROR_none.code) { c_str_destroy(out_str); }
+
+  return err;
+}
+
+void
+c_rope_destroy(CRope* self)
+{
+  if (self) {
+    c_internal_rope_node_destroy(self->root);
+    *self = (CRope){0};
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+/* ------------------------------- internal ------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+c_str_error_t
+c_internal_rope_node_create(CRope*      self,
+                            char const  cstr[],
+                            size_t      cstr_len,
+                            CRopeNode** out_node)
+{
+  CRopeNode* node = malloc(sizeof(*node));
+  if (!node) { return C_STR_ERROR_mem_allocation; }
+
+  c_str_error_t err = c_str_create(cstr, cstr_len, &node->chunk);
+  if (err.code != C_STR_ERROR_none.code) {
+    free(node);
+    return err;
+  }
+
+  // xorshift64
+  self->seed ^= self->seed << 13;
+  self->seed ^= self->seed >> 7;
+  self->seed ^= self->seed << 17;
+
+  node->left     = NULL;
+  node->right    = NULL;
+  node->size     = cstr_len;
+  node->priority = self->seed;
+  *out_node      = node;
+
+  return C_STR_ERROR_none;
+}
+
+void
+c_internal_rope_node_destroy(CRopeNode* node)
+{
+  if (node) {
+    c_internal_rope_node_destroy(node->left);
+    c_internal_rope_node_destroy(node->right);
+    c_str_destroy(&node->chunk);
+    free(node);
+  }
+}
+
+CRopeNode*
+c_internal_rope_merge(CRopeNode* left, CRopeNode* right)
+{
+  if (!left) { return right; }
+  if (!right) { return left; }
+
+  if (left->priority > right->priority) {
+    left->right = c_internal_rope_merge(left->right, right);
+    c_internal_rope_update(left);
+    return left;
+  }
+
+  right->left = c_internal_rope_merge(left, right->left);
+  c_internal_rope_update(right);
+  return right;
+}
+
+void
+c_internal_rope_split(CRopeNode*  node,
+                      size_t      offset,
+                      CRopeNode** spare,
+                      CRopeNode** out_left,
+                      CRopeNode** out_right)
+{
+  if (!node) {
+    *out_left  = NULL;
+    *out_right = NULL;
+    return;
+  }
+
+  size_t const left_size = c_internal_rope_size(node->left);
+  size_t const chunk_len = c_str_len(&node->chunk);
+
+  if (offset <= left_size) {
+    c_internal_rope_split(node->left, offset, spare, out_left, &node->left);
+    c_internal_rope_update(node);
+    *out_right = node;
+  } else if (offset >= left_size + chunk_len) {
+    c_internal_rope_split(node->right, offset - left_size - chunk_len, spare,
+                          &node->right, out_right);
+    c_internal_rope_update(node);
+    *out_left = node;
+  } else {
+    // the cut falls inside this chunk: the spare already holds its tail
+    // (see `c_internal_rope_prepare_split`) and takes over the right
+    // subtree, with the same priority the heap order still holds
+    CRopeNode* tail = *spare;
+    *spare          = NULL;
+
+    size_t const cut = offset - left_size;
+    c_str_set_len(&node->chunk, cut);
+    c_str_data(&node->chunk)[cut] = '\0';
+
+    tail->priority = node->priority;
+    tail->right    = node->right;
+    node->right    = NULL;
+    c_internal_rope_update(tail);
+    c_internal_rope_update(node);
+
+    *out_left  = node;
+    *out_right = tail;
+  }
+}
+
+c_str_error_t
+c_internal_rope_prepare_split(CRope* self, size_t offset, CRopeNode** out_spare)
+{
+  *out_spare = NULL;
+
+  CRopeNode const* node = self->root;
+  while (node) {
+    size_t const left_size = c_internal_rope_size(node->left);
+    size_t const chunk_len = c_str_len(&node->chunk);
+
+    if (offset <= left_size) {
+      node = node->left;
+    } else if (offset >= left_size + chunk_len) {
+      offset -= left_size + chunk_len;
+      node = node->right;
+    } else {
+      size_t const cut = offset - left_size;
+      return c_internal_rope_node_create(self, c_str_data(&node->chunk) + cut,
+                                         chunk_len - cut, out_spare);
+    }
+  }
+
+  // the offset is already between two chunks
+  return C_STR_ERROR_none;
+}
+
+bool
+c_internal_rope_edit_in_place(CRope*     self,
+                              size_t     index,
+                              char const cstr[],
+                              size_t     cstr_len,
+                              size_t     range)
+{
+  // find the chunk the edit lands in, an insert may also land right after
+  // the last byte of a chunk
+  size_t const reach  = (range == 0) ? 1 : 0;
+  CRopeNode*   node   = self->root;
+  size_t       offset = index;
+  while (node) {
+    size_t const left_size = c_internal_rope_size(node->left);
+    size_t const chunk_len = c_str_len(&node->chunk);
+
+    if (offset < left_size) {
+      node = node->left;
+    } else if (offset - left_size < chunk_len + reach) {
+      break;
+    } else {
+      offset -= left_size + chunk_len;
+      node = node->right;
+    }
+  }
+  if (!node) { return false; }
+
+  CStr*        chunk     = &node->chunk;
+  size_t const chunk_len = c_str_len(chunk);
+  size_t const cut       = offset - c_internal_rope_size(node->left);
+
+  c_str_error_t err = C_STR_ERROR_none;
+  if (range == 0) {
+    if (chunk_len + cstr_len > C_ROPE_CHUNK_SIZE) { return false; }
+    err = (cut == chunk_len) ? c_str_append_with_cstr(chunk, cstr, cstr_len)
+                             : c_str_insert(chunk, cstr, cstr_len, cut);
+  } else {
+    // emptying the chunk would leave an empty node behind
+    if (cut + range > chunk_len || range == chunk_len) { return false; }
+    err = c_str_remove_at(chunk, cut, range, NULL);
+  }
+  if (err.code != C_STR_ERROR_none.code) { return false; }
+
+  // walk the same path again to fix the sizes on the way
+  size_t const grown = cstr_len;
+  CRopeNode*   step  = self->root;
+  offset             = index;
+  while (step != node) {
+    size_t const left_size = c_internal_rope_size(step->left);
+    size_t const step_len  = c_str_len(&step->chunk);
+
+    step->size = step->size + grown - range;
+    if (offset < left_size) {
+      step = step->left;
+    } else {
+      offset -= left_size + step_len;
+      step = step->right;
+    }
+  }
+  node->size = node->size + grown - range;
+
+  self->len = self->len + grown - range;
+
+  return true;
+}
+
+c_str_error_t
+c_internal_rope_append_to_str(CRopeNode const* node, CStr* str)
+{
+  if (!node) { return C_STR_ERROR_none; }
+
+  c_str_error_t err = c_internal_rope_append_to_str(node->left, str);
+  if (err.code != C_STR_ERROR_none.code) { return err; }
+
+  err = c_str_append(str, &node->chunk);
+  if (err.code != C_STR_ERROR_none.code) { return err; }
+
+  return c_internal_rope_append_to_str(node->right, str);
+}
+
+size_t
+c_internal_rope_size(CRopeNode const* node)
+{
+  return node ? node->size : 0;
+}
+
+void
+c_internal_rope_update(CRopeNode* node)
+{
+  node->size = c_internal_rope_size(node->left) + c_str_len(&node->chunk)
+               + c_internal_rope_size(node->right);
+}
+
+#undef C_ROPE_CHECK_PARAMS
+#undef CSTDLIB_ROPE_IMPLEMENTATION
+#endif // CSTDLIB_ROPE_IMPLEMENTATION
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_ROPE_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#define CSTDLIB_STR_IMPLEMENTATION
+#include "str.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROPE_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define ROPE_TEST(err)                                                         \
+  ((err.code != C_STR_ERROR_none.code) ? ROPE_TEST_PRINT_ABORT(err.desc)       \
+                                       : (void)0)
+#define ROPE_ASSERT(cond) (!(cond)) ? ROPE_TEST_PRINT_ABORT(#cond) : (void)0
+
+int
+main(void)
+{
+  c_str_error_t err = C_STR_ERROR_none;
+
+  // test: insert, remove, get, to_str
+  {
+    CRope rope;
+    err = c_rope_create_from_cstr("Hello world", 11, &rope);
+    ROPE_TEST(err);
+
+    err = c_rope_insert(&rope, 5, ",", 1);
+    ROPE_TEST(err);
+    err = c_rope_insert(&rope, c_rope_len(&rope), "!", 1);
+    ROPE_TEST(err);
+    err = c_rope_insert(&rope, 0, ">> ", 3);
+    ROPE_TEST(err);
+
+    size_t removed = 0;
+    err            = c_rope_remove(&rope, 9, 100, &removed);
+    ROPE_TEST(err);
+    ROPE_ASSERT(removed == 7);
+
+    char ch = 0;
+    err     = c_rope_get(&rope, 3, &ch);
+    ROPE_TEST(err);
+    ROPE_ASSERT(ch == 'H');
+    err = c_rope_get(&rope, c_rope_len(&rope), &ch);
+    ROPE_ASSERT(err.code == C_STR_ERROR_wrong_index.code);
+
+    CStr str;
+    err = c_rope_to_str(&rope, &str);
+    ROPE_TEST(err);
+    ROPE_ASSERT(strcmp(c_str_data(&str), ">> Hello,") == 0);
+    ROPE_ASSERT(c_str_len(&str) == c_rope_len(&rope));
+
+    c_str_destroy(&str);
+    c_rope_destroy(&rope);
+  }
+
+  // test: random edits against a flat buffer, with chunks big enough to be
+  //       split in the middle and small enough to have many of them
+  {
+    enum { MAX_LEN = 64 * 1024 };
+    char* model = malloc(MAX_LEN);
+    char* text  = malloc(4 * C_ROPE_CHUNK_SIZE);
+    ROPE_ASSERT(model && text);
+    size_t model_len = 0;
+
+    CRope rope;
+    err = c_rope_create(&rope);
+    ROPE_TEST(err);
+
+    srand(42);
+    for (size_t step = 0; step < 20000; ++step) {
+      size_t const index = model_len ? (size_t)rand() % (model_len + 1) : 0;
+
+      if (model_len < MAX_LEN / 2 && rand() % 3 != 0) {
+        // mostly keystrokes, now and then a paste larger than a chunk
+        size_t const len = (rand() % 50 == 0)
+                               ? 1 + (size_t)rand() % (3 * C_ROPE_CHUNK_SIZE)
+                               : 1 + (size_t)rand() % 4;
+        for (size_t iii = 0; iii < len; ++iii) {
+          text[iii] = (char)('a' + rand() % 26);
+        }
+
+        err = c_rope_insert(&rope, index, text, len);
+        ROPE_TEST(err);
+        memmove(model + index + len, model + index, model_len - index);
+        memcpy(model + index, text, len);
+        model_len += len;
+      } else if (model_len > 0) {
+        size_t const start = index < model_len ? index : model_len - 1;
+        size_t const range = (rand() % 20 == 0)
+                                 ? (size_t)rand() % (2 * C_ROPE_CHUNK_SIZE)
+                                 : (size_t)rand() % 8;
+
+        size_t removed = 0;
+        err            = c_rope_remove(&rope, start, range, &removed);
+        ROPE_TEST(err);
+        memmove(model + start, model + start + removed,
+                model_len - start - removed);
+        model_len -= removed;
+      }
+
+      ROPE_ASSERT(c_rope_len(&rope) == model_len);
+      if (model_len > 0 && step % 16 == 0) {
+        size_t const index_to_check = (size_t)rand() % model_len;
+        char         ch             = 0;
+        err = c_rope_get(&rope, index_to_check, &ch);
+        ROPE_TEST(err);
+        ROPE_ASSERT(ch == model[index_to_check]);
+      }
+    }
+
+    // the chunks cover the text exactly, in order
+    size_t   iter   = 0;
+    size_t   offset = 0;
+    CStrView chunk  = {0};
+    while (c_rope_iter(&rope, &iter, &chunk)) {
+      ROPE_ASSERT(chunk.len > 0 && chunk.len <= C_ROPE_CHUNK_SIZE);
+      ROPE_ASSERT(memcmp(chunk.ptr, model + offset, chunk.len) == 0);
+      offset += chunk.len;
+    }
+    ROPE_ASSERT(offset == model_len);
+
+    CStr str;
+    err = c_rope_to_str(&rope, &str);
+    ROPE_TEST(err);
+    ROPE_ASSERT(c_str_len(&str) == model_len);
+    ROPE_ASSERT(memcmp(c_str_data(&str), model, model_len) == 0);
+
+    c_str_destroy(&str);
+    c_rope_destroy(&rope);
+    free(text);
+    free(model);
+  }
+}
+
+#ifdef NDEBUG_
+#define NDEBUG
+#undef NDEBUG_
+#endif
+
+#undef ROPE_TEST_PRINT_ABORT
+#undef ROPE_TEST
+#undef ROPE_ASSERT
+#undef CSTDLIB_ROPE_UNIT_TESTS
+#endif // CSTDLIB_ROPE_UNIT_TESTS
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Mohamed A. Elmeligy
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions: The above copyright
+ * notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS",
+ * WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -0,0 +1,443 @@
+/* How To  : To use this module, do this in *ONE* C file:
+ *              #define CSTDLIB_SET_IMPLEMENTATION
+ *              #include "set.h"
+ *           it depends on "map.h", so CSTDLIB_MAP_IMPLEMENTATION has to be
+ *           defined in one C file as well
+ * Tests   : To use run test, do this in *ONE* C file:
+ *              #define CSTDLIB_SET_UNIT_TESTS
+ *              #include "set.h"
+ * Options :
+ *           - C_SET_DONT_CHECK_PARAMS: parameters will not get checked
+ *                                      (this is off by default)
+ * Notes   : a CSet is a CMap with zero sized values, so a bucket only holds
+ *           the bucket header and the key
+ * License : MIT (go to the end of this file for details)
+ */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- header -------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifndef CSTDLIB_SET_H
+#define CSTDLIB_SET_H
+
+#include "map.h"
+
+typedef struct CSet {
+  CMap map;
+} CSet;
+
+/// @brief create an empty set
+/// @param key_size
+/// @param out_set
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_set_create(size_t key_size, CSet* out_set);
+
+/// @brief same as `c_set_create` but with allocating capacity
+/// @param key_size
+/// @param capacity
+/// @param out_set
+/// @return error (any value but zero is treated as an error)
+c_map_error_t
+c_set_create_with_capacity(size_t key_size, size_t capacity, CSet* out_set);
+
+/// @brief insert a key, inserting an existing key does nothing
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_set_insert(CSet* self, void* key);
+
+/// @brief check if `key` is in the set
+/// @return error (any value but zero is treated as an error)
+c_map_error_t c_set_contains(CSet const* self, void* key, bool* out_found);
+
+/// @brief remove a key
+/// @return C_MAP_ERROR_key_not_found if the key doesn't exist
+c_map_error_t c_set_remove(CSet* self, void* key);
+
+size_t c_set_len(CSet const* self);
+
+bool c_set_iter(CSet* self, size_t* iter, void** key);
+
+/// @brief create `out_set` with the keys of both sets, it starts as a copy of
+///        the larger set so only the smaller set is iterated
+/// @return error (any value but zero is treated as an error)
+c_map_error_t
+c_set_union(CSet const* set1, CSet const* set2, CSet* out_set);
+
+/// @brief create `out_set` with the keys found in both sets, only the smaller
+///        set is iterated
+/// @return error (any value but zero is treated as an error)
+c_map_error_t
+c_set_intersection(CSet const* set1, CSet const* set2, CSet* out_set);
+
+/// @brief create `out_set` with the keys of `set1` that are not in `set2`,
+///        `set1` has to be iterated whatever its size is
+/// @return error (any value but zero is treated as an error)
+c_map_error_t
+c_set_difference(CSet const* set1, CSet const* set2, CSet* out_set);
+
+void c_set_clear(CSet* self,
+                 void  key_destroy_fn(void* key, void* user_data),
+                 void* user_data);
+
+void c_set_destroy(CSet* self,
+                   void  key_destroy_fn(void* key, void* user_data),
+                   void* user_data);
+
+#endif // CSTDLIB_SET_H
+
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- implementation ---------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_SET_IMPLEMENTATION
+#include <stdlib.h>
+#include <string.h>
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifndef C_SET_DONT_CHECK_PARAMS
+#define C_SET_CHECK_PARAMS(params)                                             \
+  if (!(params)) return C_MAP_ERROR_invalid_parameters;
+#else
+#define C_SET_CHECK_PARAMS(params) ((void)0)
+#endif
+
+c_map_error_t
+c_set_create(size_t key_size, CSet* out_set)
+{
+  return c_set_create_with_capacity(key_size, CMAP_DEFAULT_CAPACITY, out_set);
+}
+
+c_map_error_t
+c_set_create_with_capacity(size_t key_size, size_t capacity, CSet* out_set)
+{
+  if (!out_set) { return C_MAP_ERROR_none; }
+
+  *out_set = (CSet){0};
+
+  return c_map_create_with_capacity(key_size, 0, capacity, &out_set->map);
+}
+
+c_map_error_t
+c_set_insert(CSet* self, void* key)
+{
+  C_SET_CHECK_PARAMS(self);
+
+  return c_map_insert(&self->map, key, NULL);
+}
+
+c_map_error_t
+c_set_contains(CSet const* self, void* key, bool* out_found)
+{
+  C_SET_CHECK_PARAMS(self);
+
+  if (!out_found) { return C_MAP_ERROR_none; }
+
+  void*         value = NULL;
+  c_map_error_t err   = c_map_get(&self->map, key, &value);
+  *out_found          = value != NULL;
+
+  return err;
+}
+
+c_map_error_t
+c_set_remove(CSet* self, void* key)
+{
+  C_SET_CHECK_PARAMS(self);
+
+  void* value = NULL;
+  return c_map_remove(&self->map, key, &value);
+}
+
+size_t
+c_set_len(CSet const* self)
+{
+  return c_map_len(&self->map);
+}
+
+bool
+c_set_iter(CSet* self, size_t* iter, void** key)
+{
+  return c_map_iter(&self->map, iter, key, NULL);
+}
+
+c_map_error_t
+c_set_union(CSet const* set1, CSet const* set2, CSet* out_set)
+{
+  C_SET_CHECK_PARAMS(set1 && set2);
+  C_SET_CHECK_PARAMS(set1->map.key_size.orig == set2->map.key_size.orig);
+
+  if (!out_set) { return C_MAP_ERROR_none; }
+
+  CSet const* smaller = set1;
+  CSet const* larger  = set2;
+  if (c_set_len(set2) < c_set_len(set1)) {
+    smaller = set2;
+    larger  = set1;
+  }
+
+  // the table of the larger set is copied as it is, none of its keys is hashed
+  c_map_error_t err = c_map_clone(&larger->map, &out_set->map);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  size_t iter = 0;
+  void*  key  = NULL;
+  while (c_set_iter((CSet*)smaller, &iter, &key)) {
+    err = c_set_insert(out_set, key);
+    if (err.code != C_MAP_ERROR_none.code) {
+      c_set_destroy(out_set, NULL, NULL);
+      return err;
+    }
+  }
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_set_intersection(CSet const* set1, CSet const* set2, CSet* out_set)
+{
+  C_SET_CHECK_PARAMS(set1 && set2);
+  C_SET_CHECK_PARAMS(set1->map.key_size.orig == set2->map.key_size.orig);
+
+  if (!out_set) { return C_MAP_ERROR_none; }
+
+  CSet const* smaller = set1;
+  CSet const* larger  = set2;
+  if (c_set_len(set2) < c_set_len(set1)) {
+    smaller = set2;
+    larger  = set1;
+  }
+
+  c_map_error_t err = c_set_create(set1->map.key_size.orig, out_set);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  size_t iter = 0;
+  void*  key  = NULL;
+  while (c_set_iter((CSet*)smaller, &iter, &key)) {
+    bool found = false;
+    c_set_contains(larger, key, &found);
+    if (!found) continue;
+
+    err = c_set_insert(out_set, key);
+    if (err.code != C_MAP_ERROR_none.code) {
+      c_set_destroy(out_set, NULL, NULL);
+      return err;
+    }
+  }
+
+  return C_MAP_ERROR_none;
+}
+
+c_map_error_t
+c_set_difference(CSet const* set1, CSet const* set2, CSet* out_set)
+{
+  C_SET_CHECK_PARAMS(set1 && set2);
+  C_SET_CHECK_PARAMS(set1->map.key_size.orig == set2->map.key_size.orig);
+
+  if (!out_set) { return C_MAP_ERROR_none; }
+
+  c_map_error_t err = c_set_create(set1->map.key_size.orig, out_set);
+  if (err.code != C_MAP_ERROR_none.code) { return err; }
+
+  size_t iter = 0;
+  void*  key  = NULL;
+  while (c_set_iter((CSet*)set1, &iter, &key)) {
+    bool found = false;
+    if (c_set_len(set2)) { c_set_contains(set2, key, &found); }
+    if (found) continue;
+
+    err = c_set_insert(out_set, key);
+    if (err.code != C_MAP_ERROR_none.code) {
+      c_set_destroy(out_set, NULL, NULL);
+      return err;
+    }
+  }
+
+  return C_MAP_ERROR_none;
+}
+
+void
+c_set_clear(CSet* self,
+            void  key_destroy_fn(void* key, void* user_data),
+            void* user_data)
+{
+  if (key_destroy_fn) {
+    size_t iter = 0;
+    void*  key  = NULL;
+    while (c_set_iter(self, &iter, &key)) {
+      key_destroy_fn(key, user_data);
+    }
+  }
+
+  c_map_clear(&self->map, NULL, NULL);
+}
+
+void
+c_set_destroy(CSet* self,
+              void  key_destroy_fn(void* key, void* user_data),
+              void* user_data)
+{
+  if (self && self->map.buckets) {
+    if (key_destroy_fn) { c_set_clear(self, key_destroy_fn, user_data); }
+    c_map_destroy(&self->map, NULL, NULL);
+  }
+}
+
+#undef C_SET_CHECK_PARAMS
+#undef CSTDLIB_SET_IMPLEMENTATION
+#endif // CSTDLIB_SET_IMPLEMENTATION
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_SET_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#define CSTDLIB_MAP_IMPLEMENTATION
+#include "map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SET_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define SET_TEST(err)                                                          \
+  ((err.code != C_MAP_ERROR_none.code) ? SET_TEST_PRINT_ABORT(err.desc)        \
+                                       : (void)0)
+#define SET_ASSERT(cond) (!(cond)) ? SET_TEST_PRINT_ABORT(#cond) : (void)0
+
+int
+main(void)
+{
+  c_map_error_t err = C_MAP_ERROR_none;
+
+  // test: insert, contains, remove
+  {
+    CSet set;
+    err = c_set_create(sizeof(int), &set);
+    SET_TEST(err);
+    // no room wasted for values
+    SET_ASSERT(set.map.bucket_size == 2 * sizeof(uint64_t));
+
+    for (int iii = 0; iii < 50; ++iii) {
+      err = c_set_insert(&set, &iii);
+      SET_TEST(err);
+    }
+    err = c_set_insert(&set, &(int){10});
+    SET_TEST(err);
+    SET_ASSERT(c_set_len(&set) == 50);
+
+    bool found = false;
+    err        = c_set_contains(&set, &(int){10}, &found);
+    SET_TEST(err);
+    SET_ASSERT(found);
+    err = c_set_contains(&set, &(int){50}, &found);
+    SET_TEST(err);
+    SET_ASSERT(!found);
+
+    err = c_set_remove(&set, &(int){10});
+    SET_TEST(err);
+    err = c_set_contains(&set, &(int){10}, &found);
+    SET_TEST(err);
+    SET_ASSERT(!found);
+    err = c_set_remove(&set, &(int){10});
+    SET_ASSERT(err.code == C_MAP_ERROR_key_not_found.code);
+
+    c_set_destroy(&set, NULL, NULL);
+  }
+
+  // test: union, intersection, difference
+  {
+    CSet evens;
+    CSet threes;
+    err = c_set_create(sizeof(int), &evens);
+    SET_TEST(err);
+    err = c_set_create(sizeof(int), &threes);
+    SET_TEST(err);
+
+    for (int iii = 0; iii < 30; iii += 2) {
+      err = c_set_insert(&evens, &iii);
+      SET_TEST(err);
+    }
+    for (int iii = 0; iii < 30; iii += 3) {
+      err = c_set_insert(&threes, &iii);
+      SET_TEST(err);
+    }
+
+    CSet result;
+    err = c_set_union(&evens, &threes, &result);
+    SET_TEST(err);
+    SET_ASSERT(c_set_len(&result) == 20);
+    c_set_destroy(&result, NULL, NULL);
+
+    // the smaller set may come first as well
+    err = c_set_union(&threes, &evens, &result);
+    SET_TEST(err);
+    SET_ASSERT(c_set_len(&result) == 20);
+    for (int iii = 0; iii < 30; ++iii) {
+      bool found = false;
+      err        = c_set_contains(&result, &iii, &found);
+      SET_TEST(err);
+      SET_ASSERT(found == (iii % 2 == 0 || iii % 3 == 0));
+    }
+    c_set_destroy(&result, NULL, NULL);
+
+    err = c_set_intersection(&evens, &threes, &result);
+    SET_TEST(err);
+    SET_ASSERT(c_set_len(&result) == 5);
+    size_t iter = 0;
+    int*   key  = NULL;
+    while (c_set_iter(&result, &iter, (void**)&key)) {
+      SET_ASSERT(*key % 6 == 0);
+    }
+    c_set_destroy(&result, NULL, NULL);
+
+    err = c_set_difference(&evens, &threes, &result);
+    SET_TEST(err);
+    SET_ASSERT(c_set_len(&result) == 10);
+    iter = 0;
+    while (c_set_iter(&result, &iter, (void**)&key)) {
+      SET_ASSERT(*key % 2 == 0 && *key % 3 != 0);
+    }
+    c_set_destroy(&result, NULL, NULL);
+
+    c_set_destroy(&evens, NULL, NULL);
+    c_set_destroy(&threes, NULL, NULL);
+  }
+}
+
+#ifdef NDEBUG_
+#define NDEBUG
+#undef NDEBUG_
+#endif
+
+#undef SET_TEST_PRINT_ABORT
+#undef SET_TEST
+#undef SET_ASSERT
+#undef CSTDLIB_SET_UNIT_TESTS
+#endif // CSTDLIB_SET_UNIT_TESTS
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Mohamed A. Elmeligy
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions: The above copyright
+ * notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS",
+ * WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
@@ -4,6 +4,29 @@
  * Tests  : To use run tests, do this in *ONE* C file:
  *              #define CSTDLIB_STR_UNIT_TESTS
  *              #include "str.h"
+ * Options:
+ *          - C_STR_DONT_CHECK_PARAMS: parameters will not get checked
+ *                                     (this is off by default)
+ *          - C_STR_NO_SIMD: don't use SSE2/SSSE3/AVX2 even if the target
+ *                           has them
+ *                           (this is off by default)
+ *          - C_STR_ENABLE_SSO: keep short strings inside the `CStr` struct
+ *                              instead of allocating them, it has to be
+ *                              the same for every file using str.h
+ *                              (this is off by default)
+ * Notes  : substring search (`c_str_find`, `c_str_remove`, `c_str_replace`)
+ *          filters candidates on the first and last byte of the needle,
+ *          16 (SSE2) or 32 (AVX2) offsets at a time, and only then compares
+ *          the middle. needles of `C_STR_HORSPOOL_MIN_LEN` bytes or more use
+ *          Boyer-Moore-Horspool instead
+ *          with C_STR_ENABLE_SSO `CStr` grows by `C_STR_SSO_CAPACITY` bytes
+ *          and strings that fit there (the NUL included) don't allocate,
+ *          `data` then points into the struct itself, so such a `CStr` can't
+ *          be copied or moved by value (returned, `memcpy`, `realloc` of an
+ *          array of them, ...) as the copy would point into the old one.
+ *          without it a `CStr` moves like any other struct
+ *          a `CStrView` is a (ptr, len) pair into some other string, the
+ *          `c_str_view_*` functions never allocate
  * License: MIT (go to the end of this file for details)
  */
 
@@ -18,12 +41,25 @@
 #include <stddef.h>
 #include <stdint.h>
 
+// the bytes (the NUL included) a `CStr` keeps inline with C_STR_ENABLE_SSO
+#define C_STR_SSO_CAPACITY 16U
+
 typedef struct CStr {
   char*  data;
   size_t capacity;
   size_t len;
+#ifdef C_STR_ENABLE_SSO
+  char inline_data[C_STR_SSO_CAPACITY]; // `data` points here when it fits
+#endif
 } CStr;
 
+/// a non owning (pointer, length) slice of a string, it is not NUL terminated
+/// and stays valid only as long as the memory it points into
+typedef struct CStrView {
+  char const* ptr;
+  size_t      len;
+} CStrView;
+
 // typedef struct CGrapheme
 // {
 //   size_t index;
@@ -48,6 +84,10 @@ typedef struct c_str_error_t {
   ((c_str_error_t){.code = 5, .desc = "str: needle not found"})
 #define C_STR_ERROR_invalid_parameters                                         \
   ((c_str_error_t){.code = 6, .desc = "str: invalid parameters"})
+#define C_STR_ERROR_invalid_utf16                                              \
+  ((c_str_error_t){.code = 7, .desc = "str: invalid utf-16"})
+#define C_STR_ERROR_buffer_too_small                                           \
+  ((c_str_error_t){.code = 8, .desc = "str: buffer too small"})
 
 c_str_error_t c_str_create(char const cstr[], size_t cstr_len, CStr* out_cstr);
 
@@ -75,6 +115,45 @@ c_str_error_t c_str_replace(CStr*      self,
 c_str_error_t c_str_replace_at(
     CStr* self, size_t index, size_t range, char const with[], size_t with_len);
 
+/// @brief replace every (non overlapping) occurrence of `needle` with `with`
+///        the string is scanned twice and reallocated at most once
+/// @param with can be empty to remove every occurrence
+/// @param out_count number of replaced occurrences (can be NULL)
+/// @return C_STR_ERROR_needle_not_found if there isn't any occurrence
+c_str_error_t c_str_replace_all(CStr*      self,
+                                char const needle[],
+                                size_t     needle_len,
+                                char const with[],
+                                size_t     with_len,
+                                size_t*    out_count);
+
+/// @brief iterate over the (non overlapping) occurrences of `needle`
+///        nothing is copied, the occurrence is at
+///        `c_str_data(self) + *out_offset`
+/// @param iter has to start at 0
+/// @param out_offset
+/// @return false once there are no more occurrences
+bool c_str_find_iter(CStr const* self,
+                     char const  needle[],
+                     size_t      needle_len,
+                     size_t*     iter,
+                     size_t*     out_offset);
+
+/// @brief iterate over the pieces between the occurrences of `separator`
+///        nothing is copied, a piece is `*out_len` bytes at
+///        `c_str_data(self) + *out_offset`, empty pieces are yielded as well
+///        (so "a,,b" gives "a", "" and "b")
+/// @param iter has to start at 0
+/// @param out_offset
+/// @param out_len
+/// @return false once the last piece was yielded
+bool c_str_split_iter(CStr const* self,
+                      char const  separator[],
+                      size_t      separator_len,
+                      size_t*     iter,
+                      size_t*     out_offset,
+                      size_t*     out_len);
+
 c_str_error_t c_str_append(CStr* str1, CStr const* str2);
 
 c_str_error_t
@@ -88,15 +167,83 @@ c_str_error_t c_str_format_va(CStr*       self,
                               char const* format,
                               va_list     va);
 
+/// @brief check that `self` is well formed utf-8 (no overlong forms, no
+///        surrogates, nothing above U+10FFFF), 16 (SSSE3) or 32 (AVX2) bytes
+///        at a time, without those ascii runs are skipped 16 bytes at a time
+/// @param out_is_valid
+/// @return error (any value but zero is treated as an error)
 c_str_error_t c_str_utf8_valid(CStr* self, bool* out_is_valid);
 
+/// @brief number of bytes of the codepoint at `index`
+/// @param out_next_cp_index set to the size (1 to 4) of the codepoint, or to 1
+///                          if it isn't valid utf-8
+/// @return C_STR_ERROR_invalid_utf8 for a malformed, overlong, surrogate or
+///         truncated sequence
 c_str_error_t
 c_str_utf8_next_codepoint(CStr* self, size_t index, size_t* out_next_cp_index);
 
+/// @brief number of codepoints in `self`
+///        `self` has to be valid utf-8 (see `c_str_utf8_valid`), otherwise
+///        the count is meaningless
+/// @param out_count
+/// @return error (any value but zero is treated as an error)
+c_str_error_t c_str_utf8_count(CStr* self, size_t* out_count);
+
+/// @brief transcode utf-8 into utf-16 (native byte order)
+///        with `out == NULL` nothing is written and `*out_len` is the exact
+///        number of units needed
+///        for streaming, pass `out_consumed`: a sequence cut by the end of
+///        `src` is then left unconsumed (feed it again with the next chunk)
+///        instead of being an error
+/// @param src
+/// @param src_len in bytes
+/// @param out (can be NULL)
+/// @param out_capacity in units
+/// @param out_len units written (or needed)
+/// @param out_consumed bytes of `src` consumed (can be NULL)
+/// @return C_STR_ERROR_invalid_utf8, or C_STR_ERROR_buffer_too_small after
+///         converting what fits
+c_str_error_t c_str_utf8_to_utf16(char const src[],
+                                  size_t     src_len,
+                                  uint16_t   out[],
+                                  size_t     out_capacity,
+                                  size_t*    out_len,
+                                  size_t*    out_consumed);
+
+/// @brief transcode utf-16 (native byte order) into utf-8, works like
+///        `c_str_utf8_to_utf16`, a high surrogate at the end of `src` is the
+///        incomplete tail
+/// @param src_len in units
+/// @param out_capacity in bytes
+/// @param out_len bytes written (or needed)
+/// @param out_consumed units of `src` consumed (can be NULL)
+/// @return C_STR_ERROR_invalid_utf16 for an unpaired surrogate, or
+///         C_STR_ERROR_buffer_too_small after converting what fits
+c_str_error_t c_str_utf16_to_utf8(uint16_t const src[],
+                                  size_t         src_len,
+                                  char           out[],
+                                  size_t         out_capacity,
+                                  size_t*        out_len,
+                                  size_t*        out_consumed);
+
+/// @brief transcode utf-8 into utf-32, works like `c_str_utf8_to_utf16`
+/// @param out_capacity in codepoints
+/// @param out_len codepoints written (or needed)
+c_str_error_t c_str_utf8_to_utf32(char const src[],
+                                  size_t     src_len,
+                                  uint32_t   out[],
+                                  size_t     out_capacity,
+                                  size_t*    out_len,
+                                  size_t*    out_consumed);
+
 // size_t c_str_utf8_next_grapheme (CStr *self,
 //                                  size_t index,
 //                                  int *err);
 
+/// @brief the NUL terminated bytes of `self`, same as `self->data` (see
+///        C_STR_ENABLE_SSO)
+char* c_str_data(CStr const* self);
+
 size_t c_str_len(CStr const* self);
 
 c_str_error_t c_str_set_len(CStr* self, size_t len);
@@ -105,9 +252,60 @@ size_t c_str_capacity(CStr const* self);
 
 c_str_error_t c_str_set_capacity(CStr* self, size_t capacity);
 
+/// @brief make room for at least `len` bytes (plus the NUL) in one go,
+///        appending up to that length won't reallocate
+/// @param len
+/// @return error (any value but zero is treated as an error)
+c_str_error_t c_str_reserve(CStr* self, size_t len);
+
+/// @brief release the capacity that isn't used by the string and its NUL
+/// @return error (any value but zero is treated as an error)
+c_str_error_t c_str_shrink_to_fit(CStr* self);
+
 char const* c_str_get_whitespaces(void);
 
 void c_str_destroy(CStr* self);
+
+/// @brief view the whole of `self`
+CStrView c_str_view(CStr const* self);
+
+/// @brief view `cstr_len` bytes of `cstr`
+CStrView c_str_view_from_cstr(char const cstr[], size_t cstr_len);
+
+/// @brief view `len` bytes of `self` starting at `index`
+/// @param len is clipped to the end of `self`
+/// @param out_view
+/// @return C_STR_ERROR_wrong_index if `index` is past the end of `self`
+c_str_error_t
+c_str_view_slice(CStrView self, size_t index, size_t len, CStrView* out_view);
+
+/// @brief drop the leading and trailing `c_str_get_whitespaces()`
+CStrView c_str_view_trim(CStrView self);
+CStrView c_str_view_trim_left(CStrView self);
+CStrView c_str_view_trim_right(CStrView self);
+
+/// @brief lexicographic (byte wise) comparison, a prefix sorts first
+/// @return < 0, 0 or > 0 like memcmp
+int  c_str_view_compare(CStrView self, CStrView other);
+bool c_str_view_equal(CStrView self, CStrView other);
+
+/// @brief FNV-1a hash of the viewed bytes
+size_t c_str_view_hash(CStrView self);
+
+/// @brief find the first occurrence of `needle` (same search as `c_str_find`)
+/// @param out_offset offset of the occurrence from `self.ptr`
+/// @return false if there isn't any
+bool c_str_view_find(CStrView self, CStrView needle, size_t* out_offset);
+
+/// @brief same as `c_str_split_iter` but yields views
+/// @param iter has to start at 0
+/// @param out_piece
+/// @return false once the last piece was yielded
+bool c_str_view_split_iter(CStrView   self,
+                           char const separator[],
+                           size_t     separator_len,
+                           size_t*    iter,
+                           CStrView*  out_piece);
 #endif /* CSTDLIB_STR_H */
 
 /* ------------------------------------------------------------------------ */
@@ -139,10 +337,72 @@ void c_str_destroy(CStr* self);
 #pragma warning(disable : 4996) // disable warning about unsafe functions
 #endif
 
+#if !defined(C_STR_NO_SIMD)                                                    \
+    && (defined(__SSE2__) || defined(_M_X64)                                   \
+        || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define C_STR_SSE2
+#include <emmintrin.h>
+#if defined(__SSSE3__) || defined(__AVX2__)
+#define C_STR_SSSE3
+#include <tmmintrin.h>
+#endif
+#if defined(__AVX2__)
+#define C_STR_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_BitScanForward)
+#endif
+
 #define C_STR_WHITESPACES " \t\n\v\f\r"
 
+// the smallest capacity a string grows to (the NUL included)
+#define C_STR_MIN_CAPACITY 16U
+
+// needles this long skip the first/last byte filter and use Horspool
+#define C_STR_HORSPOOL_MIN_LEN 64U
+
+static inline bool   internal_c_str_is_small(CStr const* self);
+static c_str_error_t internal_c_str_grow(CStr* self, size_t min_capacity);
 static char*
 internal_c_str_find(CStr* self, char const cstr[], size_t cstr_len);
+static char const* internal_c_str_search(char const* haystack,
+                                         size_t      haystack_len,
+                                         char const* needle,
+                                         size_t      needle_len);
+static char const* internal_c_str_search_short(char const* haystack,
+                                               size_t      haystack_len,
+                                               char const* needle,
+                                               size_t      needle_len);
+static char const* internal_c_str_search_horspool(char const* haystack,
+                                                  size_t      haystack_len,
+                                                  char const* needle,
+                                                  size_t      needle_len);
+static inline size_t internal_c_str_ctz(uint32_t mask);
+static inline size_t internal_c_str_popcount(uint32_t mask);
+static size_t internal_c_str_ascii_len(unsigned char const* data, size_t len);
+#if defined(C_STR_SSSE3)
+static bool internal_c_str_utf8_valid_blocks(unsigned char const* data,
+                                             size_t               len,
+                                             size_t*              out_checked);
+static inline __m128i internal_c_str_utf8_errors_16(__m128i block,
+                                                    __m128i prev);
+#if defined(C_STR_AVX2)
+static inline __m256i internal_c_str_utf8_errors_32(__m256i block,
+                                                    __m256i prev);
+#endif
+static size_t internal_c_str_utf8_boundary(unsigned char const* data,
+                                           size_t               start,
+                                           size_t               end);
+#endif
+static size_t internal_c_str_utf8_decode(unsigned char const* bytes,
+                                         size_t               len,
+                                         uint32_t*            out_codepoint,
+                                         bool*                out_truncated);
+static size_t internal_c_str_utf16_ascii_len(uint16_t const* data, size_t len);
 
 c_str_error_t
 c_str_create(char const cstr[], size_t cstr_len, CStr* out_cstr)
@@ -154,10 +414,11 @@ c_str_create(char const cstr[], size_t cstr_len, CStr* out_cstr)
   c_str_error_t err = c_str_create_empty(cstr_len + 1, out_cstr);
   if (err.code != C_STR_ERROR_none.code) return C_STR_ERROR_mem_allocation;
 
-  memcpy(out_cstr->data, cstr, cstr_len);
+  char* data = c_str_data(out_cstr);
+  memcpy(data, cstr, cstr_len);
 
-  out_cstr->data[cstr_len] = '\0';
-  out_cstr->len            = cstr_len;
+  data[cstr_len] = '\0';
+  out_cstr->len  = cstr_len;
 
   return C_STR_ERROR_none;
 }
@@ -171,9 +432,19 @@ c_str_create_empty(size_t capacity, CStr* out_cstr)
 
   *out_cstr = (CStr){0};
 
+#ifdef C_STR_ENABLE_SSO
+  if (capacity <= C_STR_SSO_CAPACITY) {
+    out_cstr->data     = out_cstr->inline_data;
+    out_cstr->data[0]  = '\0';
+    out_cstr->capacity = C_STR_SSO_CAPACITY;
+    return C_STR_ERROR_none;
+  }
+#endif
+
   out_cstr->data = malloc(capacity);
   if (!out_cstr->data) { return C_STR_ERROR_mem_allocation; }
 
+  out_cstr->data[0]  = '\0';
   out_cstr->capacity = capacity;
 
   return C_STR_ERROR_none;
@@ -182,24 +453,20 @@ c_str_create_empty(size_t capacity, CStr* out_cstr)
 c_str_error_t
 c_str_insert(CStr* self, char const cstr[], size_t cstr_len, size_t index)
 {
-  C_STR_CHECK_PARAMS(self && self->data);
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
   C_STR_CHECK_PARAMS(cstr);
   C_STR_CHECK_PARAMS(cstr_len > 0);
 
-  index %= self->len;
+  size_t const len = c_str_len(self);
+  index %= len;
 
-  if ((self->len + cstr_len + 1) > self->capacity) {
-    char* reallocated_data = realloc(self->data, self->capacity + cstr_len);
-    if (!reallocated_data) return C_STR_ERROR_mem_allocation;
-
-    self->data = reallocated_data;
-    self->capacity += cstr_len;
-  }
+  c_str_error_t err = internal_c_str_grow(self, len + cstr_len + 1);
+  if (err.code != C_STR_ERROR_none.code) { return err; }
 
-  memmove(self->data + index + cstr_len, self->data + index,
-          self->len - index + 1);
-  memcpy(self->data + index, cstr, cstr_len);
-  self->len += cstr_len;
+  char* data = c_str_data(self);
+  memmove(data + index + cstr_len, data + index, len - index + 1);
+  memcpy(data + index, cstr, cstr_len);
+  self->len = len + cstr_len;
 
   return C_STR_ERROR_none;
 }
@@ -207,7 +474,7 @@ c_str_insert(CStr* self, char const cstr[], size_t cstr_len, size_t index)
 c_str_error_t
 c_str_remove(CStr* self, char const cstr[], size_t cstr_len)
 {
-  C_STR_CHECK_PARAMS(self && self->data);
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
   C_STR_CHECK_PARAMS(cstr);
   C_STR_CHECK_PARAMS(cstr_len > 0);
 
@@ -215,13 +482,16 @@ c_str_remove(CStr* self, char const cstr[], size_t cstr_len)
 
   char* substring_ptr = internal_c_str_find((CStr*)self, cstr, cstr_len);
   if (substring_ptr) {
+    char*        data = c_str_data(self);
+    size_t const len  = c_str_len(self) - cstr_len;
+
     memmove(substring_ptr, substring_ptr + cstr_len,
-            (self->data + self->len) - (substring_ptr + cstr_len));
-    *substring_ptr = '\0';
-    self->len -= cstr_len;
+            (data + len) - substring_ptr);
+    data[len] = '\0';
+    self->len = len;
 
-    if ((self->len > 0) && (self->len <= self->capacity / 4)) {
-      err = c_str_set_capacity(self, self->capacity / 2);
+    if ((len > 0) && (len <= c_str_capacity(self) / 4)) {
+      err = c_str_set_capacity(self, c_str_capacity(self) / 2);
     }
   }
 
@@ -231,20 +501,22 @@ c_str_remove(CStr* self, char const cstr[], size_t cstr_len)
 c_str_error_t
 c_str_remove_at(CStr* self, size_t index, size_t range, size_t* out_range_size)
 {
-  C_STR_CHECK_PARAMS(self && self->data);
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
 
-  if (index >= self->len) { return C_STR_ERROR_wrong_index; }
+  size_t len = c_str_len(self);
+  if (index >= len) { return C_STR_ERROR_wrong_index; }
 
-  if ((index + range) >= self->len) { range = self->len - index; }
+  if ((index + range) >= len) { range = len - index; }
 
   c_str_error_t err = C_STR_ERROR_none;
 
-  memmove(self->data + index, self->data + index + range,
-          self->len - index - range + 1);
-  self->len -= self->len - index - range - 1;
+  char* data = c_str_data(self);
+  memmove(data + index, data + index + range, len - index - range + 1);
+  len -= range;
+  self->len = len;
 
-  if ((self->len > 0) && (self->len <= self->capacity / 4)) {
-    err = c_str_set_capacity(self, self->capacity / 2);
+  if ((len > 0) && (len <= c_str_capacity(self) / 4)) {
+    err = c_str_set_capacity(self, c_str_capacity(self) / 2);
   }
 
   if (out_range_size) *out_range_size = range;
@@ -255,13 +527,13 @@ c_str_remove_at(CStr* self, size_t index, size_t range, size_t* out_range_size)
 c_str_error_t
 c_str_clone(CStr* self, CStr* out_cstr)
 {
-  return c_str_create(self->data, self->len, out_cstr);
+  return c_str_create(c_str_data(self), c_str_len(self), out_cstr);
 }
 
 c_str_error_t
 c_str_find(CStr* self, char const cstr[], size_t cstr_len, char* out_result[])
 {
-  C_STR_CHECK_PARAMS(self && self->data);
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
   C_STR_CHECK_PARAMS(cstr);
   C_STR_CHECK_PARAMS(cstr_len > 0);
 
@@ -279,10 +551,13 @@ c_str_replace(CStr*      self,
               char const with[],
               size_t     with_len)
 {
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
+  C_STR_CHECK_PARAMS(needle);
+
   char* found_str = internal_c_str_find((CStr*)self, needle, needle_len);
-  if (!found_str || needle_len == 0) { return C_STR_ERROR_needle_not_found; }
+  if (!found_str) { return C_STR_ERROR_needle_not_found; }
 
-  return c_str_replace_at(self, found_str - self->data, needle_len, with,
+  return c_str_replace_at(self, found_str - c_str_data(self), needle_len, with,
                           with_len);
 }
 
@@ -290,65 +565,178 @@ c_str_error_t
 c_str_replace_at(
     CStr* self, size_t index, size_t range, char const with[], size_t with_len)
 {
-  C_STR_CHECK_PARAMS(self && self->data);
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
   C_STR_CHECK_PARAMS(with);
   C_STR_CHECK_PARAMS(with_len > 0);
 
   c_str_error_t err = C_STR_ERROR_none;
 
-  if ((index + range) >= self->len) { range = self->len - index; }
+  size_t len = c_str_len(self);
+  if ((index + range) >= len) { range = len - index; }
+
+  err = internal_c_str_grow(self, len - range + with_len + 1);
+  if (err.code != C_STR_ERROR_none.code) { return err; }
 
-  if ((self->len - range + with_len + 1) > self->capacity) {
-    char* reallocated_data
-        = realloc(self->data, self->capacity - range + with_len);
-    if (!reallocated_data) return C_STR_ERROR_mem_allocation;
-    self->data = reallocated_data;
-    self->capacity += with_len - range;
+  char* data = c_str_data(self);
+  if (with_len != range) {
+    memmove(data + index + with_len, data + index + range,
+            len - index - range + 1);
+    len       = len - range + with_len;
+    self->len = len;
   }
 
-  if (with_len < range || with_len > range) {
-    memmove(self->data + index + with_len, self->data + index + range,
-            self->len - index - range + 1);
-    self->len -= range;
-    self->len += with_len;
+  memcpy(data + index, with, with_len);
+  data[len] = '\0';
 
-    if ((self->len > 0) && (self->len <= self->capacity / 4)) {
-      err = c_str_set_capacity(self, self->capacity / 2);
-    }
+  if ((len > 0) && (len <= c_str_capacity(self) / 4)) {
+    err = c_str_set_capacity(self, c_str_capacity(self) / 2);
   }
 
-  memcpy(self->data + index, with, with_len);
-  self->data[self->len] = '\0';
-
   return err;
 }
 
+c_str_error_t
+c_str_replace_all(CStr*      self,
+                  char const needle[],
+                  size_t     needle_len,
+                  char const with[],
+                  size_t     with_len,
+                  size_t*    out_count)
+{
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
+  C_STR_CHECK_PARAMS(needle);
+  C_STR_CHECK_PARAMS(needle_len > 0);
+  C_STR_CHECK_PARAMS(with || with_len == 0);
+
+  // first pass: count the occurrences to know the final length
+  size_t count  = 0;
+  size_t iter   = 0;
+  size_t offset = 0;
+  while (c_str_find_iter(self, needle, needle_len, &iter, &offset)) {
+    count++;
+  }
+
+  if (out_count) { *out_count = count; }
+  if (count == 0) { return C_STR_ERROR_needle_not_found; }
+
+  char*        data    = c_str_data(self);
+  size_t const len     = c_str_len(self);
+  size_t const new_len = len - (count * needle_len) + (count * with_len);
+
+  // second pass: when the string doesn't grow the result is compacted in
+  // place (the write position never passes the read position), otherwise it
+  // is built in a new buffer of the exact size. spare capacity doesn't
+  // matter, growing in place would overwrite bytes that weren't read yet
+  char* out = data;
+  if (new_len > len) {
+    out = malloc(new_len + 1);
+    if (!out) { return C_STR_ERROR_mem_allocation; }
+  }
+
+  size_t read  = 0;
+  size_t write = 0;
+  iter         = 0;
+  while (c_str_find_iter(self, needle, needle_len, &iter, &offset)) {
+    memmove(out + write, data + read, offset - read);
+    write += offset - read;
+    if (with_len > 0) { memcpy(out + write, with, with_len); }
+    write += with_len;
+    read = offset + needle_len;
+  }
+  memmove(out + write, data + read, len - read);
+  out[new_len] = '\0';
+
+  if (out != data) {
+    if (!internal_c_str_is_small(self)) { free(data); }
+    *self = (CStr){.data = out, .capacity = new_len + 1, .len = new_len};
+  } else {
+    self->len = new_len;
+  }
+
+  return C_STR_ERROR_none;
+}
+
+bool
+c_str_find_iter(CStr const* self,
+                char const  needle[],
+                size_t      needle_len,
+                size_t*     iter,
+                size_t*     out_offset)
+{
+  if (!self || !c_str_data(self) || !needle || !iter) { return false; }
+
+  char const*  data = c_str_data(self);
+  size_t const len  = c_str_len(self);
+  if (*iter >= len) { return false; }
+
+  char const* found
+      = internal_c_str_search(data + *iter, len - *iter, needle, needle_len);
+  if (!found) {
+    *iter = len;
+    return false;
+  }
+
+  size_t const offset = (size_t)(found - data);
+  *iter               = offset + needle_len;
+  if (out_offset) { *out_offset = offset; }
+
+  return true;
+}
+
+bool
+c_str_split_iter(CStr const* self,
+                 char const  separator[],
+                 size_t      separator_len,
+                 size_t*     iter,
+                 size_t*     out_offset,
+                 size_t*     out_len)
+{
+  if (!self || !c_str_data(self)) { return false; }
+
+  CStrView piece = {0};
+  if (!c_str_view_split_iter(c_str_view(self), separator, separator_len, iter,
+                             &piece)) {
+    return false;
+  }
+
+  if (out_offset) { *out_offset = (size_t)(piece.ptr - c_str_data(self)); }
+  if (out_len) { *out_len = piece.len; }
+
+  return true;
+}
+
 c_str_error_t
 c_str_append(CStr* str1, CStr const* str2)
 {
   C_STR_CHECK_PARAMS(str1);
-  C_STR_CHECK_PARAMS(str2 && str2->data);
+  C_STR_CHECK_PARAMS(str2 && c_str_data(str2));
+
+  // appending a string to itself: make room first, growing can move the
+  // bytes that are about to be appended
+  if (str1 == str2) {
+    c_str_error_t err = c_str_reserve(str1, c_str_len(str1) * 2);
+    if (err.code != C_STR_ERROR_none.code) { return err; }
+  }
 
-  return c_str_append_with_cstr(str1, str2->data, str2->len);
+  return c_str_append_with_cstr(str1, c_str_data(str2), c_str_len(str2));
 }
 
 c_str_error_t
 c_str_append_with_cstr(CStr* str1, char const cstr[], size_t cstr_len)
 {
-  C_STR_CHECK_PARAMS(str1 && str1->data);
+  C_STR_CHECK_PARAMS(str1 && c_str_data(str1));
   C_STR_CHECK_PARAMS(cstr);
   C_STR_CHECK_PARAMS(cstr_len > 0);
 
-  if ((str1->len + cstr_len + 1) > str1->capacity) {
-    char* reallocated_data = realloc(str1->data, str1->capacity + cstr_len);
-    if (!reallocated_data) return C_STR_ERROR_mem_allocation;
-    str1->data = reallocated_data;
-    str1->capacity += cstr_len;
-  }
+  size_t const len = c_str_len(str1);
 
-  memcpy(str1->data + str1->len, cstr, cstr_len);
-  str1->len += cstr_len;
-  str1->data[str1->len] = '\0';
+  c_str_error_t err = internal_c_str_grow(str1, len + cstr_len + 1);
+  if (err.code != C_STR_ERROR_none.code) { return err; }
+
+  char* data = c_str_data(str1);
+  memcpy(data + len, cstr, cstr_len);
+  data[len + cstr_len] = '\0';
+  str1->len            = len + cstr_len;
 
   return C_STR_ERROR_none;
 }
@@ -356,22 +744,73 @@ c_str_append_with_cstr(CStr* str1, char const cstr[], size_t cstr_len)
 c_str_error_t
 c_str_utf8_valid(CStr* self, bool* out_is_valid)
 {
-  C_STR_CHECK_PARAMS(self && self->data);
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
 
-  if (out_is_valid) {
-    size_t codepoint_len = 0;
-    for (size_t iii = 0; iii < self->len; iii += codepoint_len) {
-      c_str_error_t err
-          = c_str_utf8_next_codepoint(self, codepoint_len, &codepoint_len);
-      if (err.code != 0) {
-        *out_is_valid = false;
-        return C_STR_ERROR_none;
-      }
-    }
+  if (!out_is_valid) { return C_STR_ERROR_none; }
+
+  unsigned char const* data = (unsigned char const*)c_str_data(self);
+  size_t const         len  = c_str_len(self);
+  size_t               iii  = 0;
 
-    *out_is_valid = true;
+#if defined(C_STR_SSSE3)
+  // the whole blocks, the loop below picks up from the codepoint the last
+  // one cut
+  if (!internal_c_str_utf8_valid_blocks(data, len, &iii)) {
+    *out_is_valid = false;
     return C_STR_ERROR_none;
   }
+#endif
+
+  while (iii < len) {
+    if (data[iii] < 0x80) {
+      iii += internal_c_str_ascii_len(data + iii, len - iii);
+      continue;
+    }
+
+    size_t const codepoint_size
+        = internal_c_str_utf8_decode(data + iii, len - iii, NULL, NULL);
+    if (codepoint_size == 0) {
+      *out_is_valid = false;
+      return C_STR_ERROR_none;
+    }
+    iii += codepoint_size;
+  }
+
+  *out_is_valid = true;
+  return C_STR_ERROR_none;
+}
+
+c_str_error_t
+c_str_utf8_count(CStr* self, size_t* out_count)
+{
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
+
+  if (!out_count) { return C_STR_ERROR_none; }
+
+  unsigned char const* data = (unsigned char const*)c_str_data(self);
+  size_t const         len  = c_str_len(self);
+
+  // every codepoint has exactly one byte that isn't a continuation byte
+  // (10xxxxxx), so count those
+  size_t continuations = 0;
+  size_t iii           = 0;
+
+#if defined(C_STR_SSE2)
+  {
+    // 0x80..0xBF are the only bytes below 0xC0 as signed chars
+    __m128i const first_lead = _mm_set1_epi8((char)0xC0);
+    for (; iii + 16 <= len; iii += 16) {
+      __m128i const block = _mm_loadu_si128((__m128i const*)(data + iii));
+      uint32_t const mask
+          = (uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(block, first_lead));
+      continuations += internal_c_str_popcount(mask);
+    }
+  }
+#endif
+
+  for (; iii < len; ++iii) { continuations += (data[iii] & 0xC0) == 0x80; }
+
+  *out_count = len - continuations;
 
   return C_STR_ERROR_none;
 }
@@ -379,53 +818,239 @@ c_str_utf8_valid(CStr* self, bool* out_is_valid)
 c_str_error_t
 c_str_utf8_next_codepoint(CStr* self, size_t index, size_t* out_next_cp_index)
 {
-  C_STR_CHECK_PARAMS(self && self->data && self->len > 0);
-
-  if (index >= self->len) { return C_STR_ERROR_wrong_index; }
-
-  // Determine the number of bytes in the current character
-  size_t        codepoint_size = 0;
-  unsigned char ch             = self->data[index];
-  if ((ch & 0x80) == 0) {
-    // Single byte character
-    codepoint_size = 1;
-  } else if ((ch & 0xE0) == 0xC0) {
-    // Two byte character
-    codepoint_size = 2;
-  } else if ((ch & 0xF0) == 0xE0) {
-    // Three byte character
-    codepoint_size = 3;
-  } else if ((ch & 0xF8) == 0xF0) {
-    // Four byte character
-    codepoint_size = 4;
-  }
-  // else if ((ch & 0xFC) == 0xF8)
-  //   {
-  //     // Five byte character (should not occur in valid UTF-8)
-  //     codepoint_size = 5;
-  //   }
-  // else if ((ch & 0xFE) == 0xFC)
-  //   {
-  //     // Six byte character (should not occur in valid UTF-8)
-  //     codepoint_size = 6;
-  //   }
-  else {
+  C_STR_CHECK_PARAMS(self && c_str_data(self) && c_str_len(self) > 0);
+
+  size_t const len = c_str_len(self);
+  if (index >= len) { return C_STR_ERROR_wrong_index; }
+
+  size_t const codepoint_size = internal_c_str_utf8_decode(
+      (unsigned char const*)c_str_data(self) + index, len - index, NULL, NULL);
+  if (codepoint_size == 0) {
     // Invalid UTF-8 sequence
     if (out_next_cp_index) { *out_next_cp_index = 1; }
     return C_STR_ERROR_invalid_utf8;
   }
 
-  // Extract the remaining bytes of the character
-  for (size_t iii = 1; iii < codepoint_size; ++iii) {
-    if (((unsigned char)(self->data[iii]) & 0xC0) != 0x80) {
-      // Invalid UTF-8 sequence
-      if (out_next_cp_index) { *out_next_cp_index = 1; }
-      return C_STR_ERROR_invalid_utf8;
+  if (out_next_cp_index) { *out_next_cp_index = codepoint_size; }
+  return C_STR_ERROR_none;
+}
+
+c_str_error_t
+c_str_utf8_to_utf16(char const src[],
+                    size_t     src_len,
+                    uint16_t   out[],
+                    size_t     out_capacity,
+                    size_t*    out_len,
+                    size_t*    out_consumed)
+{
+  C_STR_CHECK_PARAMS(src || src_len == 0);
+  C_STR_CHECK_PARAMS(out_len);
+
+  unsigned char const* bytes   = (unsigned char const*)src;
+  c_str_error_t        err     = C_STR_ERROR_none;
+  size_t               read    = 0;
+  size_t               written = 0;
+
+  while (read < src_len) {
+    // ascii runs are found 16 bytes at a time and widened in one loop
+    size_t ascii_len = internal_c_str_ascii_len(bytes + read, src_len - read);
+    if (ascii_len > 0) {
+      if (out) {
+        if (ascii_len > out_capacity - written) {
+          ascii_len = out_capacity - written;
+          err       = C_STR_ERROR_buffer_too_small;
+        }
+        for (size_t iii = 0; iii < ascii_len; ++iii) {
+          out[written + iii] = bytes[read + iii];
+        }
+      }
+      read += ascii_len;
+      written += ascii_len;
+      if (err.code != C_STR_ERROR_none.code) { break; }
+      continue;
+    }
+
+    uint32_t     codepoint = 0;
+    bool         truncated = false;
+    size_t const size      = internal_c_str_utf8_decode(
+        bytes + read, src_len - read, &codepoint, &truncated);
+    if (size == 0) {
+      if (!truncated || !out_consumed) { err = C_STR_ERROR_invalid_utf8; }
+      break;
+    }
+
+    size_t const units = (codepoint >= 0x10000) ? 2 : 1;
+    if (out) {
+      if (units > out_capacity - written) {
+        err = C_STR_ERROR_buffer_too_small;
+        break;
+      }
+      if (units == 2) {
+        codepoint -= 0x10000;
+        out[written]     = (uint16_t)(0xD800 | (codepoint >> 10));
+        out[written + 1] = (uint16_t)(0xDC00 | (codepoint & 0x3FF));
+      } else {
+        out[written] = (uint16_t)codepoint;
+      }
+    }
+    read += size;
+    written += units;
+  }
+
+  *out_len = written;
+  if (out_consumed) { *out_consumed = read; }
+
+  return err;
+}
+
+c_str_error_t
+c_str_utf16_to_utf8(uint16_t const src[],
+                    size_t         src_len,
+                    char           out[],
+                    size_t         out_capacity,
+                    size_t*        out_len,
+                    size_t*        out_consumed)
+{
+  C_STR_CHECK_PARAMS(src || src_len == 0);
+  C_STR_CHECK_PARAMS(out_len);
+
+  c_str_error_t err     = C_STR_ERROR_none;
+  size_t        read    = 0;
+  size_t        written = 0;
+
+  while (read < src_len) {
+    size_t ascii_len
+        = internal_c_str_utf16_ascii_len(src + read, src_len - read);
+    if (ascii_len > 0) {
+      if (out) {
+        if (ascii_len > out_capacity - written) {
+          ascii_len = out_capacity - written;
+          err       = C_STR_ERROR_buffer_too_small;
+        }
+        for (size_t iii = 0; iii < ascii_len; ++iii) {
+          out[written + iii] = (char)src[read + iii];
+        }
+      }
+      read += ascii_len;
+      written += ascii_len;
+      if (err.code != C_STR_ERROR_none.code) { break; }
+      continue;
+    }
+
+    uint32_t codepoint = src[read];
+    size_t   units     = 1;
+    if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+      // a high surrogate at the end may get its pair with the next chunk
+      if (read + 1 >= src_len) {
+        if (!out_consumed) { err = C_STR_ERROR_invalid_utf16; }
+        break;
+      }
+      if (src[read + 1] < 0xDC00 || src[read + 1] > 0xDFFF) {
+        err = C_STR_ERROR_invalid_utf16;
+        break;
+      }
+      codepoint
+          = 0x10000 + ((codepoint - 0xD800) << 10) + (src[read + 1] - 0xDC00);
+      units = 2;
+    } else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+      err = C_STR_ERROR_invalid_utf16;
+      break;
+    }
+
+    size_t const size = (codepoint < 0x800) ? 2 : (codepoint < 0x10000) ? 3 : 4;
+    if (out) {
+      if (size > out_capacity - written) {
+        err = C_STR_ERROR_buffer_too_small;
+        break;
+      }
+
+      unsigned char* bytes = (unsigned char*)out + written;
+      switch (size) {
+      case 2:
+        bytes[0] = (unsigned char)(0xC0 | (codepoint >> 6));
+        bytes[1] = (unsigned char)(0x80 | (codepoint & 0x3F));
+        break;
+      case 3:
+        bytes[0] = (unsigned char)(0xE0 | (codepoint >> 12));
+        bytes[1] = (unsigned char)(0x80 | ((codepoint >> 6) & 0x3F));
+        bytes[2] = (unsigned char)(0x80 | (codepoint & 0x3F));
+        break;
+      default:
+        bytes[0] = (unsigned char)(0xF0 | (codepoint >> 18));
+        bytes[1] = (unsigned char)(0x80 | ((codepoint >> 12) & 0x3F));
+        bytes[2] = (unsigned char)(0x80 | ((codepoint >> 6) & 0x3F));
+        bytes[3] = (unsigned char)(0x80 | (codepoint & 0x3F));
+        break;
+      }
     }
+    read += units;
+    written += size;
   }
 
-  if (out_next_cp_index) { *out_next_cp_index = codepoint_size; }
-  return C_STR_ERROR_none;
+  *out_len = written;
+  if (out_consumed) { *out_consumed = read; }
+
+  return err;
+}
+
+c_str_error_t
+c_str_utf8_to_utf32(char const src[],
+                    size_t     src_len,
+                    uint32_t   out[],
+                    size_t     out_capacity,
+                    size_t*    out_len,
+                    size_t*    out_consumed)
+{
+  C_STR_CHECK_PARAMS(src || src_len == 0);
+  C_STR_CHECK_PARAMS(out_len);
+
+  unsigned char const* bytes   = (unsigned char const*)src;
+  c_str_error_t        err     = C_STR_ERROR_none;
+  size_t               read    = 0;
+  size_t               written = 0;
+
+  while (read < src_len) {
+    size_t ascii_len = internal_c_str_ascii_len(bytes + read, src_len - read);
+    if (ascii_len > 0) {
+      if (out) {
+        if (ascii_len > out_capacity - written) {
+          ascii_len = out_capacity - written;
+          err       = C_STR_ERROR_buffer_too_small;
+        }
+        for (size_t iii = 0; iii < ascii_len; ++iii) {
+          out[written + iii] = bytes[read + iii];
+        }
+      }
+      read += ascii_len;
+      written += ascii_len;
+      if (err.code != C_STR_ERROR_none.code) { break; }
+      continue;
+    }
+
+    uint32_t     codepoint = 0;
+    bool         truncated = false;
+    size_t const size      = internal_c_str_utf8_decode(
+        bytes + read, src_len - read, &codepoint, &truncated);
+    if (size == 0) {
+      if (!truncated || !out_consumed) { err = C_STR_ERROR_invalid_utf8; }
+      break;
+    }
+
+    if (out) {
+      if (written == out_capacity) {
+        err = C_STR_ERROR_buffer_too_small;
+        break;
+      }
+      out[written] = codepoint;
+    }
+    read += size;
+    written++;
+  }
+
+  *out_len = written;
+  if (out_consumed) { *out_consumed = read; }
+
+  return err;
 }
 
 c_str_error_t
@@ -444,35 +1069,39 @@ c_str_error_t
 c_str_format_va(
     CStr* self, size_t index, size_t format_len, char const* format, va_list va)
 {
-  C_STR_CHECK_PARAMS(self && self->data);
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
   C_STR_CHECK_PARAMS(format);
   C_STR_CHECK_PARAMS(format_len > 0);
 
-  if (index > self->len) { return C_STR_ERROR_wrong_index; }
+  if (index > c_str_len(self)) { return C_STR_ERROR_wrong_index; }
 
   errno = 0;
   va_list va_tmp;
   va_copy(va_tmp, va);
   int needed_len = vsnprintf(NULL, 0, format, va_tmp);
+  va_end(va_tmp);
   if (needed_len < 0) { return (c_str_error_t){errno, strerror(errno)}; }
 
-  if ((size_t)needed_len >= self->capacity - index) {
-    c_str_error_t err
-        = c_str_set_capacity(self, self->capacity + needed_len + 1);
-    if (err.code != C_STR_ERROR_none.code) return err;
-  }
+  c_str_error_t err = internal_c_str_grow(self, index + needed_len + 1);
+  if (err.code != C_STR_ERROR_none.code) { return err; }
 
-  errno = 0;
-  needed_len
-      = vsnprintf(self->data + index, self->capacity - index, format, va);
+  errno      = 0;
+  needed_len = vsnprintf(c_str_data(self) + index,
+                         c_str_capacity(self) - index, format, va);
   if (needed_len < 0) { return (c_str_error_t){errno, strerror(errno)}; }
 
-  self->len += needed_len;
-  self->data[self->len] = '\0';
+  // vsnprintf terminated the string right after the formatted text
+  self->len = index + needed_len;
 
   return C_STR_ERROR_none;
 }
 
+char*
+c_str_data(CStr const* self)
+{
+  return self->data;
+}
+
 size_t
 c_str_len(CStr const* self)
 {
@@ -484,7 +1113,7 @@ c_str_set_len(CStr* self, size_t len)
 {
   C_STR_CHECK_PARAMS(self);
 
-  if (self->len < len) { return c_str_set_capacity(self, len + 1); }
+  if (c_str_len(self) < len) { return c_str_set_capacity(self, len + 1); }
 
   self->len = len;
   return C_STR_ERROR_none;
@@ -500,16 +1129,78 @@ c_str_error_t
 c_str_set_capacity(CStr* self, size_t capacity)
 {
   C_STR_CHECK_PARAMS(self);
+  C_STR_CHECK_PARAMS(capacity > 0);
+
+  char*  data = c_str_data(self);
+  size_t len  = c_str_len(self);
+
+  // whatever doesn't fit (the NUL included) is cut
+  if (len >= capacity) { len = capacity - 1; }
+
+#ifdef C_STR_ENABLE_SSO
+  if (capacity <= C_STR_SSO_CAPACITY) {
+    // move a heap string back into the struct
+    if (!internal_c_str_is_small(self)) {
+      if (data) {
+        memcpy(self->inline_data, data, len);
+        free(data);
+      }
+      self->data     = self->inline_data;
+      self->capacity = C_STR_SSO_CAPACITY;
+    }
+
+    self->data[len] = '\0';
+    self->len       = len;
+
+    return C_STR_ERROR_none;
+  }
+
+  if (internal_c_str_is_small(self)) {
+    char* heap_data = malloc(capacity);
+    if (!heap_data) { return C_STR_ERROR_mem_allocation; }
 
-  char* reallocated_data = realloc(self->data, capacity);
+    memcpy(heap_data, data, len);
+    heap_data[len] = '\0';
+    *self = (CStr){.data = heap_data, .capacity = capacity, .len = len};
+
+    return C_STR_ERROR_none;
+  }
+#endif
+
+  char* reallocated_data = realloc(data, capacity);
   if (!reallocated_data) { return C_STR_ERROR_mem_allocation; }
 
-  self->data     = reallocated_data;
-  self->capacity = capacity;
+  reallocated_data[len] = '\0';
+  self->data            = reallocated_data;
+  self->capacity        = capacity;
+  self->len             = len;
 
   return C_STR_ERROR_none;
 }
 
+c_str_error_t
+c_str_reserve(CStr* self, size_t len)
+{
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
+
+  if (len + 1 <= c_str_capacity(self)) { return C_STR_ERROR_none; }
+
+  return c_str_set_capacity(self, len + 1);
+}
+
+c_str_error_t
+c_str_shrink_to_fit(CStr* self)
+{
+  C_STR_CHECK_PARAMS(self && c_str_data(self));
+
+  if (internal_c_str_is_small(self)
+      || c_str_len(self) + 1 == c_str_capacity(self)) {
+    return C_STR_ERROR_none;
+  }
+
+  return c_str_set_capacity(self, c_str_len(self) + 1);
+}
+
 char const*
 c_str_get_whitespaces(void)
 {
@@ -519,88 +1210,821 @@ c_str_get_whitespaces(void)
 void
 c_str_destroy(CStr* self)
 {
-  if (self && self->data) {
-    free(self->data);
-    *self = (CStr){0};
-  }
+  if (!self) { return; }
+
+  if (!internal_c_str_is_small(self)) { free(self->data); }
+  *self = (CStr){0};
 }
 
-/* ------------------------- internal ------------------------- */
-char*
-internal_c_str_find(CStr* self, char const cstr[], size_t cstr_len)
+CStrView
+c_str_view(CStr const* self)
 {
-  if (cstr) {
-    for (size_t c_str_counter = 0; c_str_counter < self->len; ++c_str_counter) {
-      if (memcmp(&(self->data)[c_str_counter], cstr, cstr_len) == 0) {
-        return &(self->data)[c_str_counter];
-      }
-    }
-  }
+  return (CStrView){.ptr = c_str_data(self), .len = c_str_len(self)};
+}
 
-  return NULL;
+CStrView
+c_str_view_from_cstr(char const cstr[], size_t cstr_len)
+{
+  return (CStrView){.ptr = cstr, .len = cstr ? cstr_len : 0};
 }
 
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
+c_str_error_t
+c_str_view_slice(CStrView self, size_t index, size_t len, CStrView* out_view)
+{
+  if (index > self.len) { return C_STR_ERROR_wrong_index; }
 
-#undef CSTDLIB_STR_IMPLEMENTATION
-#endif /* CSTDLIB_STR_IMPLEMENTATION */
+  if (len > self.len - index) { len = self.len - index; }
 
-/* ------------------------------------------------------------------------ */
-/* -------------------------------- tests --------------------------------- */
-/* ------------------------------------------------------------------------ */
+  if (out_view) { *out_view = (CStrView){.ptr = self.ptr + index, .len = len}; }
 
-#ifdef CSTDLIB_STR_UNIT_TESTS
-#ifdef NDEBUG
-#define NDEBUG_
-#undef NDEBUG
-#endif
+  return C_STR_ERROR_none;
+}
 
-#ifdef _MSC_VER
-#pragma warning(push)
-#pragma warning(disable : 4996) // disable warning about unsafe functions
-#endif
+CStrView
+c_str_view_trim(CStrView self)
+{
+  return c_str_view_trim_right(c_str_view_trim_left(self));
+}
 
-#include <assert.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+CStrView
+c_str_view_trim_left(CStrView self)
+{
+  char const* whitespaces = c_str_get_whitespaces();
 
-#define STR(str) str, (sizeof(str) - 1)
-#define STR_INV(str) (sizeof(str) - 1), str
-#define STR_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
-#define STR_TEST(err)                                                          \
-  (err.code != C_STR_ERROR_none.code) ? STR_TEST_PRINT_ABORT(err.desc) : (void)0
-#define STR_ASSERT(cond) (!(cond)) ? STR_TEST_PRINT_ABORT(#cond) : (void)0
+  while (self.len > 0 && self.ptr[0] && strchr(whitespaces, self.ptr[0])) {
+    self.ptr++;
+    self.len--;
+  }
+
+  return self;
+}
+
+CStrView
+c_str_view_trim_right(CStrView self)
+{
+  char const* whitespaces = c_str_get_whitespaces();
+
+  while (self.len > 0 && self.ptr[self.len - 1]
+         && strchr(whitespaces, self.ptr[self.len - 1])) {
+    self.len--;
+  }
+
+  return self;
+}
 
 int
-main(void)
+c_str_view_compare(CStrView self, CStrView other)
 {
-  c_str_error_t err = C_STR_ERROR_none;
+  size_t const min_len = self.len < other.len ? self.len : other.len;
 
-  /* test: create, remove, append */
-  {
-    CStr str;
-    err = c_str_create(STR("Ahmed is here"), &str);
-    STR_TEST(err);
+  int const result = min_len > 0 ? memcmp(self.ptr, other.ptr, min_len) : 0;
+  if (result != 0) { return result; }
 
-    err = c_str_remove(&str, STR("here"));
-    STR_TEST(err);
+  return (self.len > other.len) - (self.len < other.len);
+}
 
-    STR_ASSERT(strncmp(str.data, STR("Ahmed is ")) == 0);
+bool
+c_str_view_equal(CStrView self, CStrView other)
+{
+  return self.len == other.len
+         && (self.len == 0 || memcmp(self.ptr, other.ptr, self.len) == 0);
+}
 
-    err = c_str_append_with_cstr(&str, STR("here"));
-    STR_TEST(err);
-    STR_ASSERT(strncmp(str.data, STR("Ahmed is here")) == 0);
+size_t
+c_str_view_hash(CStrView self)
+{
+  uint64_t hash = 14695981039346656037U; // FNV offset basis
 
-    c_str_destroy(&str);
+  for (size_t iii = 0; iii < self.len; ++iii) {
+    hash ^= (unsigned char)self.ptr[iii];
+    hash *= 1099511628211U; // FNV prime
   }
 
-  /* test: empty string */
-  {
-    CStr str;
-    err = c_str_create(STR(""), &str);
+  return (size_t)hash;
+}
+
+bool
+c_str_view_find(CStrView self, CStrView needle, size_t* out_offset)
+{
+  if (!self.ptr || !needle.ptr) { return false; }
+
+  char const* found
+      = internal_c_str_search(self.ptr, self.len, needle.ptr, needle.len);
+  if (!found) { return false; }
+
+  if (out_offset) { *out_offset = (size_t)(found - self.ptr); }
+
+  return true;
+}
+
+bool
+c_str_view_split_iter(CStrView   self,
+                      char const separator[],
+                      size_t     separator_len,
+                      size_t*    iter,
+                      CStrView*  out_piece)
+{
+  // `*iter == len + 1` marks that the last piece was already yielded
+  if (!self.ptr || !separator || !iter || *iter > self.len) { return false; }
+
+  size_t const start = *iter;
+  char const*  found = internal_c_str_search(self.ptr + start, self.len - start,
+                                             separator, separator_len);
+
+  size_t const end = found ? (size_t)(found - self.ptr) : self.len;
+  *iter            = found ? end + separator_len : self.len + 1;
+
+  if (out_piece) {
+    *out_piece = (CStrView){.ptr = self.ptr + start, .len = end - start};
+  }
+
+  return true;
+}
+
+/* ------------------------- internal ------------------------- */
+bool
+internal_c_str_is_small(CStr const* self)
+{
+#ifdef C_STR_ENABLE_SSO
+  return self->data == self->inline_data;
+#else
+  (void)self;
+  return false;
+#endif
+}
+
+c_str_error_t
+internal_c_str_grow(CStr* self, size_t min_capacity)
+{
+  if (min_capacity <= c_str_capacity(self)) { return C_STR_ERROR_none; }
+
+  // grow geometrically so n appends cost O(n) copies in total and only
+  // O(log n) reallocs
+  size_t new_capacity = c_str_capacity(self) * 2;
+  if (new_capacity < C_STR_MIN_CAPACITY) { new_capacity = C_STR_MIN_CAPACITY; }
+  if (new_capacity < min_capacity) { new_capacity = min_capacity; }
+
+  return c_str_set_capacity(self, new_capacity);
+}
+
+char*
+internal_c_str_find(CStr* self, char const cstr[], size_t cstr_len)
+{
+  if (!cstr || cstr_len == 0) { return NULL; }
+
+  return (char*)internal_c_str_search(c_str_data(self), c_str_len(self), cstr,
+                                      cstr_len);
+}
+
+char const*
+internal_c_str_search(char const* haystack,
+                      size_t      haystack_len,
+                      char const* needle,
+                      size_t      needle_len)
+{
+  if (needle_len == 0 || needle_len > haystack_len) { return NULL; }
+
+  if (needle_len == 1) { return memchr(haystack, *needle, haystack_len); }
+
+  if (needle_len >= C_STR_HORSPOOL_MIN_LEN) {
+    return internal_c_str_search_horspool(haystack, haystack_len, needle,
+                                          needle_len);
+  }
+
+  return internal_c_str_search_short(haystack, haystack_len, needle,
+                                     needle_len);
+}
+
+char const*
+internal_c_str_search_short(char const* haystack,
+                            size_t      haystack_len,
+                            char const* needle,
+                            size_t      needle_len)
+{
+  // `pos` is the first candidate offset that wasn't checked yet, a match can
+  // start at any offset up to `last_pos`
+  size_t const last_pos = haystack_len - needle_len;
+  size_t       pos      = 0;
+
+#if defined(C_STR_AVX2)
+  {
+    __m256i const first = _mm256_set1_epi8(needle[0]);
+    __m256i const last  = _mm256_set1_epi8(needle[needle_len - 1]);
+
+    // both loads have to stay inside the haystack
+    for (; pos + 32 <= last_pos + 1; pos += 32) {
+      __m256i const block_first
+          = _mm256_loadu_si256((__m256i const*)(haystack + pos));
+      __m256i const block_last = _mm256_loadu_si256(
+          (__m256i const*)(haystack + pos + needle_len - 1));
+
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+          _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                           _mm256_cmpeq_epi8(last, block_last)));
+      while (mask) {
+        size_t const candidate = pos + internal_c_str_ctz(mask);
+        if (memcmp(haystack + candidate + 1, needle + 1, needle_len - 2)
+            == 0) {
+          return haystack + candidate;
+        }
+        mask &= mask - 1;
+      }
+    }
+  }
+#endif
+
+#if defined(C_STR_SSE2)
+  {
+    __m128i const first = _mm_set1_epi8(needle[0]);
+    __m128i const last  = _mm_set1_epi8(needle[needle_len - 1]);
+
+    for (; pos + 16 <= last_pos + 1; pos += 16) {
+      __m128i const block_first
+          = _mm_loadu_si128((__m128i const*)(haystack + pos));
+      __m128i const block_last
+          = _mm_loadu_si128((__m128i const*)(haystack + pos + needle_len - 1));
+
+      uint32_t mask = (uint32_t)_mm_movemask_epi8(
+          _mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                        _mm_cmpeq_epi8(last, block_last)));
+      while (mask) {
+        size_t const candidate = pos + internal_c_str_ctz(mask);
+        if (memcmp(haystack + candidate + 1, needle + 1, needle_len - 2)
+            == 0) {
+          return haystack + candidate;
+        }
+        mask &= mask - 1;
+      }
+    }
+  }
+#endif
+
+  // the tail (or everything without SIMD): jump between occurrences of the
+  // first byte with memchr, then check the last byte before the middle
+  while (pos <= last_pos) {
+    char const* candidate
+        = memchr(haystack + pos, needle[0], last_pos - pos + 1);
+    if (!candidate) { return NULL; }
+
+    if (candidate[needle_len - 1] == needle[needle_len - 1]
+        && memcmp(candidate + 1, needle + 1, needle_len - 2) == 0) {
+      return candidate;
+    }
+
+    pos = (size_t)(candidate - haystack) + 1;
+  }
+
+  return NULL;
+}
+
+char const*
+internal_c_str_search_horspool(char const* haystack,
+                               size_t      haystack_len,
+                               char const* needle,
+                               size_t      needle_len)
+{
+  // how far the window can move when its last byte is `byte`
+  size_t skip[256];
+  for (size_t iii = 0; iii < 256; ++iii) { skip[iii] = needle_len; }
+  for (size_t iii = 0; iii < needle_len - 1; ++iii) {
+    skip[(unsigned char)needle[iii]] = needle_len - 1 - iii;
+  }
+
+  unsigned char const last_byte = (unsigned char)needle[needle_len - 1];
+  size_t const        last_pos  = haystack_len - needle_len;
+
+  for (size_t pos = 0; pos <= last_pos;) {
+    unsigned char const byte = (unsigned char)haystack[pos + needle_len - 1];
+    if (byte == last_byte
+        && memcmp(haystack + pos, needle, needle_len - 1) == 0) {
+      return haystack + pos;
+    }
+    pos += skip[byte];
+  }
+
+  return NULL;
+}
+
+size_t
+internal_c_str_ctz(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (size_t)__builtin_ctz(mask);
+#elif defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return index;
+#else
+  size_t index = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+size_t
+internal_c_str_popcount(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (size_t)__builtin_popcount(mask);
+#else
+  size_t count = 0;
+  for (; mask; mask &= mask - 1) { count++; }
+  return count;
+#endif
+}
+
+size_t
+internal_c_str_ascii_len(unsigned char const* data, size_t len)
+{
+  size_t iii = 0;
+
+#if defined(C_STR_SSE2)
+  for (; iii + 16 <= len; iii += 16) {
+    uint32_t const mask = (uint32_t)_mm_movemask_epi8(
+        _mm_loadu_si128((__m128i const*)(data + iii)));
+    if (mask) { return iii + internal_c_str_ctz(mask); }
+  }
+#else
+  for (; iii + 8 <= len; iii += 8) {
+    uint64_t word;
+    memcpy(&word, data + iii, sizeof(word));
+    if (word & 0x8080808080808080U) { break; }
+  }
+#endif
+
+  while (iii < len && data[iii] < 0x80) { iii++; }
+
+  return iii;
+}
+
+#if defined(C_STR_SSSE3)
+// Keiser and Lemire's lookup tables ("Validating UTF-8 In Less Than One
+// Instruction Per Byte"), each bit is an error a pair of bytes can have. the
+// high and low nibble of the first byte and the high nibble of the second
+// one each pick the errors they allow, the pair is bad when all three agree
+#define C_STR_UTF8_TOO_SHORT      0x01 // lead byte, then no continuation
+#define C_STR_UTF8_TOO_LONG       0x02 // ascii, then a continuation
+#define C_STR_UTF8_OVERLONG_3     0x04 // E0 80..9F
+#define C_STR_UTF8_TOO_LARGE      0x08 // F4 90..BF, F5..FF 90..BF
+#define C_STR_UTF8_SURROGATE      0x10 // ED A0..BF
+#define C_STR_UTF8_OVERLONG_2     0x20 // C0..C1 80..BF
+#define C_STR_UTF8_TOO_LARGE_1000 0x40 // F5..FF 80..8F
+#define C_STR_UTF8_OVERLONG_4     0x40 // F0 80..8F
+#define C_STR_UTF8_TWO_CONTS      0x80 // fine in the middle of a sequence
+#define C_STR_UTF8_CARRY                                                       \
+  (C_STR_UTF8_TOO_SHORT | C_STR_UTF8_TOO_LONG | C_STR_UTF8_TWO_CONTS)
+
+static unsigned char const internal_c_str_utf8_byte_1_high[16] = {
+    // 0_______: ascii
+    C_STR_UTF8_TOO_LONG,
+    C_STR_UTF8_TOO_LONG,
+    C_STR_UTF8_TOO_LONG,
+    C_STR_UTF8_TOO_LONG,
+    C_STR_UTF8_TOO_LONG,
+    C_STR_UTF8_TOO_LONG,
+    C_STR_UTF8_TOO_LONG,
+    C_STR_UTF8_TOO_LONG,
+    // 10______: continuation
+    C_STR_UTF8_TWO_CONTS,
+    C_STR_UTF8_TWO_CONTS,
+    C_STR_UTF8_TWO_CONTS,
+    C_STR_UTF8_TWO_CONTS,
+    // 1100____, 1101____: 2 byte lead
+    C_STR_UTF8_TOO_SHORT | C_STR_UTF8_OVERLONG_2,
+    C_STR_UTF8_TOO_SHORT,
+    // 1110____: 3 byte lead
+    C_STR_UTF8_TOO_SHORT | C_STR_UTF8_OVERLONG_3 | C_STR_UTF8_SURROGATE,
+    // 1111____: 4 byte lead
+    C_STR_UTF8_TOO_SHORT | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000
+        | C_STR_UTF8_OVERLONG_4,
+};
+
+static unsigned char const internal_c_str_utf8_byte_1_low[16] = {
+    // ____0000, ____0001
+    C_STR_UTF8_CARRY | C_STR_UTF8_OVERLONG_3 | C_STR_UTF8_OVERLONG_2
+        | C_STR_UTF8_OVERLONG_4,
+    C_STR_UTF8_CARRY | C_STR_UTF8_OVERLONG_2,
+    // ____001_
+    C_STR_UTF8_CARRY,
+    C_STR_UTF8_CARRY,
+    // ____0100
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE,
+    // ____0101 .. ____1111, ____1101 is also ED
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000
+        | C_STR_UTF8_SURROGATE,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+    C_STR_UTF8_CARRY | C_STR_UTF8_TOO_LARGE | C_STR_UTF8_TOO_LARGE_1000,
+};
+
+static unsigned char const internal_c_str_utf8_byte_2_high[16] = {
+    // 0_______: ascii
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    // 1000____
+    C_STR_UTF8_TOO_LONG | C_STR_UTF8_OVERLONG_2 | C_STR_UTF8_TWO_CONTS
+        | C_STR_UTF8_OVERLONG_3 | C_STR_UTF8_TOO_LARGE_1000
+        | C_STR_UTF8_OVERLONG_4,
+    // 1001____
+    C_STR_UTF8_TOO_LONG | C_STR_UTF8_OVERLONG_2 | C_STR_UTF8_TWO_CONTS
+        | C_STR_UTF8_OVERLONG_3 | C_STR_UTF8_TOO_LARGE,
+    // 101_____
+    C_STR_UTF8_TOO_LONG | C_STR_UTF8_OVERLONG_2 | C_STR_UTF8_TWO_CONTS
+        | C_STR_UTF8_SURROGATE | C_STR_UTF8_TOO_LARGE,
+    C_STR_UTF8_TOO_LONG | C_STR_UTF8_OVERLONG_2 | C_STR_UTF8_TWO_CONTS
+        | C_STR_UTF8_SURROGATE | C_STR_UTF8_TOO_LARGE,
+    // 11______: lead byte
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+    C_STR_UTF8_TOO_SHORT,
+};
+
+// a block whose last bytes are above these ends in the middle of a sequence
+static unsigned char const internal_c_str_utf8_max[32] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1,
+};
+
+bool
+internal_c_str_utf8_valid_blocks(unsigned char const* data,
+                                 size_t               len,
+                                 size_t*              out_checked)
+{
+  // each pass starts at a codepoint as if ascii came before it, and leaves
+  // the sequence its last block cut to the next one
+  size_t pos = 0;
+
+#if defined(C_STR_AVX2)
+  {
+    __m256i const zero = _mm256_setzero_si256();
+    __m256i const max
+        = _mm256_loadu_si256((__m256i const*)internal_c_str_utf8_max);
+    __m256i prev       = zero;
+    __m256i incomplete = zero;
+    __m256i errors     = zero;
+
+    size_t const start = pos;
+    for (; pos + 32 <= len; pos += 32) {
+      __m256i const block = _mm256_loadu_si256((__m256i const*)(data + pos));
+      if (_mm256_movemask_epi8(block) == 0) {
+        // ascii doesn't finish what the block before started
+        errors = _mm256_or_si256(errors, incomplete);
+      } else {
+        errors = _mm256_or_si256(errors,
+                                 internal_c_str_utf8_errors_32(block, prev));
+        incomplete = _mm256_subs_epu8(block, max);
+      }
+      prev = block;
+    }
+
+    if (!_mm256_testz_si256(errors, errors)) { return false; }
+    pos = internal_c_str_utf8_boundary(data, start, pos);
+  }
+#endif
+
+  {
+    __m128i const zero = _mm_setzero_si128();
+    __m128i const max
+        = _mm_loadu_si128((__m128i const*)(internal_c_str_utf8_max + 16));
+    __m128i prev       = zero;
+    __m128i incomplete = zero;
+    __m128i errors     = zero;
+
+    size_t const start = pos;
+    for (; pos + 16 <= len; pos += 16) {
+      __m128i const block = _mm_loadu_si128((__m128i const*)(data + pos));
+      if (_mm_movemask_epi8(block) == 0) {
+        errors = _mm_or_si128(errors, incomplete);
+      } else {
+        errors
+            = _mm_or_si128(errors, internal_c_str_utf8_errors_16(block, prev));
+        incomplete = _mm_subs_epu8(block, max);
+      }
+      prev = block;
+    }
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(errors, zero)) != 0xFFFF) {
+      return false;
+    }
+    pos = internal_c_str_utf8_boundary(data, start, pos);
+  }
+
+  *out_checked = pos;
+  return true;
+}
+
+__m128i
+internal_c_str_utf8_errors_16(__m128i block, __m128i prev)
+{
+  __m128i const low_nibble = _mm_set1_epi8(0x0F);
+
+  // the 1, 2 and 3 bytes before each byte of `block`
+  __m128i const prev1 = _mm_alignr_epi8(block, prev, 15);
+  __m128i const prev2 = _mm_alignr_epi8(block, prev, 14);
+  __m128i const prev3 = _mm_alignr_epi8(block, prev, 13);
+
+  __m128i const byte_1_high = _mm_shuffle_epi8(
+      _mm_loadu_si128((__m128i const*)internal_c_str_utf8_byte_1_high),
+      _mm_and_si128(_mm_srli_epi16(prev1, 4), low_nibble));
+  __m128i const byte_1_low = _mm_shuffle_epi8(
+      _mm_loadu_si128((__m128i const*)internal_c_str_utf8_byte_1_low),
+      _mm_and_si128(prev1, low_nibble));
+  __m128i const byte_2_high = _mm_shuffle_epi8(
+      _mm_loadu_si128((__m128i const*)internal_c_str_utf8_byte_2_high),
+      _mm_and_si128(_mm_srli_epi16(block, 4), low_nibble));
+  __m128i const pair_errors
+      = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+  // the 3rd and 4th bytes of a sequence follow a continuation, so the pair
+  // only says TWO_CONTS, flip it there and nowhere else
+  __m128i const third  = _mm_subs_epu8(prev2, _mm_set1_epi8(0xE0 - 0x80));
+  __m128i const fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0 - 0x80));
+  __m128i const must_be_continuation = _mm_and_si128(
+      _mm_or_si128(third, fourth), _mm_set1_epi8((char)C_STR_UTF8_TWO_CONTS));
+
+  return _mm_xor_si128(must_be_continuation, pair_errors);
+}
+
+#if defined(C_STR_AVX2)
+__m256i
+internal_c_str_utf8_errors_32(__m256i block, __m256i prev)
+{
+  __m256i const low_nibble = _mm256_set1_epi8(0x0F);
+
+  // alignr works on each 128 bit lane, so line the high lane of `prev` up
+  // with the low lane of `block` first
+  __m256i const carry = _mm256_permute2x128_si256(prev, block, 0x21);
+  __m256i const prev1 = _mm256_alignr_epi8(block, carry, 15);
+  __m256i const prev2 = _mm256_alignr_epi8(block, carry, 14);
+  __m256i const prev3 = _mm256_alignr_epi8(block, carry, 13);
+
+  __m256i const byte_1_high = _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(
+          _mm_loadu_si128((__m128i const*)internal_c_str_utf8_byte_1_high)),
+      _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low_nibble));
+  __m256i const byte_1_low = _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(
+          _mm_loadu_si128((__m128i const*)internal_c_str_utf8_byte_1_low)),
+      _mm256_and_si256(prev1, low_nibble));
+  __m256i const byte_2_high = _mm256_shuffle_epi8(
+      _mm256_broadcastsi128_si256(
+          _mm_loadu_si128((__m128i const*)internal_c_str_utf8_byte_2_high)),
+      _mm256_and_si256(_mm256_srli_epi16(block, 4), low_nibble));
+  __m256i const pair_errors = _mm256_and_si256(
+      _mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+  __m256i const third  = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+  __m256i const fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80));
+  __m256i const must_be_continuation
+      = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                         _mm256_set1_epi8((char)C_STR_UTF8_TWO_CONTS));
+
+  return _mm256_xor_si256(must_be_continuation, pair_errors);
+}
+#endif
+
+size_t
+internal_c_str_utf8_boundary(unsigned char const* data,
+                             size_t               start,
+                             size_t               end)
+{
+  // back up to the lead byte of a sequence that may go on after `end`, up to
+  // 3 bytes back, a complete sequence before `end` was checked already
+  for (size_t iii = 1; iii <= 3 && iii <= end - start; ++iii) {
+    if (data[end - iii] >= 0xC0) { return end - iii; }
+    if (data[end - iii] < 0x80) { break; }
+  }
+
+  return end;
+}
+#endif
+
+size_t
+internal_c_str_utf8_decode(unsigned char const* bytes,
+                           size_t               len,
+                           uint32_t*            out_codepoint,
+                           bool*                out_truncated)
+{
+  // the well formed sequences (Unicode table 3-7): the lead byte gives the
+  // size and the range of the second byte, the others are always 80..BF
+  unsigned char const lead       = bytes[0];
+  size_t              size       = 0;
+  unsigned char       second_min = 0x80;
+  unsigned char       second_max = 0xBF;
+  uint32_t            codepoint  = 0;
+
+  if (out_truncated) { *out_truncated = false; }
+
+  if (lead < 0x80) {
+    if (out_codepoint) { *out_codepoint = lead; }
+    return 1;
+  } else if (lead >= 0xC2 && lead <= 0xDF) {
+    size      = 2;
+    codepoint = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    size      = 3;
+    codepoint = lead & 0x0F;
+    if (lead == 0xE0) { second_min = 0xA0; } // overlong
+    if (lead == 0xED) { second_max = 0x9F; } // surrogates
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    size      = 4;
+    codepoint = lead & 0x07;
+    if (lead == 0xF0) { second_min = 0x90; } // overlong
+    if (lead == 0xF4) { second_max = 0x8F; } // above U+10FFFF
+  } else {
+    // continuation bytes, C0/C1 (overlong) and F5..FF
+    return 0;
+  }
+
+  for (size_t iii = 1; iii < size; ++iii) {
+    // everything up to the end was fine, the rest may be in the next chunk
+    if (iii >= len) {
+      if (out_truncated) { *out_truncated = true; }
+      return 0;
+    }
+
+    unsigned char const min = (iii == 1) ? second_min : 0x80;
+    unsigned char const max = (iii == 1) ? second_max : 0xBF;
+    if (bytes[iii] < min || bytes[iii] > max) { return 0; }
+
+    codepoint = (codepoint << 6) | (bytes[iii] & 0x3F);
+  }
+
+  if (out_codepoint) { *out_codepoint = codepoint; }
+  return size;
+}
+
+size_t
+internal_c_str_utf16_ascii_len(uint16_t const* data, size_t len)
+{
+  size_t iii = 0;
+
+#if defined(C_STR_SSE2)
+  __m128i const non_ascii = _mm_set1_epi16((short)0xFF80);
+  __m128i const zero      = _mm_setzero_si128();
+  for (; iii + 8 <= len; iii += 8) {
+    __m128i const block = _mm_loadu_si128((__m128i const*)(data + iii));
+    uint32_t const mask = (uint32_t)_mm_movemask_epi8(
+        _mm_cmpeq_epi16(_mm_and_si128(block, non_ascii), zero));
+    if (mask != 0xFFFF) { return iii + (internal_c_str_ctz(~mask) / 2); }
+  }
+#endif
+
+  while (iii < len && data[iii] < 0x80) { iii++; }
+
+  return iii;
+}
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#undef CSTDLIB_STR_IMPLEMENTATION
+#endif /* CSTDLIB_STR_IMPLEMENTATION */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_STR_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable : 4996) // disable warning about unsafe functions
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STR(str) str, (sizeof(str) - 1)
+#define STR_INV(str) (sizeof(str) - 1), str
+#define STR_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define STR_TEST(err)                                                          \
+  (err.code != C_STR_ERROR_none.code) ? STR_TEST_PRINT_ABORT(err.desc) : (void)0
+#define STR_ASSERT(cond) (!(cond)) ? STR_TEST_PRINT_ABORT(#cond) : (void)0
+
+int
+main(void)
+{
+  c_str_error_t err = C_STR_ERROR_none;
+
+  /* test: create, remove, append */
+  {
+    CStr str;
+    err = c_str_create(STR("Ahmed is here"), &str);
+    STR_TEST(err);
+
+    err = c_str_remove(&str, STR("here"));
+    STR_TEST(err);
+
+    STR_ASSERT(strncmp(str.data, STR("Ahmed is ")) == 0);
+
+    err = c_str_append_with_cstr(&str, STR("here"));
+    STR_TEST(err);
+    STR_ASSERT(strncmp(str.data, STR("Ahmed is here")) == 0);
+
+    c_str_destroy(&str);
+  }
+
+  /* test: remove from the middle */
+  {
+    CStr str;
+    err = c_str_create(STR("Ahmed is here"), &str);
+    STR_TEST(err);
+
+    err = c_str_remove(&str, STR("is "));
+    STR_TEST(err);
+    STR_ASSERT(str.len == 10 && strcmp(str.data, "Ahmed here") == 0);
+
+    c_str_destroy(&str);
+  }
+
+  /* test: find */
+  {
+    // long enough to go through the SIMD blocks and the scalar tail
+    char haystack[300];
+    for (size_t iii = 0; iii < sizeof(haystack); ++iii) {
+      haystack[iii] = (char)('a' + (iii % 7));
+    }
+
+    CStr str;
+    err = c_str_create(haystack, sizeof(haystack), &str);
+    STR_TEST(err);
+
+    char* found = NULL;
+    err         = c_str_find(&str, STR("xyz"), &found);
+    STR_TEST(err);
+    STR_ASSERT(found == NULL);
+
+    // a needle longer than the rest of the string must not be read past
+    err = c_str_find(&str, STR("gabcdefgabcdefX"), &found);
+    STR_TEST(err);
+    STR_ASSERT(found == NULL);
+
+    // plant the needle at every offset, every length up to a Horspool one
+    char needle[100];
+    for (size_t len = 1; len < sizeof(needle); len += 7) {
+      for (size_t iii = 0; iii < len; ++iii) {
+        needle[iii] = (char)('A' + (iii % 26));
+      }
+
+      for (size_t pos = 0; pos + len <= str.len; pos += 13) {
+        memcpy(str.data + pos, needle, len);
+        err = c_str_find(&str, needle, len, &found);
+        STR_TEST(err);
+        STR_ASSERT(found == str.data + pos);
+        memcpy(str.data + pos, haystack + pos, len);
+      }
+
+      // at the very end, where only the scalar tail sees it
+      memcpy(str.data + str.len - len, needle, len);
+      err = c_str_find(&str, needle, len, &found);
+      STR_TEST(err);
+      STR_ASSERT(found == str.data + str.len - len);
+      memcpy(str.data + str.len - len, haystack + str.len - len, len);
+
+      // first and last bytes match but the middle doesn't
+      if (len > 2) {
+        memcpy(str.data + 5, needle, len);
+        str.data[5 + len / 2] = '#';
+        err = c_str_find(&str, needle, len, &found);
+        STR_TEST(err);
+        STR_ASSERT(found == NULL);
+        memcpy(str.data + 5, haystack + 5, len);
+      }
+    }
+
+    c_str_destroy(&str);
+  }
+
+  /* test: empty string */
+  {
+    CStr str;
+    err = c_str_create(STR(""), &str);
 
     STR_TEST(err);
     STR_ASSERT(str.data[0] == "\0"[0]);
@@ -663,6 +2087,91 @@ main(void)
     c_str_destroy(&str);
   }
 
+  /* test: replace_all */
+  {
+    CStr str;
+    err = c_str_create(STR("a-b-c-d"), &str);
+    STR_TEST(err);
+
+    size_t count = 0;
+    err          = c_str_replace_all(&str, STR("-"), STR(" -> "), &count);
+    STR_TEST(err);
+    STR_ASSERT(count == 3);
+    STR_ASSERT(strcmp(str.data, "a -> b -> c -> d") == 0);
+    STR_ASSERT(str.len == strlen("a -> b -> c -> d"));
+
+    err = c_str_replace_all(&str, STR(" -> "), STR("."), &count);
+    STR_TEST(err);
+    STR_ASSERT(count == 3 && strcmp(str.data, "a.b.c.d") == 0);
+
+    err = c_str_replace_all(&str, STR("."), NULL, 0, &count);
+    STR_TEST(err);
+    STR_ASSERT(count == 3 && strcmp(str.data, "abcd") == 0);
+
+    // occurrences don't overlap
+    err = c_str_replace_all(&str, STR("abcd"), STR("aaaa"), NULL);
+    STR_TEST(err);
+    err = c_str_replace_all(&str, STR("aa"), STR("b"), &count);
+    STR_TEST(err);
+    STR_ASSERT(count == 2 && strcmp(str.data, "bb") == 0);
+
+    err = c_str_replace_all(&str, STR("x"), STR("y"), &count);
+    STR_ASSERT(err.code == C_STR_ERROR_needle_not_found.code && count == 0);
+
+    c_str_destroy(&str);
+
+    // growing a string that has room for the result
+    err = c_str_create_empty(64, &str);
+    STR_TEST(err);
+    err = c_str_append_with_cstr(&str, STR("a-b-c-d"));
+    STR_TEST(err);
+
+    err = c_str_replace_all(&str, STR("-"), STR("-->"), &count);
+    STR_TEST(err);
+    STR_ASSERT(count == 3 && strcmp(str.data, "a-->b-->c-->d") == 0);
+    STR_ASSERT(str.len == strlen("a-->b-->c-->d"));
+
+    c_str_destroy(&str);
+  }
+
+  /* test: find_iter, split_iter */
+  {
+    CStr str;
+    err = c_str_create(STR("key=value;;x=1;"), &str);
+    STR_TEST(err);
+
+    size_t       iter             = 0;
+    size_t       offset           = 0;
+    size_t       len              = 0;
+    size_t       index            = 0;
+    size_t const find_offsets[]   = {9, 10, 14};
+    char const*  split_pieces[]   = {"key=value", "", "x=1", ""};
+    size_t const split_pieces_len = 4;
+    while (c_str_find_iter(&str, STR(";"), &iter, &offset)) {
+      STR_ASSERT(index < 3 && offset == find_offsets[index]);
+      index++;
+    }
+    STR_ASSERT(index == 3);
+
+    iter  = 0;
+    index = 0;
+    while (c_str_split_iter(&str, STR(";"), &iter, &offset, &len)) {
+      STR_ASSERT(index < split_pieces_len);
+      STR_ASSERT(len == strlen(split_pieces[index]));
+      STR_ASSERT(strncmp(str.data + offset, split_pieces[index], len) == 0);
+      index++;
+    }
+    STR_ASSERT(index == split_pieces_len);
+
+    // no separator at all gives back the whole string
+    iter = 0;
+    STR_ASSERT(c_str_split_iter(&str, STR("|"), &iter, &offset, &len));
+    STR_ASSERT(offset == 0 && len == str.len);
+    STR_ASSERT(!c_str_split_iter(&str, STR("|"), &iter, &offset, &len));
+
+    c_str_destroy(&str);
+  }
+
   /* test: concatenation */
   {
     CStr str1;
@@ -759,6 +2268,180 @@ main(void)
     c_str_destroy(&str);
   }
 
+  /* test: utf8 validation */
+  {
+    struct {
+      char const* bytes;
+      size_t      len;
+      bool        valid;
+      size_t      count;
+    } const cases[] = {
+        {STR("plain ascii that is long enough to take the simd path"), true,
+         53},
+        {STR("h\xc3\xa9llo w\xc3\xb6rld, \xe2\x82\xac 5, \xf0\x9f\x98\x80 !"),
+         true, 21},
+        {STR("\xef\xbf\xbf\xf4\x8f\xbf\xbf\xed\x9f\xbf"), true, 3},
+        {STR("ab\xff"), false, 0},         // never valid
+        {STR("ab\xc0\x80"), false, 0},     // overlong NUL
+        {STR("ab\xe0\x80\xaf"), false, 0}, // overlong '/'
+        {STR("ab\xed\xa0\x80"), false, 0}, // surrogate
+        {STR("ab\xf4\x90\x80\x80"), false, 0}, // above U+10FFFF
+        {STR("ab\xe2\x82"), false, 0},         // truncated at the end
+        {STR("ab\xe2\x82x"), false, 0},
+        {STR("0123456789abcdef0123456789\x80"), false, 0},
+    };
+
+    for (size_t iii = 0; iii < sizeof(cases) / sizeof(*cases); ++iii) {
+      CStr str;
+      err = c_str_create(cases[iii].bytes, cases[iii].len, &str);
+      STR_TEST(err);
+
+      bool is_valid = !cases[iii].valid;
+      err           = c_str_utf8_valid(&str, &is_valid);
+      STR_TEST(err);
+      STR_ASSERT(is_valid == cases[iii].valid);
+
+      if (cases[iii].valid) {
+        size_t count = 0;
+        err          = c_str_utf8_count(&str, &count);
+        STR_TEST(err);
+        STR_ASSERT(count == cases[iii].count);
+      }
+
+      c_str_destroy(&str);
+    }
+
+    // long enough for a few simd blocks: each sequence is cut by a block
+    // boundary somewhere, and every byte gets broken once
+    {
+      char const text[] = "\xf0\x9f\x98\x80 h\xc3\xa9llo \xe2\x82\xac "
+                          "\xd0\xbf\xd1\x80\xd0\xb8 w\xc3\xb6rld \xed\x9f\xbf!";
+      size_t const text_len = sizeof(text) - 1;
+
+      char   bytes[4 * (sizeof(text) - 1)];
+      size_t bytes_len = 0;
+      for (; bytes_len + text_len <= sizeof(bytes); bytes_len += text_len) {
+        memcpy(bytes + bytes_len, text, text_len);
+      }
+
+      for (size_t len = 0; len <= bytes_len; ++len) {
+        CStr str;
+        err = c_str_create(bytes, len, &str);
+        STR_TEST(err);
+
+        // valid unless the end cuts a sequence
+        bool const cut = len < bytes_len
+                      && ((unsigned char)bytes[len] & 0xC0) == 0x80;
+        bool is_valid  = cut;
+        err            = c_str_utf8_valid(&str, &is_valid);
+        STR_TEST(err);
+        STR_ASSERT(is_valid == !cut);
+
+        if (len > 0) {
+          c_str_data(&str)[len / 2] = (char)0xFF;
+          err                       = c_str_utf8_valid(&str, &is_valid);
+          STR_TEST(err);
+          STR_ASSERT(!is_valid);
+        }
+
+        c_str_destroy(&str);
+      }
+    }
+
+    // a codepoint is checked where it is, not at the start of the string
+    CStr str;
+    err = c_str_create(STR("\xc3\xa9\xe2\x82"), &str);
+    STR_TEST(err);
+    size_t codepoint_size = 0;
+    err                   = c_str_utf8_next_codepoint(&str, 2, &codepoint_size);
+    STR_ASSERT(err.code == C_STR_ERROR_invalid_utf8.code);
+    STR_ASSERT(codepoint_size == 1);
+    c_str_destroy(&str);
+  }
+
+  /* test: transcoding */
+  {
+    // 1, 2, 3 and 4 byte codepoints with ascii runs long enough for the simd
+    // paths in between
+    char const   utf8[]   = "plain ascii text, then h\xc3\xa9llo \xe2\x82\xac "
+                            "and \xf0\x9f\x98\x80 and more plain ascii text";
+    size_t const utf8_len = sizeof(utf8) - 1;
+
+    size_t utf16_len;
+    err = c_str_utf8_to_utf16(utf8, utf8_len, NULL, 0, &utf16_len, NULL);
+    STR_TEST(err);
+    STR_ASSERT(utf16_len == utf8_len - 1 - 2 - 2); // 😀 is a surrogate pair
+
+    uint16_t utf16[128];
+    size_t   written;
+    err = c_str_utf8_to_utf16(utf8, utf8_len, utf16, utf16_len, &written, NULL);
+    STR_TEST(err);
+    STR_ASSERT(written == utf16_len);
+    STR_ASSERT(utf16[0] == 'p' && utf16[24] == 0xE9);
+    STR_ASSERT(utf16[35] == 0xD83D && utf16[36] == 0xDE00);
+
+    size_t utf32_len;
+    err = c_str_utf8_to_utf32(utf8, utf8_len, NULL, 0, &utf32_len, NULL);
+    STR_TEST(err);
+    STR_ASSERT(utf32_len == utf16_len - 1);
+
+    uint32_t utf32[128];
+    err = c_str_utf8_to_utf32(utf8, utf8_len, utf32, utf32_len, &written, NULL);
+    STR_TEST(err);
+    STR_ASSERT(written == utf32_len && utf32[35] == 0x1F600);
+
+    size_t back_len;
+    err = c_str_utf16_to_utf8(utf16, utf16_len, NULL, 0, &back_len, NULL);
+    STR_TEST(err);
+    STR_ASSERT(back_len == utf8_len);
+
+    char back[128];
+    err = c_str_utf16_to_utf8(utf16, utf16_len, back, back_len, &written, NULL);
+    STR_TEST(err);
+    STR_ASSERT(written == utf8_len && memcmp(back, utf8, utf8_len) == 0);
+
+    // streaming: feed the bytes in chunks cut at every possible place, the
+    // unconsumed tail of a chunk is fed again with the next one
+    for (size_t chunk = 1; chunk <= 8; ++chunk) {
+      size_t total    = 0;
+      size_t consumed = 0;
+      size_t begin    = 0;
+      size_t end      = 0;
+      while (begin < utf8_len) {
+        end = (end + chunk < utf8_len) ? end + chunk : utf8_len;
+        err = c_str_utf8_to_utf16(utf8 + begin, end - begin, utf16 + total,
+                                  128 - total, &written, &consumed);
+        STR_TEST(err);
+        total += written;
+        begin += consumed;
+      }
+      STR_ASSERT(total == utf16_len);
+      STR_ASSERT(utf16[35] == 0xD83D && utf16[36] == 0xDE00);
+    }
+
+    // the same for a surrogate pair cut in the middle
+    size_t consumed;
+    err = c_str_utf16_to_utf8(utf16, 36, back, 128, &written, &consumed);
+    STR_TEST(err);
+    STR_ASSERT(consumed == 35);
+    err = c_str_utf16_to_utf8(utf16, 36, back, 128, &written, NULL);
+    STR_ASSERT(err.code == C_STR_ERROR_invalid_utf16.code);
+
+    // a buffer that is too small gets what fits, whole codepoints only
+    err = c_str_utf8_to_utf16(utf8, utf8_len, utf16, 36, &written, &consumed);
+    STR_ASSERT(err.code == C_STR_ERROR_buffer_too_small.code);
+    STR_ASSERT(written == 35 && consumed == 38);
+
+    err = c_str_utf8_to_utf16(STR("ab\xed\xa0\x80"), utf16, 128, &written,
+                              &consumed);
+    STR_ASSERT(err.code == C_STR_ERROR_invalid_utf8.code);
+    STR_ASSERT(written == 2 && consumed == 2);
+
+    uint16_t const lone_low[] = {'a', 0xDC00, 'b'};
+    err = c_str_utf16_to_utf8(lone_low, 3, back, 128, &written, &consumed);
+    STR_ASSERT(err.code == C_STR_ERROR_invalid_utf16.code && consumed == 1);
+  }
+
   /* test: remove at */
   {
     CStr str;
@@ -775,6 +2458,164 @@ main(void)
     STR_TEST(err);
     STR_ASSERT(removed_size == 9);
     STR_ASSERT(strcmp(str.data, "This is") == 0);
+    STR_ASSERT(str.len == 7);
+
+    c_str_destroy(&str);
+  }
+
+  /* test: growth, reserve, shrink_to_fit */
+  {
+    CStr str;
+    err = c_str_create(STR("x"), &str);
+    STR_TEST(err);
+
+    size_t reallocs      = 0;
+    size_t last_capacity = str.capacity;
+    for (size_t iii = 0; iii < 100000; ++iii) {
+      err = c_str_append_with_cstr(&str, STR("y"));
+      STR_TEST(err);
+      if (str.capacity != last_capacity) {
+        reallocs++;
+        last_capacity = str.capacity;
+      }
+    }
+    STR_ASSERT(str.len == 100001 && str.data[str.len] == '\0');
+    STR_ASSERT(reallocs <= 20);
+
+    err = c_str_shrink_to_fit(&str);
+    STR_TEST(err);
+    STR_ASSERT(str.capacity == str.len + 1 && str.data[str.len] == '\0');
+
+    err = c_str_reserve(&str, str.len + 1000);
+    STR_TEST(err);
+    STR_ASSERT(str.capacity == str.len + 1001);
+
+    char const* data = str.data;
+    for (size_t iii = 0; iii < 100; ++iii) {
+      err = c_str_append_with_cstr(&str, STR("0123456789"));
+      STR_TEST(err);
+    }
+    STR_ASSERT(str.data == data && str.len == 101001);
+
+    // reserving less than what is there is a no-op
+    err = c_str_reserve(&str, 10);
+    STR_TEST(err);
+    STR_ASSERT(str.data == data && str.capacity == 101001 + 1);
+
+    c_str_destroy(&str);
+  }
+
+#ifdef C_STR_ENABLE_SSO
+  /* test: short strings */
+  {
+    CStr str;
+    err = c_str_create(STR("tag:v1"), &str);
+    STR_TEST(err);
+    STR_ASSERT(str.data == str.inline_data);
+    STR_ASSERT(str.capacity == C_STR_SSO_CAPACITY);
+    STR_ASSERT(strcmp(str.data, "tag:v1") == 0 && str.len == 6);
+
+    // fill the inline buffer
+    while (str.len < C_STR_SSO_CAPACITY - 1) {
+      err = c_str_append_with_cstr(&str, STR("x"));
+      STR_TEST(err);
+      STR_ASSERT(str.data[str.len] == '\0');
+    }
+    STR_ASSERT(str.data == str.inline_data);
+
+    // one more byte moves it to the heap
+    err = c_str_append_with_cstr(&str, STR("y"));
+    STR_TEST(err);
+    STR_ASSERT(str.data != str.inline_data);
+    STR_ASSERT(str.len == C_STR_SSO_CAPACITY);
+    STR_ASSERT(strncmp(str.data, "tag:v1xx", 8) == 0);
+    STR_ASSERT(str.data[str.len - 1] == 'y' && str.data[str.len] == '\0');
+
+    // and shrinking brings it back
+    size_t removed = 0;
+    err            = c_str_remove_at(&str, 3, 100, &removed);
+    STR_TEST(err);
+    err = c_str_shrink_to_fit(&str);
+    STR_TEST(err);
+    STR_ASSERT(str.data == str.inline_data);
+    STR_ASSERT(strcmp(str.data, "tag") == 0 && str.len == 3);
+
+    err = c_str_replace_all(&str, STR("a"), STR("aaaaaaaaaaaaaaaaaaaaaaaa"),
+                            NULL);
+    STR_TEST(err);
+    STR_ASSERT(str.data != str.inline_data);
+    STR_ASSERT(str.len == 26 && strlen(str.data) == 26);
+
+    c_str_destroy(&str);
+  }
+#else
+  /* test: a short string moves like any other struct */
+  {
+    CStr str;
+    err = c_str_create(STR("abc"), &str);
+    STR_TEST(err);
+
+    CStr moved = str;
+    str        = (CStr){0};
+    STR_ASSERT(strcmp(moved.data, "abc") == 0 && moved.len == 3);
+
+    err = c_str_append_with_cstr(&moved, STR("def"));
+    STR_TEST(err);
+    STR_ASSERT(strcmp(moved.data, "abcdef") == 0 && moved.len == 6);
+
+    c_str_destroy(&moved);
+  }
+#endif
+
+  /* test: views */
+  {
+    CStr str;
+    err = c_str_create(STR("  GET /index.html HTTP/1.1 \r\n"), &str);
+    STR_TEST(err);
+
+    CStrView line = c_str_view_trim(c_str_view(&str));
+    STR_ASSERT(line.len == strlen("GET /index.html HTTP/1.1"));
+    STR_ASSERT(line.ptr == str.data + 2);
+
+    CStrView    token     = {0};
+    size_t      iter      = 0;
+    size_t      index     = 0;
+    char const* tokens[]  = {"GET", "/index.html", "HTTP/1.1"};
+    size_t      hashes[3] = {0};
+    while (c_str_view_split_iter(line, STR(" "), &iter, &token)) {
+      STR_ASSERT(index < 3);
+      STR_ASSERT(c_str_view_equal(
+          token, c_str_view_from_cstr(tokens[index], strlen(tokens[index]))));
+      hashes[index] = c_str_view_hash(token);
+      index++;
+    }
+    STR_ASSERT(index == 3);
+    STR_ASSERT(hashes[0] != hashes[1] && hashes[1] != hashes[2]);
+    STR_ASSERT(hashes[0] == c_str_view_hash(c_str_view_from_cstr(STR("GET"))));
+
+    size_t offset = 0;
+    STR_ASSERT(c_str_view_find(line, c_str_view_from_cstr(STR("HTTP")),
+                               &offset));
+    STR_ASSERT(offset == 16);
+    STR_ASSERT(!c_str_view_find(line, c_str_view_from_cstr(STR("\r")), NULL));
+
+    CStrView slice = {0};
+    err            = c_str_view_slice(line, 4, 100, &slice);
+    STR_TEST(err);
+    STR_ASSERT(slice.len == line.len - 4 && slice.ptr[0] == '/');
+    err = c_str_view_slice(line, line.len, 1, &slice);
+    STR_TEST(err);
+    STR_ASSERT(slice.len == 0);
+    err = c_str_view_slice(line, line.len + 1, 1, &slice);
+    STR_ASSERT(err.code == C_STR_ERROR_wrong_index.code);
+
+    CStrView const abc = c_str_view_from_cstr(STR("abc"));
+    CStrView const ab  = c_str_view_from_cstr(STR("ab"));
+    CStrView const abd = c_str_view_from_cstr(STR("abd"));
+    STR_ASSERT(c_str_view_compare(abc, abc) == 0);
+    STR_ASSERT(c_str_view_compare(ab, abc) < 0);
+    STR_ASSERT(c_str_view_compare(abd, abc) > 0);
+    STR_ASSERT(c_str_view_trim(c_str_view_from_cstr(STR(" \t "))).len == 0);
 
     c_str_destroy(&str);
   }
@@ -0,0 +1,481 @@
+/* How To  : To use this module, do this in *ONE* C file:
+ *              #define CSTDLIB_STR_POOL_IMPLEMENTATION
+ *              #include "str_pool.h"
+ *           it depends on "str.h" and "map.h", so CSTDLIB_STR_IMPLEMENTATION
+ *           and CSTDLIB_MAP_IMPLEMENTATION have to be defined in one C file
+ *           as well
+ * Tests   : To use run test, do this in *ONE* C file:
+ *              #define CSTDLIB_STR_POOL_UNIT_TESTS
+ *              #include "str_pool.h"
+ * Options :
+ *           - C_STR_POOL_DONT_CHECK_PARAMS: parameters will not get checked
+ *                                           (this is off by default)
+ *           - C_STR_POOL_CHUNK_SIZE: bytes of every arena chunk, a longer
+ *                                    string gets a chunk of its own
+ *                                    (64 KiB by default)
+ * Notes   : a CStrPool interns strings, every distinct string is stored once
+ *           and gets a 32-bit id (in the order they were first seen) and a
+ *           NUL terminated `char const*` that stays valid till the pool is
+ *           destroyed. two interned strings are equal iff their ids (or
+ *           pointers) are, so they can be compared and hashed without
+ *           touching their bytes again.
+ *           the bytes live back to back in `CStr` chunks that never grow,
+ *           the CMap only maps the hash and length of a string to the last
+ *           id interned with them, the others are chained behind it (see
+ *           `CStrPoolEntry`), so a lookup hashes the string once, probes once
+ *           and compares the bytes of the candidates only
+ * License : MIT (go to the end of this file for details)
+ */
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- header -------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifndef CSTDLIB_STR_POOL_H
+#define CSTDLIB_STR_POOL_H
+
+#include "map.h"
+#include "str.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef C_STR_POOL_CHUNK_SIZE
+#define C_STR_POOL_CHUNK_SIZE (64U * 1024U)
+#endif
+
+typedef struct CStrPoolEntry {
+  char const* str;
+  size_t      len;
+  uint32_t    next; // older id with the same hash and length (or UINT32_MAX)
+} CStrPoolEntry;
+
+typedef struct CStrPool {
+  CMap           map;    // {hash, len} -> newest id
+  CStr*          chunks; // the arena, only the last one takes new strings
+  size_t         chunks_len;
+  size_t         chunks_capacity;
+  CStrPoolEntry* entries; // indexed by id
+  size_t         len;
+  size_t         capacity;
+} CStrPool;
+
+/// @brief create an empty pool
+/// @param out_pool
+/// @return error (any value but zero is treated as an error)
+c_str_error_t c_str_pool_create(CStrPool* out_pool);
+
+/// @brief get the id of `cstr_len` bytes of `cstr`, copying them into the
+///        pool the first time they are seen
+/// @param out_id can be NULL
+/// @param out_str the interned copy, NUL terminated (can be NULL)
+/// @return error (any value but zero is treated as an error)
+c_str_error_t c_str_pool_intern(CStrPool*    self,
+                                char const   cstr[],
+                                size_t       cstr_len,
+                                uint32_t*    out_id,
+                                char const** out_str);
+
+/// @brief same as `c_str_pool_intern` but never adds the string
+/// @return C_STR_ERROR_needle_not_found if it was never interned
+c_str_error_t c_str_pool_get(CStrPool const* self,
+                             char const      cstr[],
+                             size_t          cstr_len,
+                             uint32_t*       out_id);
+
+/// @brief the interned string of `id`
+/// @param out_len can be NULL
+/// @return NULL if `id` wasn't handed out by this pool
+char const*
+c_str_pool_str(CStrPool const* self, uint32_t id, size_t* out_len);
+
+/// @brief number of distinct strings
+size_t c_str_pool_len(CStrPool const* self);
+
+void c_str_pool_destroy(CStrPool* self);
+
+#endif // CSTDLIB_STR_POOL_H
+
+/* ------------------------------------------------------------------------ */
+/* ---------------------------- implementation ---------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_STR_POOL_IMPLEMENTATION
+#include <stdlib.h>
+#include <string.h>
+
+#if _WIN32 && (!_MSC_VER || !(_MSC_VER >= 1900))
+#error "You need MSVC must be higher that or equal to 1900"
+#endif
+
+#ifndef C_STR_POOL_DONT_CHECK_PARAMS
+#define C_STR_POOL_CHECK_PARAMS(params)                                        \
+  if (!(params)) return C_STR_ERROR_invalid_parameters;
+#else
+#define C_STR_POOL_CHECK_PARAMS(params) ((void)0)
+#endif
+
+#define C_STR_POOL_NIL UINT32_MAX
+#define C_STR_POOL_DEFAULT_CAPACITY 64U
+
+typedef struct CStrPoolKey {
+  uint64_t hash;
+  uint64_t len;
+} CStrPoolKey;
+
+static uint32_t      c_internal_str_pool_find(CStrPool const* self,
+                                              uint32_t        id,
+                                              char const      cstr[],
+                                              size_t          cstr_len);
+static c_str_error_t c_internal_str_pool_reserve(CStrPool* self,
+                                                 size_t    cstr_len);
+
+c_str_error_t
+c_str_pool_create(CStrPool* out_pool)
+{
+  if (!out_pool) { return C_STR_ERROR_none; }
+
+  *out_pool = (CStrPool){0};
+
+  c_map_error_t err = c_map_create(sizeof(CStrPoolKey), sizeof(uint32_t),
+                                   &out_pool->map);
+  if (err.code != C_MAP_ERROR_none.code) { return C_STR_ERROR_mem_allocation; }
+
+  return C_STR_ERROR_none;
+}
+
+c_str_error_t
+c_str_pool_intern(CStrPool*    self,
+                  char const   cstr[],
+                  size_t       cstr_len,
+                  uint32_t*    out_id,
+                  char const** out_str)
+{
+  C_STR_POOL_CHECK_PARAMS(self);
+  C_STR_POOL_CHECK_PARAMS(cstr || cstr_len == 0);
+
+  CStrPoolKey key = {
+      .hash = c_str_view_hash((CStrView){.ptr = cstr, .len = cstr_len}),
+      .len  = cstr_len,
+  };
+
+  // [1] seen already
+  uint32_t* head = NULL;
+  c_map_get(&self->map, &key, (void**)&head);
+
+  uint32_t id = head ? c_internal_str_pool_find(self, *head, cstr, cstr_len)
+                     : C_STR_POOL_NIL;
+
+  // [2] new string: make room for it first, then nothing can fail after the
+  //     key is inserted
+  if (id == C_STR_POOL_NIL) {
+    if (self->len == C_STR_POOL_NIL) { return C_STR_ERROR_mem_allocation; }
+
+    c_str_error_t err = c_internal_str_pool_reserve(self, cstr_len);
+    if (err.code != C_STR_ERROR_none.code) { return err; }
+
+    bool          inserted = false;
+    c_map_error_t map_err
+        = c_map_get_or_insert(&self->map, &key, (void**)&head, &inserted);
+    if (map_err.code != C_MAP_ERROR_none.code) {
+      return C_STR_ERROR_mem_allocation;
+    }
+
+    CStr*        chunk  = &self->chunks[self->chunks_len - 1];
+    size_t const offset = c_str_len(chunk);
+    if (cstr_len > 0) { c_str_append_with_cstr(chunk, cstr, cstr_len); }
+    c_str_append_with_cstr(chunk, "", 1);
+
+    id                = (uint32_t)self->len++;
+    self->entries[id] = (CStrPoolEntry){
+        .str  = c_str_data(chunk) + offset,
+        .len  = cstr_len,
+        .next = inserted ? C_STR_POOL_NIL : *head,
+    };
+    *head = id;
+  }
+
+  if (out_id) { *out_id = id; }
+  if (out_str) { *out_str = self->entries[id].str; }
+
+  return C_STR_ERROR_none;
+}
+
+c_str_error_t
+c_str_pool_get(CStrPool const* self,
+               char const      cstr[],
+               size_t          cstr_len,
+               uint32_t*       out_id)
+{
+  C_STR_POOL_CHECK_PARAMS(self);
+  C_STR_POOL_CHECK_PARAMS(cstr || cstr_len == 0);
+
+  CStrPoolKey key = {
+      .hash = c_str_view_hash((CStrView){.ptr = cstr, .len = cstr_len}),
+      .len  = cstr_len,
+  };
+
+  uint32_t* head = NULL;
+  c_map_get(&self->map, &key, (void**)&head);
+  if (!head) { return C_STR_ERROR_needle_not_found; }
+
+  uint32_t const id = c_internal_str_pool_find(self, *head, cstr, cstr_len);
+  if (id == C_STR_POOL_NIL) { return C_STR_ERROR_needle_not_found; }
+
+  if (out_id) { *out_id = id; }
+
+  return C_STR_ERROR_none;
+}
+
+char const*
+c_str_pool_str(CStrPool const* self, uint32_t id, size_t* out_len)
+{
+  if (!self || id >= self->len) { return NULL; }
+
+  if (out_len) { *out_len = self->entries[id].len; }
+
+  return self->entries[id].str;
+}
+
+size_t
+c_str_pool_len(CStrPool const* self)
+{
+  return self->len;
+}
+
+void
+c_str_pool_destroy(CStrPool* self)
+{
+  if (self) {
+    for (size_t iii = 0; iii < self->chunks_len; ++iii) {
+      c_str_destroy(&self->chunks[iii]);
+    }
+    free(self->chunks);
+    free(self->entries);
+    c_map_destroy(&self->map, NULL, NULL);
+    *self = (CStrPool){0};
+  }
+}
+
+/* ------------------------------------------------------------------------ */
+/* ------------------------------- internal ------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+uint32_t
+c_internal_str_pool_find(CStrPool const* self,
+                         uint32_t        id,
+                         char const      cstr[],
+                         size_t          cstr_len)
+{
+  // the chain only holds strings of the same hash and length
+  for (; id != C_STR_POOL_NIL; id = self->entries[id].next) {
+    if (cstr_len == 0 || memcmp(self->entries[id].str, cstr, cstr_len) == 0) {
+      return id;
+    }
+  }
+
+  return C_STR_POOL_NIL;
+}
+
+c_str_error_t
+c_internal_str_pool_reserve(CStrPool* self, size_t cstr_len)
+{
+  if (self->len == self->capacity) {
+    size_t const new_capacity
+        = self->capacity ? self->capacity * 2 : C_STR_POOL_DEFAULT_CAPACITY;
+
+    CStrPoolEntry* entries
+        = realloc(self->entries, new_capacity * sizeof(*entries));
+    if (!entries) { return C_STR_ERROR_mem_allocation; }
+    self->entries  = entries;
+    self->capacity = new_capacity;
+  }
+
+  // the string and its NUL, plus the NUL `c_str_append_with_cstr` always
+  // writes after them
+  size_t const needed = cstr_len + 2;
+  if (self->chunks_len > 0) {
+    CStr const* chunk = &self->chunks[self->chunks_len - 1];
+    if (c_str_len(chunk) + needed <= c_str_capacity(chunk)) {
+      return C_STR_ERROR_none;
+    }
+  }
+
+  if (self->chunks_len == self->chunks_capacity) {
+    size_t const new_capacity
+        = self->chunks_capacity ? self->chunks_capacity * 2 : 8;
+
+    CStr* chunks = realloc(self->chunks, new_capacity * sizeof(*chunks));
+    if (!chunks) { return C_STR_ERROR_mem_allocation; }
+    self->chunks          = chunks;
+    self->chunks_capacity = new_capacity;
+  }
+
+  // the chunks array moves when it grows, so a chunk must never keep its
+  // bytes inline (see C_STR_ENABLE_SSO)
+  size_t capacity = C_STR_POOL_CHUNK_SIZE;
+  if (capacity < needed) { capacity = needed; }
+  if (capacity <= C_STR_SSO_CAPACITY) { capacity = C_STR_SSO_CAPACITY + 1; }
+
+  c_str_error_t err
+      = c_str_create_empty(capacity, &self->chunks[self->chunks_len]);
+  if (err.code != C_STR_ERROR_none.code) { return err; }
+  self->chunks_len++;
+
+  return C_STR_ERROR_none;
+}
+
+#undef C_STR_POOL_NIL
+#undef C_STR_POOL_DEFAULT_CAPACITY
+#undef C_STR_POOL_CHECK_PARAMS
+#undef CSTDLIB_STR_POOL_IMPLEMENTATION
+#endif // CSTDLIB_STR_POOL_IMPLEMENTATION
+
+/* ------------------------------------------------------------------------ */
+/* -------------------------------- tests --------------------------------- */
+/* ------------------------------------------------------------------------ */
+
+#ifdef CSTDLIB_STR_POOL_UNIT_TESTS
+#ifdef NDEBUG
+#define NDEBUG_
+#undef NDEBUG
+#endif
+
+#define CSTDLIB_STR_IMPLEMENTATION
+#include "str.h"
+#define CSTDLIB_MAP_IMPLEMENTATION
+#include "map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STR_POOL_TEST_PRINT_ABORT(msg) (fprintf(stderr, "%s\n", msg), abort())
+#define STR_POOL_TEST(err)                                                     \
+  ((err.code != C_STR_ERROR_none.code) ? STR_POOL_TEST_PRINT_ABORT(err.desc)   \
+                                       : (void)0)
+#define STR_POOL_ASSERT(cond)                                                  \
+  (!(cond)) ? STR_POOL_TEST_PRINT_ABORT(#cond) : (void)0
+
+int
+main(void)
+{
+  c_str_error_t err = C_STR_ERROR_none;
+
+  // test: metric tags
+  {
+    char const* tags[] = {"host:a", "region:eu", "host:a", "", "region:eu", ""};
+
+    CStrPool pool;
+    err = c_str_pool_create(&pool);
+    STR_POOL_TEST(err);
+
+    uint32_t    ids[sizeof(tags) / sizeof(*tags)];
+    char const* strs[sizeof(tags) / sizeof(*tags)];
+    for (size_t iii = 0; iii < sizeof(tags) / sizeof(*tags); ++iii) {
+      err = c_str_pool_intern(&pool, tags[iii], strlen(tags[iii]), &ids[iii],
+                              &strs[iii]);
+      STR_POOL_TEST(err);
+      STR_POOL_ASSERT(strcmp(strs[iii], tags[iii]) == 0);
+      STR_POOL_ASSERT(strs[iii] != tags[iii]);
+    }
+    STR_POOL_ASSERT(c_str_pool_len(&pool) == 3);
+    STR_POOL_ASSERT(ids[0] == 0 && ids[1] == 1 && ids[3] == 2);
+    STR_POOL_ASSERT(ids[0] == ids[2] && strs[0] == strs[2]);
+    STR_POOL_ASSERT(ids[1] == ids[4] && strs[1] == strs[4]);
+    STR_POOL_ASSERT(ids[3] == ids[5] && strs[3] == strs[5]);
+
+    size_t      len = 0;
+    char const* str = c_str_pool_str(&pool, ids[1], &len);
+    STR_POOL_ASSERT(str == strs[1] && len == 9);
+    STR_POOL_ASSERT(c_str_pool_str(&pool, 3, NULL) == NULL);
+
+    uint32_t id = 0;
+    err         = c_str_pool_get(&pool, "region:eu", 9, &id);
+    STR_POOL_TEST(err);
+    STR_POOL_ASSERT(id == ids[1]);
+    err = c_str_pool_get(&pool, "region:us", 9, &id);
+    STR_POOL_ASSERT(err.code == C_STR_ERROR_needle_not_found.code);
+    STR_POOL_ASSERT(c_str_pool_len(&pool) == 3);
+
+    c_str_pool_destroy(&pool);
+  }
+
+  // test: many strings over many chunks, the pointers handed out first stay
+  //       valid and every string keeps its id
+  {
+    enum { STRS_LEN = 20000 };
+    char const** strs = malloc(STRS_LEN * sizeof(*strs));
+    STR_POOL_ASSERT(strs);
+
+    CStrPool pool;
+    err = c_str_pool_create(&pool);
+    STR_POOL_TEST(err);
+
+    char buf[64];
+    for (size_t round = 0; round < 2; ++round) {
+      for (size_t iii = 0; iii < STRS_LEN; ++iii) {
+        int const len = snprintf(buf, sizeof(buf), "metric.%zu", iii * 7919);
+
+        uint32_t    id  = 0;
+        char const* str = NULL;
+        err = c_str_pool_intern(&pool, buf, (size_t)len, &id, &str);
+        STR_POOL_TEST(err);
+        STR_POOL_ASSERT(id == iii);
+        if (round == 0) { strs[iii] = str; }
+        STR_POOL_ASSERT(str == strs[iii] && strcmp(str, buf) == 0);
+      }
+    }
+    STR_POOL_ASSERT(c_str_pool_len(&pool) == STRS_LEN);
+    STR_POOL_ASSERT(pool.chunks_len > 1);
+
+    // a string longer than a chunk
+    size_t const long_len = C_STR_POOL_CHUNK_SIZE * 2;
+    char*        long_str = malloc(long_len);
+    STR_POOL_ASSERT(long_str);
+    memset(long_str, 'x', long_len);
+
+    char const* str = NULL;
+    err = c_str_pool_intern(&pool, long_str, long_len, NULL, &str);
+    STR_POOL_TEST(err);
+    STR_POOL_ASSERT(memcmp(str, long_str, long_len) == 0);
+    STR_POOL_ASSERT(str[long_len] == '\0');
+    STR_POOL_ASSERT(strcmp(strs[0], "metric.0") == 0);
+
+    free(long_str);
+    c_str_pool_destroy(&pool);
+    free((void*)strs);
+  }
+}
+
+#ifdef NDEBUG_
+#define NDEBUG
+#undef NDEBUG_
+#endif
+
+#undef STR_POOL_TEST_PRINT_ABORT
+#undef STR_POOL_TEST
+#undef STR_POOL_ASSERT
+#undef CSTDLIB_STR_POOL_UNIT_TESTS
+#endif // CSTDLIB_STR_POOL_UNIT_TESTS
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Mohamed A. Elmeligy
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions: The above copyright
+ * notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software. THE SOFTWARE IS PROVIDED "AS IS",
+ * WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED
+ * TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+ * CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */